@@ -0,0 +1,80 @@
+/*
+ * @FileName   : binding_table.hpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: intermediate result of query execution, every row binds each query variable slot
+ *               to an entity id. Rows are fixed-width and stored contiguously in row-major order,
+ *               so operators copy and probe plain uint32_t arrays instead of hash maps.
+ */
+
+#ifndef PISANO_BINDING_TABLE_HPP
+#define PISANO_BINDING_TABLE_HPP
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace inno {
+
+class BindingTable {
+public:
+    /* entity ids start from 1, so 0 marks a variable slot which is not bound yet */
+    static constexpr uint32_t UNBOUND = 0;
+
+public:
+    BindingTable() : width_(0), size_(0) {}
+    explicit BindingTable(std::size_t width) : width_(width), size_(0) {}
+
+    std::size_t width() const { return width_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    void reserve(const std::size_t &rows) {
+        data_.reserve(rows * width_);
+    }
+
+    void clear() {
+        data_.clear();
+        size_ = 0;
+    }
+
+    const uint32_t *row(std::size_t index) const { return data_.data() + index * width_; }
+    uint32_t *row(std::size_t index) { return data_.data() + index * width_; }
+
+    /* append a row with all slots unbound, the returned pointer is valid until the next append */
+    uint32_t *appendRow() {
+        data_.resize(data_.size() + width_, static_cast<uint32_t>(UNBOUND));
+        ++size_;
+        return data_.data() + (size_ - 1) * width_;
+    }
+
+    /* append a copy of @src which has `width()` slots and doesn't point into this table */
+    uint32_t *appendRow(const uint32_t *src) {
+        std::size_t offset = data_.size();
+        data_.insert(data_.end(), src, src + width_);
+        ++size_;
+        return data_.data() + offset;
+    }
+
+    /* append the rows of @other, which has the same width */
+    void append(const BindingTable &other) {
+        data_.insert(data_.end(), other.data_.begin(), other.data_.end());
+        size_ += other.size_;
+    }
+
+    void swap(BindingTable &other) noexcept {
+        std::swap(width_, other.width_);
+        std::swap(size_, other.size_);
+        data_.swap(other.data_);
+    }
+
+private:
+    std::size_t width_;
+    std::size_t size_;
+    std::vector<uint32_t> data_;
+};
+
+}
+
+#endif //PISANO_BINDING_TABLE_HPP
@@ -0,0 +1,256 @@
+/*
+ * @FileName   : id_span.hpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: read-only view over a sorted list of ids, e.g. the objects of one subject under a predicate.
+ *               The ids are either a plain uint32_t array or a range of a compressed id stream, which is
+ *               split into blocks of `BLOCK_SIZE` positions. Inside a stream, an id is stored as a variable-byte
+ *               delta to the previous one, except the first id of a list and of a block which are stored as is,
+ *               so decoding can start at any block. `block_offsets` and `block_first` are the skip pointers,
+ *               they hold the byte offset and the first id of every block.
+ *               Ids listed by `skip`, e.g. deleted ones, are hidden from iteration, lookups and `size`,
+ *               and the ids of a plain array given to `extend`, e.g. inserted ones, are merged into them.
+ */
+
+#ifndef PISANO_ID_SPAN_HPP
+#define PISANO_ID_SPAN_HPP
+
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+
+namespace inno {
+
+class IdSpan {
+public:
+    static const uint32_t BLOCK_SIZE = 64;
+
+    class iterator;
+    using value_type = uint32_t;
+    using const_iterator = iterator;
+
+public:
+    IdSpan()
+        : raw_begin_(nullptr), raw_end_(nullptr), start_(nullptr), bytes_(nullptr)
+        , block_offsets_(nullptr), block_first_(nullptr), lo_(0), hi_(0)
+        , skip_begin_(nullptr), skip_end_(nullptr), hidden_(0), extra_begin_(nullptr), extra_end_(nullptr) {}
+
+    /* view over plain array [@begin, @end) */
+    IdSpan(const uint32_t *begin, const uint32_t *end)
+        : raw_begin_(begin), raw_end_(end), start_(nullptr), bytes_(nullptr)
+        , block_offsets_(nullptr), block_first_(nullptr), lo_(0), hi_(0)
+        , skip_begin_(nullptr), skip_end_(nullptr), hidden_(0), extra_begin_(nullptr), extra_end_(nullptr) {}
+
+    /* view over positions [@lo, @hi) of a compressed stream, @start points to the encoded id at @lo */
+    IdSpan(const uint8_t *start, uint64_t lo, uint64_t hi,
+           const uint8_t *bytes, const uint64_t *block_offsets, const uint32_t *block_first)
+        : raw_begin_(nullptr), raw_end_(nullptr), start_(start), bytes_(bytes)
+        , block_offsets_(block_offsets), block_first_(block_first), lo_(lo), hi_(hi)
+        , skip_begin_(nullptr), skip_end_(nullptr), hidden_(0), extra_begin_(nullptr), extra_end_(nullptr) {}
+
+    /* hide the ids of sorted array [@begin, @end), which occur @hidden times in the view */
+    void skip(const uint32_t *begin, const uint32_t *end, const std::size_t &hidden) {
+        skip_begin_ = begin;
+        skip_end_ = end;
+        hidden_ = hidden;
+    }
+
+    /* merge the ids of sorted array [@begin, @end) into the view */
+    void extend(const uint32_t *begin, const uint32_t *end) {
+        extra_begin_ = begin;
+        extra_end_ = end;
+    }
+
+    iterator begin() const;
+    iterator end() const;
+
+    std::size_t size() const {
+        return (start_ ? hi_ - lo_ : raw_end_ - raw_begin_) + (extra_end_ - extra_begin_) - hidden_;
+    }
+    bool empty() const { return size() == 0; }
+
+    /* first position whose id isn't less than @id */
+    iterator seek(const uint32_t &id) const;
+
+    bool contains(const uint32_t &id) const;
+
+    /* number of occurrences of @id, the list may hold duplicated ids */
+    std::size_t count(const uint32_t &id) const;
+
+    static uint32_t DecodeVarint(const uint8_t *&ptr) {
+        uint32_t value = *ptr & 0x7F;
+        for (int shift = 7; *ptr++ & 0x80; shift += 7) {
+            value |= static_cast<uint32_t>(*ptr & 0x7F) << shift;
+        }
+        return value;
+    }
+
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = uint32_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const uint32_t *;
+        using reference = uint32_t;
+
+    public:
+        iterator()
+            : raw_(nullptr), raw_end_(nullptr), ptr_(nullptr), pos_(0), hi_(0), value_(0)
+            , skip_(nullptr), skip_end_(nullptr), extra_(nullptr), extra_end_(nullptr) {}
+
+        /* iterate plain array [@raw, @raw_end) merged with [@extra, @extra_end) */
+        iterator(const uint32_t *raw, const uint32_t *raw_end,
+                 const uint32_t *skip = nullptr, const uint32_t *skip_end = nullptr,
+                 const uint32_t *extra = nullptr, const uint32_t *extra_end = nullptr)
+            : raw_(raw), raw_end_(raw_end), ptr_(nullptr), pos_(0), hi_(0), value_(0)
+            , skip_(skip), skip_end_(skip_end), extra_(extra), extra_end_(extra_end) {
+            settle_();
+        }
+
+        /* start decoding at position @pos, whose id is stored as is at @ptr */
+        iterator(const uint8_t *ptr, uint64_t pos, uint64_t hi,
+                 const uint32_t *skip = nullptr, const uint32_t *skip_end = nullptr,
+                 const uint32_t *extra = nullptr, const uint32_t *extra_end = nullptr)
+            : raw_(nullptr), raw_end_(nullptr), ptr_(ptr), pos_(pos), hi_(hi), value_(0)
+            , skip_(skip), skip_end_(skip_end), extra_(extra), extra_end_(extra_end) {
+            if (pos_ < hi_) {
+                value_ = DecodeVarint(ptr_);
+            }
+            settle_();
+        }
+
+        uint32_t operator*() const { return from_extra_() ? *extra_ : stored_(); }
+
+        iterator &operator++() {
+            advance_();
+            settle_();
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const iterator &other) const {
+            return raw_ == other.raw_ && pos_ == other.pos_ && extra_ == other.extra_;
+        }
+        bool operator!=(const iterator &other) const { return !(*this == other); }
+
+    private:
+        bool stored_end_() const { return raw_ ? raw_ == raw_end_ : pos_ >= hi_; }
+        bool at_end_() const { return stored_end_() && extra_ == extra_end_; }
+
+        uint32_t stored_() const { return raw_ ? *raw_ : value_; }
+
+        /* whether the current id is the one of the merged array, the stored one goes first on a tie */
+        bool from_extra_() const { return extra_ != extra_end_ && (stored_end_() || *extra_ < stored_()); }
+
+        void advance_() {
+            if (from_extra_()) {
+                ++extra_;
+            } else if (raw_) {
+                ++raw_;
+            } else if (++pos_ < hi_) {
+                uint32_t code = DecodeVarint(ptr_);
+                value_ = pos_ % BLOCK_SIZE == 0 ? code : value_ + code;
+            }
+        }
+
+        /* step over the hidden ids */
+        void settle_() {
+            while (skip_ != skip_end_ && !at_end_()) {
+                uint32_t value = **this;
+                skip_ = std::lower_bound(skip_, skip_end_, value);
+                if (skip_ == skip_end_ || *skip_ != value) {
+                    break;
+                }
+                advance_();
+            }
+        }
+
+    private:
+        const uint32_t *raw_;
+        const uint32_t *raw_end_;
+        const uint8_t *ptr_;
+        uint64_t pos_;
+        uint64_t hi_;
+        uint32_t value_;
+        const uint32_t *skip_;
+        const uint32_t *skip_end_;
+        const uint32_t *extra_;
+        const uint32_t *extra_end_;
+    };
+
+private:
+    const uint32_t *raw_begin_;
+    const uint32_t *raw_end_;
+    const uint8_t *start_;
+    const uint8_t *bytes_;
+    const uint64_t *block_offsets_;
+    const uint32_t *block_first_;
+    uint64_t lo_;
+    uint64_t hi_;
+    const uint32_t *skip_begin_;
+    const uint32_t *skip_end_;
+    std::size_t hidden_;
+    const uint32_t *extra_begin_;
+    const uint32_t *extra_end_;
+};
+
+inline IdSpan::iterator IdSpan::begin() const {
+    return start_ ? iterator(start_, lo_, hi_, skip_begin_, skip_end_, extra_begin_, extra_end_)
+                  : iterator(raw_begin_, raw_end_, skip_begin_, skip_end_, extra_begin_, extra_end_);
+}
+
+inline IdSpan::iterator IdSpan::end() const {
+    return start_ ? iterator(nullptr, hi_, hi_, nullptr, nullptr, extra_end_, extra_end_)
+                  : iterator(raw_end_, raw_end_, nullptr, nullptr, extra_end_, extra_end_);
+}
+
+inline IdSpan::iterator IdSpan::seek(const uint32_t &id) const {
+    const uint32_t *extra = std::lower_bound(extra_begin_, extra_end_, id);
+    if (!start_) {
+        return iterator(std::lower_bound(raw_begin_, raw_end_, id), raw_end_, skip_begin_, skip_end_,
+                        extra, extra_end_);
+    }
+    if (lo_ == hi_) {
+        return iterator(nullptr, hi_, hi_, skip_begin_, skip_end_, extra, extra_end_);
+    }
+
+    // the blocks after the first one start inside this list, so their first ids are sorted,
+    // decoding starts at the last block whose first id is less than @id
+    uint64_t first_block = lo_ / BLOCK_SIZE;
+    uint64_t last_block = (hi_ - 1) / BLOCK_SIZE;
+    uint64_t block = std::lower_bound(block_first_ + first_block + 1, block_first_ + last_block + 1, id)
+                     - block_first_ - 1;
+    iterator iter = block == first_block
+                    ? iterator(start_, lo_, hi_, skip_begin_, skip_end_, extra, extra_end_)
+                    : iterator(bytes_ + block_offsets_[block], block * BLOCK_SIZE, hi_, skip_begin_, skip_end_,
+                               extra, extra_end_);
+    iterator last = end();
+    while (iter != last && *iter < id) {
+        ++iter;
+    }
+    return iter;
+}
+
+inline bool IdSpan::contains(const uint32_t &id) const {
+    iterator iter = seek(id);
+    return iter != end() && *iter == id;
+}
+
+inline std::size_t IdSpan::count(const uint32_t &id) const {
+    std::size_t num = 0;
+    for (iterator iter = seek(id), last = end(); iter != last && *iter == id; ++iter) {
+        ++num;
+    }
+    return num;
+}
+
+}
+
+#endif //PISANO_ID_SPAN_HPP
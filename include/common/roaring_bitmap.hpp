@@ -0,0 +1,253 @@
+/*
+ * @FileName   : roaring_bitmap.hpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: compressed bitmap of ids in the style of Roaring. The ids are partitioned by their high 16 bits,
+ *               every partition is a container which holds the low 16 bits either as a sorted array when it has
+ *               at most `ARRAY_MAX_SIZE` ids, or as a bitmap of 2^16 bits otherwise. Membership tests are a
+ *               binary search over the containers followed by a bit test or a binary search inside one.
+ */
+
+#ifndef PISANO_ROARING_BITMAP_HPP
+#define PISANO_ROARING_BITMAP_HPP
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+
+namespace inno {
+
+class RoaringBitmap {
+public:
+    static const uint32_t ARRAY_MAX_SIZE = 4096;
+
+public:
+    RoaringBitmap() : cardinality_(0) {}
+
+    /* build the bitmap from ids in ascending order, duplicated ids are allowed */
+    template<typename Iterator>
+    static RoaringBitmap FromSorted(Iterator first, Iterator last);
+
+    void add(const uint32_t &id);
+    bool contains(const uint32_t &id) const;
+
+    std::size_t cardinality() const { return cardinality_; }
+    bool empty() const { return cardinality_ == 0; }
+
+    RoaringBitmap &operator&=(const RoaringBitmap &other);
+    RoaringBitmap operator&(const RoaringBitmap &other) const {
+        RoaringBitmap result = *this;
+        return result &= other;
+    }
+
+    /* call @func(id) for every id in ascending order */
+    template<typename Func>
+    void forEach(Func func) const;
+
+    std::vector<uint32_t> toVector() const {
+        std::vector<uint32_t> ids;
+        ids.reserve(cardinality_);
+        forEach([&ids](const uint32_t &id) { ids.emplace_back(id); });
+        return ids;
+    }
+
+    std::size_t memoryUsage() const {
+        std::size_t usage = containers_.size() * sizeof(Container);
+        for (const auto &container : containers_) {
+            usage += container.array.size() * sizeof(uint16_t) + container.bits.size() * sizeof(uint64_t);
+        }
+        return usage;
+    }
+
+private:
+    static const uint32_t BITMAP_WORDS = (1u << 16) / 64;
+
+    struct Container {
+        uint16_t key = 0;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> array;    // sorted low bits, used while `bits` is empty
+        std::vector<uint64_t> bits;     // [BITMAP_WORDS] if the container is a bitmap
+
+        bool isBitmap() const { return !bits.empty(); }
+
+        bool contains(const uint16_t &low) const {
+            if (isBitmap()) {
+                return (bits[low >> 6] >> (low & 63)) & 1;
+            }
+            return std::binary_search(array.begin(), array.end(), low);
+        }
+
+        void toBitmap() {
+            bits.assign(BITMAP_WORDS, 0);
+            for (const auto &low : array) {
+                bits[low >> 6] |= uint64_t(1) << (low & 63);
+            }
+            std::vector<uint16_t>().swap(array);
+        }
+
+        void toArray() {
+            array.clear();
+            array.reserve(cardinality);
+            for (uint32_t word = 0; word < BITMAP_WORDS; ++word) {
+                for (uint64_t w = bits[word]; w != 0; w &= w - 1) {
+                    array.emplace_back(static_cast<uint16_t>(word * 64 + __builtin_ctzll(w)));
+                }
+            }
+            std::vector<uint64_t>().swap(bits);
+        }
+    };
+
+    static Container intersect_(const Container &a, const Container &b);
+
+    std::vector<Container>::const_iterator find_(const uint16_t &key) const {
+        return std::lower_bound(containers_.begin(), containers_.end(), key,
+                                [](const Container &c, const uint16_t &k) { return c.key < k; });
+    }
+
+private:
+    std::vector<Container> containers_;   // sorted by key
+    std::size_t cardinality_;
+};
+
+template<typename Iterator>
+RoaringBitmap RoaringBitmap::FromSorted(Iterator first, Iterator last) {
+    RoaringBitmap bitmap;
+    for (; first != last; ++first) {
+        uint32_t id = *first;
+        auto key = static_cast<uint16_t>(id >> 16);
+        auto low = static_cast<uint16_t>(id & 0xFFFF);
+        if (bitmap.containers_.empty() || bitmap.containers_.back().key != key) {
+            bitmap.containers_.emplace_back();
+            bitmap.containers_.back().key = key;
+        }
+        Container &container = bitmap.containers_.back();
+        if (!container.array.empty() && container.array.back() == low) {
+            continue;
+        }
+        container.array.emplace_back(low);
+        ++container.cardinality;
+        ++bitmap.cardinality_;
+    }
+    for (auto &container : bitmap.containers_) {
+        if (container.cardinality > ARRAY_MAX_SIZE) {
+            container.toBitmap();
+        }
+    }
+    return bitmap;
+}
+
+inline void RoaringBitmap::add(const uint32_t &id) {
+    auto key = static_cast<uint16_t>(id >> 16);
+    auto low = static_cast<uint16_t>(id & 0xFFFF);
+    auto pos = find_(key) - containers_.cbegin();
+    if (pos == static_cast<std::ptrdiff_t>(containers_.size()) || containers_[pos].key != key) {
+        Container container;
+        container.key = key;
+        containers_.insert(containers_.begin() + pos, std::move(container));
+    }
+
+    Container &container = containers_[pos];
+    if (container.isBitmap()) {
+        uint64_t &word = container.bits[low >> 6];
+        uint64_t mask = uint64_t(1) << (low & 63);
+        if (word & mask) {
+            return;
+        }
+        word |= mask;
+    } else {
+        auto iter = std::lower_bound(container.array.begin(), container.array.end(), low);
+        if (iter != container.array.end() && *iter == low) {
+            return;
+        }
+        container.array.insert(iter, low);
+        if (container.array.size() > ARRAY_MAX_SIZE) {
+            container.toBitmap();
+        }
+    }
+    ++container.cardinality;
+    ++cardinality_;
+}
+
+inline bool RoaringBitmap::contains(const uint32_t &id) const {
+    auto key = static_cast<uint16_t>(id >> 16);
+    auto iter = find_(key);
+    return iter != containers_.end() && iter->key == key && iter->contains(static_cast<uint16_t>(id & 0xFFFF));
+}
+
+inline RoaringBitmap::Container RoaringBitmap::intersect_(const Container &a, const Container &b) {
+    Container result;
+    result.key = a.key;
+    if (a.isBitmap() && b.isBitmap()) {
+        result.bits.resize(BITMAP_WORDS);
+        for (uint32_t word = 0; word < BITMAP_WORDS; ++word) {
+            result.bits[word] = a.bits[word] & b.bits[word];
+            result.cardinality += __builtin_popcountll(result.bits[word]);
+        }
+        if (result.cardinality <= ARRAY_MAX_SIZE) {
+            result.toArray();
+        }
+    } else if (a.isBitmap() || b.isBitmap()) {
+        const Container &array = a.isBitmap() ? b : a;
+        const Container &bitmap = a.isBitmap() ? a : b;
+        for (const auto &low : array.array) {
+            if (bitmap.contains(low)) {
+                result.array.emplace_back(low);
+            }
+        }
+        result.cardinality = static_cast<uint32_t>(result.array.size());
+    } else {
+        std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                              std::back_inserter(result.array));
+        result.cardinality = static_cast<uint32_t>(result.array.size());
+    }
+    return result;
+}
+
+inline RoaringBitmap &RoaringBitmap::operator&=(const RoaringBitmap &other) {
+    std::vector<Container> containers;
+    std::size_t cardinality = 0;
+    auto a = containers_.begin();
+    auto b = other.containers_.begin();
+    while (a != containers_.end() && b != other.containers_.end()) {
+        if (a->key < b->key) {
+            ++a;
+        } else if (b->key < a->key) {
+            ++b;
+        } else {
+            Container container = intersect_(*a, *b);
+            if (container.cardinality > 0) {
+                cardinality += container.cardinality;
+                containers.emplace_back(std::move(container));
+            }
+            ++a;
+            ++b;
+        }
+    }
+    containers_.swap(containers);
+    cardinality_ = cardinality;
+    return *this;
+}
+
+template<typename Func>
+void RoaringBitmap::forEach(Func func) const {
+    for (const auto &container : containers_) {
+        uint32_t high = static_cast<uint32_t>(container.key) << 16;
+        if (!container.isBitmap()) {
+            for (const auto &low : container.array) {
+                func(high | low);
+            }
+            continue;
+        }
+        for (uint32_t word = 0; word < BITMAP_WORDS; ++word) {
+            for (uint64_t w = container.bits[word]; w != 0; w &= w - 1) {
+                func(high | (word * 64 + __builtin_ctzll(w)));
+            }
+        }
+    }
+}
+
+}
+
+#endif //PISANO_ROARING_BITMAP_HPP
@@ -0,0 +1,178 @@
+/*
+ * @FileName   : thread_pool.hpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: bounded work-stealing thread pool. Every worker owns a task deque, it runs its own tasks
+ *               in LIFO order and steals the oldest task of the other workers when its deque is empty.
+ *               Tasks submitted by a worker go to its own deque, so nested tasks stay on the same thread.
+ *               Use `wait` instead of `std::future::get` inside a task, the waiting thread keeps running
+ *               queued tasks so that nested waits never deadlock the pool.
+ */
+
+#ifndef PISANO_THREAD_POOL_HPP
+#define PISANO_THREAD_POOL_HPP
+
+#include <mutex>
+#include <deque>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <condition_variable>
+
+namespace inno {
+
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+public:
+    /* start @thread_num workers, 0 means all hardware threads */
+    explicit ThreadPool(std::size_t thread_num = 0) : stop_(false), pending_(0), next_(0) {
+        if (thread_num == 0) {
+            thread_num = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (std::size_t i = 0; i < thread_num; ++i) {
+            queues_.emplace_back(new WorkQueue());
+        }
+        for (std::size_t i = 0; i < thread_num; ++i) {
+            workers_.emplace_back(&ThreadPool::work_, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto &worker : workers_) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /* the pool shared by the whole process, which has a worker per hardware thread */
+    static std::shared_ptr<ThreadPool> Shared() {
+        static std::shared_ptr<ThreadPool> pool = std::make_shared<ThreadPool>();
+        return pool;
+    }
+
+    std::size_t size() const { return workers_.size(); }
+
+    /* run @function(@args...) on the pool, the arguments are copied like `std::async` does */
+    template<typename Function, typename... Args>
+    std::future<typename std::result_of<Function(Args...)>::type>
+    submit(Function &&function, Args &&...args) {
+        using Result = typename std::result_of<Function(Args...)>::type;
+        auto task = std::make_shared<std::packaged_task<Result()>>(
+                std::bind(std::forward<Function>(function), std::forward<Args>(args)...));
+        std::future<Result> future = task->get_future();
+        push_([task]() { (*task)(); });
+        return future;
+    }
+
+    /* wait for @future and return its value, queued tasks are run by the calling thread meanwhile,
+     * so a task which takes a lock mustn't share a pool with the threads that wait while holding it */
+    template<typename T>
+    T wait(std::future<T> &future) {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            Task task;
+            if (pop_(current_index_(), task)) {
+                task();
+            } else {
+                future.wait_for(std::chrono::microseconds(100));
+            }
+        }
+        return future.get();
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    /* the pool and the worker index of the current thread */
+    static std::pair<const ThreadPool *, std::size_t> &current_() {
+        static thread_local std::pair<const ThreadPool *, std::size_t> current{nullptr, 0};
+        return current;
+    }
+
+    std::size_t current_index_() const {
+        return current_().first == this ? current_().second : next_.fetch_add(1) % queues_.size();
+    }
+
+    void push_(Task task) {
+        {
+            // count the task before it becomes visible, so that `pending_` never drops below zero
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++pending_;
+        }
+        auto &queue = *queues_[current_index_()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.emplace_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    /* pop the newest task of worker @index, or steal the oldest one from the other workers */
+    bool pop_(const std::size_t &index, Task &task) {
+        for (std::size_t i = 0; i < queues_.size(); ++i) {
+            auto &queue = *queues_[(index + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            --pending_;
+            return true;
+        }
+        return false;
+    }
+
+    void work_(const std::size_t index) {
+        current_() = {this, index};
+        while (true) {
+            Task task;
+            if (pop_(index, task)) {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stop_ || pending_ > 0; });
+            if (stop_ && pending_ == 0) {
+                return;
+            }
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_;
+    std::atomic<std::size_t> pending_;   // tasks which are queued but not popped yet
+    mutable std::atomic<std::size_t> next_;
+};
+
+}
+
+#endif //PISANO_THREAD_POOL_HPP
@@ -11,12 +11,17 @@
 
 #include <set>
 #include <deque>
+#include <cstdint>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <utility>
 #include <unordered_set>
 #include <unordered_map>
 
+#include "common/id_span.hpp"
+#include "common/binding_table.hpp"
+
 namespace inno {
 
 enum query_type {
@@ -30,13 +35,17 @@ enum query_type {
     SINGLE_S,   // that's the first query triplet for the whole query statement
     SINGLE_O,   // that's the first query triplet for the whole query statement
     SINGLE_SO,  // that's the first query triplet for the whole query statement
+
+    LEAPFROG_S,  // S is a variable of the cyclic part of the query, which is joined at once with the ones after it
+    LEAPFROG_O,  // O is a variable of the cyclic part of the query, which is joined at once with the ones after it
+    LEAPFROG_SO, // S and O are variables of the cyclic part of the query, which is joined at once with the ones after it
 };
 
 using Triplet = std::tuple<std::string, std::string, std::string>;
 
 using ResultSet = std::set<std::vector<std::string>>;
 
-using TempResult = std::vector<std::unordered_map<uint32_t, uint32_t>>;
+using TempResult = inno::BindingTable;  // row of variable slot -> entity id
 using TripletId = std::tuple<uint32_t, uint32_t, uint32_t>;  // (Subject, Predicate, Object)
 using QueryItem = std::tuple<inno::TripletId, inno::query_type>;// (TripletId tuple, QueryType, Join/Filter Variable Id)
 using QueryQueue = std::deque<inno::QueryItem>;
@@ -9,6 +9,12 @@
 #ifndef RETRIEVE_SYSTEM_UTILS_HPP
 #define RETRIEVE_SYSTEM_UTILS_HPP
 
+#include <cctype>
+#include <limits>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
 // DEPRECATION !!
 #define TIMEIT( CODE, RECORD ) do { \
             auto start_time = std::chrono::high_resolution_clock::now(); \
@@ -20,6 +26,40 @@
 
 namespace inno {
 
+/* parse memory size such as `512M` or `8G` into bytes, plain number means bytes */
+inline bool parseMemorySize(const std::string &text, size_t &bytes) {
+    // `std::stoull` skips spaces and accepts a sign, a negative number wraps around
+    if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0]))) {
+        return false;
+    }
+    size_t pos = 0;
+    unsigned long long value = 0;
+    try {
+        value = std::stoull(text, &pos);
+    } catch (const std::exception &) {
+        return false;
+    }
+    std::string unit = text.substr(pos);
+    unsigned shift = 0;
+    if (!unit.empty() && unit != "B" && unit != "b") {
+        switch (unit[0]) {
+            case 'K': case 'k': shift = 10; break;
+            case 'M': case 'm': shift = 20; break;
+            case 'G': case 'g': shift = 30; break;
+            case 'T': case 't': shift = 40; break;
+            default: return false;
+        }
+        if (unit.size() > 2 || (unit.size() == 2 && unit[1] != 'B' && unit[1] != 'b')) {
+            return false;
+        }
+    }
+    if (value > (std::numeric_limits<size_t>::max() >> shift)) {
+        return false;
+    }
+    bytes = static_cast<size_t>(value) << shift;
+    return true;
+}
+
 /* RECOMMEND!! timing function */
 template<typename Function, typename... Types>
 decltype(auto) timeit(Function &&function, Types &&...args) {
@@ -0,0 +1,232 @@
+/*
+ * @FileName   : csr_index.hpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: compressed-sparse-row index of <key, value> pairs under one predicate,
+ *               `keys` holds the sorted distinct keys, `offsets[i] .. offsets[i + 1]` is the range of positions
+ *               of the values of `keys[i]`. The values are a delta + variable-byte compressed stream with
+ *               skip pointers (see `IdSpan`), or a plain array for triplet files of version 2.
+ *               The arrays are either owned by the index or point into a memory-mapped triplet file.
+ *               Keys with at least `BITMAP_MIN_SIZE` values also get a `RoaringBitmap` of their values,
+ *               which is built by the first `bitmap` call, for constant time membership tests.
+ *               Removed pairs are tombstoned: they are hidden from every read but stay in the arrays
+ *               until the index is rebuilt or saved. Inserted pairs are kept in a delta overlay beside the arrays,
+ *               which every read merges in, until the index is rebuilt or saved likewise.
+ */
+
+#ifndef PISANO_CSR_INDEX_HPP
+#define PISANO_CSR_INDEX_HPP
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <iterator>
+#include <unordered_map>
+
+#include "common/type.hpp"
+#include "common/roaring_bitmap.hpp"
+
+namespace inno {
+
+class CsrIndex {
+public:
+    static const std::size_t BITMAP_MIN_SIZE = 1024;
+
+    class iterator;
+    class Writer;
+
+public:
+    CsrIndex();
+    ~CsrIndex();
+
+    /* build the index from <key, value> pairs, @pairs will be sorted in place */
+    static CsrIndex Build(std::vector<std::pair<uint32_t, uint32_t>> &pairs);
+
+    /* load the index from triplet file @path, the file is memory-mapped rather than parsed */
+    static bool Load(const std::string &path, CsrIndex &index);
+
+    /* store the index into triplet file @path */
+    bool save(const std::string &path) const;
+
+    /* format version of triplet file @path, 0 means a legacy text file */
+    static uint32_t FileVersion(const std::string &path);
+    static uint32_t CurrentFileVersion();
+
+    /* values of @key, empty span if @key doesn't exist */
+    IdSpan get(const uint32_t &key) const;
+    bool contains(const uint32_t &key, const uint32_t &value) const;
+
+    /* bitmap of the values of @key, nullptr if @key has less than `BITMAP_MIN_SIZE` values, tombstones
+     * or inserted values. The bitmaps of all keys are built by the first call, which is thread-safe */
+    const RoaringBitmap *bitmap(const uint32_t &key) const;
+
+    /* tombstone every occurrence of the <key, value> pairs of @pairs, return the number of hidden pairs */
+    std::size_t remove(std::vector<std::pair<uint32_t, uint32_t>> pairs);
+
+    /* number of the pairs hidden by tombstones */
+    std::size_t tombstoneSize() const { return hidden_; }
+
+    /* add the <key, value> pairs of @pairs to the delta overlay, return the number of inserted pairs.
+     * A pair whose value is tombstoned under its key would be hidden, so the index is rebuilt then */
+    std::size_t insert(std::vector<std::pair<uint32_t, uint32_t>> pairs);
+
+    /* number of the pairs in the delta overlay */
+    std::size_t deltaSize() const { return delta_ ? delta_->size : 0; }
+
+    /* whether @other is a copy of this index, that is, both have the same storage, tombstones and delta */
+    bool sharesState(const CsrIndex &other) const {
+        return holder_ == other.holder_ && tombstones_ == other.tombstones_ && delta_ == other.delta_;
+    }
+
+    IdSpan keys() const;
+    std::vector<std::pair<uint32_t, uint32_t>> pairs() const;
+
+    std::size_t size() const { return size_ + deltaSize() - hidden_; }
+    /* number of the keys, including the ones whose pairs are all tombstoned */
+    std::size_t keySize() const { return key_size_ + (delta_ ? delta_->keys.size() : 0); }
+    bool empty() const { return size() == 0; }
+
+    /* bytes taken by the arrays of the index */
+    std::size_t memoryUsage() const;
+
+    iterator begin() const;
+    iterator end() const;
+
+private:
+    /* sorted distinct tombstoned values of a key and the number of their occurrences */
+    struct Tombstone {
+        std::vector<uint32_t> values;
+        std::size_t hidden = 0;
+    };
+
+    /* inserted pairs, the sorted values of every key and the sorted keys which aren't stored in the arrays */
+    struct Delta {
+        std::unordered_map<uint32_t, std::vector<uint32_t>> values;
+        std::vector<uint32_t> keys;
+        std::size_t size = 0;
+    };
+
+    IdSpan values_at_(const std::size_t &key_idx) const;
+    /* merge the inserted values of @key into @values and hide its tombstoned ones */
+    void overlay_(const uint32_t &key, IdSpan &values) const;
+    void build_bitmaps_() const;
+
+    /* the bitmaps of the stored arrays, shared by the copies of the index and built once on demand */
+    struct Bitmaps {
+        std::once_flag built;
+        std::unordered_map<uint32_t, RoaringBitmap> values;
+        std::atomic<std::size_t> usage{0};   // bytes taken by `values`, set once they are built
+    };
+
+    /* the state of encoding sorted <key, value> pairs into the compressed layout */
+    struct EncodeState {
+        uint64_t key_size = 0;
+        uint64_t size = 0;
+        uint64_t byte_size = 0;
+        uint32_t last_key = 0;
+        uint32_t last_value = 0;
+    };
+
+    template<typename Sink>
+    static void encode_(EncodeState &state, Sink &sink, const uint32_t &key, const uint32_t &value);
+
+public:
+    /* iterate all <key, value> pairs in order */
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<uint32_t, uint32_t>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type *;
+        using reference = value_type;
+
+    public:
+        iterator(const CsrIndex *index, IdSpan::iterator key)
+            : index_(index), key_(key), key_end_(index->keys().end()) { load_(); }
+
+        value_type operator*() const {
+            return {*key_, *value_};
+        }
+
+        iterator &operator++() {
+            if (++value_ == value_end_) {
+                ++key_;
+                load_();
+            }
+            return *this;
+        }
+
+        bool operator==(const iterator &other) const {
+            return key_ == other.key_ && (key_ == key_end_ || value_ == other.value_);
+        }
+        bool operator!=(const iterator &other) const { return !(*this == other); }
+
+    private:
+        /* move to the first value of the current key, the keys whose values are all tombstoned are skipped */
+        void load_() {
+            for (; key_ != key_end_; ++key_) {
+                IdSpan values = index_->get(*key_);
+                if (!values.empty()) {
+                    value_ = values.begin();
+                    value_end_ = values.end();
+                    return;
+                }
+            }
+        }
+
+    private:
+        const CsrIndex *index_;
+        IdSpan::iterator key_;
+        IdSpan::iterator key_end_;
+        IdSpan::iterator value_;
+        IdSpan::iterator value_end_;
+    };
+
+    /* write a triplet file from <key, value> pairs appended in sorted order,
+     * the pairs are streamed into temporary files instead of being held in memory */
+    class Writer {
+    public:
+        explicit Writer(const std::string &path);
+        ~Writer();
+
+        void append(const uint32_t &key, const uint32_t &value);
+        bool close();
+
+    private:
+        struct FileSink;
+
+        std::string path_;
+        std::ofstream keys_;
+        std::ofstream offsets_;
+        std::ofstream block_offsets_;
+        std::ofstream block_first_;
+        std::ofstream bytes_;
+        EncodeState state_;
+        bool closed_;
+    };
+
+private:
+    std::shared_ptr<const void> holder_; // owns the arrays, either vectors or the mapped file
+    const uint32_t *keys_;
+    const uint32_t *offsets_;
+    const uint32_t *values_;             // plain values of a version 2 file, nullptr if compressed
+    const uint8_t *bytes_;               // compressed values
+    const uint64_t *block_offsets_;      // byte offset of every block of `IdSpan::BLOCK_SIZE` values in `bytes_`
+    const uint32_t *block_first_;        // first value of every block
+    std::size_t key_size_;
+    std::size_t size_;
+    std::size_t byte_size_;
+    std::shared_ptr<Bitmaps> bitmaps_;
+    std::shared_ptr<const std::unordered_map<uint32_t, Tombstone>> tombstones_;  // copied on write
+    std::size_t hidden_;
+    std::shared_ptr<const Delta> delta_;                                         // copied on write
+};
+
+}
+
+#endif //PISANO_CSR_INDEX_HPP
@@ -20,12 +20,15 @@
 #include <memory>
 
 #include "common/type.hpp"
+#include "database/csr_index.hpp"
+#include "database/statistics.hpp"
 
 namespace inno {
 
 class DatabaseBuilder {
 private:
     class Impl;
+    class Snapshot;
 
 public:
     class Option;
@@ -34,8 +37,14 @@ public:
     DatabaseBuilder();
     ~DatabaseBuilder();
 
-    /* create RDF database called @db_name from @data_file */
+    /* create RDF database called @db_name from @data_file,
+     * the file is tokenized and encoded by @thread_num threads (0 means all hardware threads).
+     * If @memory_limit (bytes) is not 0, the triplets are spilled to sorted runs on disk and merged into
+     * the triplet files, so only about @memory_limit bytes of triplets are held in memory at once */
     static std::shared_ptr<DatabaseBuilder::Option> Create(const std::string &db_name, const std::string &data_file);
+    static std::shared_ptr<DatabaseBuilder::Option>
+    Create(const std::string &db_name, const std::string &data_file,
+           const uint32_t &thread_num, const size_t &memory_limit = 0);
 
     /* load a RDF database named @db_name */
     static std::shared_ptr<DatabaseBuilder::Option>
@@ -45,12 +54,28 @@ public:
     static std::shared_ptr<DatabaseBuilder::Option>
     LoadPartial(const std::string &db_name, const std::vector<std::string> &predicate_indexed_list);
 
+    /* load a RDF database named @db_name whose predicates are paged in on first access,
+     * the least recently used predicates are evicted once the resident ones take more than @memory_limit bytes.
+     * Spans and indexes of a predicate stay valid until other predicates are accessed */
+    static std::shared_ptr<DatabaseBuilder::Option>
+    LoadLazy(const std::string &db_name, const size_t &memory_limit);
+
+    /* convert the triplet and entity files of an existing database @db_name into the current binary format */
+    static bool Convert(const std::string &db_name);
+
 public:
     class Option {
     public:
         explicit Option(std::shared_ptr<Impl> impl);
+        Option(std::shared_ptr<Impl> impl, std::shared_ptr<const Snapshot> snapshot);
         ~Option();
 
+        /* read-only view of the database as of the last finished write, which later writes never change.
+         * Reading a snapshot takes no lock and never waits for a writer, so snapshots can be read by many
+         * threads while another one writes. Writes through a snapshot go to the database itself */
+        std::shared_ptr<Option> snapshot();
+        bool isSnapshot() const { return snapshot_ != nullptr; }
+
         /* save the database data */
         bool save();
         bool save(const std::string &db_name);
@@ -58,10 +83,17 @@ public:
         /* unload the database */
         void unload();
 
-        /* insert RDF raw triplet, which is expressed as <s, p, o> */
+        /* insert RDF raw triplet, which is expressed as <s, p, o>.
+         * A single triplet stays in memory until `save`, a batch is made durable by the write-ahead log */
         bool insert(const std::string &subject, const std::string &predicate, const std::string &object);
         bool insert(const std::vector<std::tuple<std::string, std::string, std::string>> &triplets);
 
+        /* delete every copy of the triplets of @triplets, the batch is made durable by the write-ahead log */
+        bool remove(const std::vector<std::tuple<std::string, std::string, std::string>> &triplets);
+
+        /* checkpoint in the background once the write-ahead log takes more than @checkpoint_size bytes */
+        void setCheckpointSize(const size_t &checkpoint_size);
+
         /* get basic information of RDF db */
         uint32_t getPredicateSize();
         uint32_t getEntitySize();
@@ -90,24 +122,53 @@ public:
         uint32_t getEntityCountBy(const std::string &entity) const;
         uint32_t getEntityCountBy(const std::string &entity);
 
+        /* number of the triplets whose subject, or object, is the entity */
+        uint32_t getSubjectCountBy(const std::string &entity) const;
+        uint32_t getObjectCountBy(const std::string &entity) const;
+
         std::vector<uint32_t> getPredicateStatistics();
 
-        /* For querying */
-        std::unordered_set<uint32_t>
+        /* cardinality statistics of the pairs of @pid, which are kept up to date by the writes */
+        const PredicateStatistics &getStatisticsByP(const uint32_t &pid) const;
+
+        /* characteristic sets of the subjects, which are rebuilt by `save` once enough triplets changed */
+        const CharacteristicSets &getCharacteristicSets() const;
+
+        /* For querying, the returned spans are sorted and stay valid until the next write, the ones of a lazily
+         * loaded database while the predicate is loaded, and the ones of a snapshot as long as the snapshot */
+        IdSpan
         getSByPO(const uint32_t &pid, const uint32_t &oid);
 
-        std::unordered_set<uint32_t>
+        IdSpan
         getOBySP(const uint32_t &sid, const uint32_t &pid);
 
-        const std::unordered_multimap<uint32_t, uint32_t> &
+        /* subjects of <@pid, @oid> as a bitmap, nullptr if the object has too few subjects to keep one */
+        const RoaringBitmap *
+        getSBitmapByPO(const uint32_t &pid, const uint32_t &oid);
+
+        /* subject -> objects index of @pid, use `get(sid)` for the range of objects of a subject */
+        const CsrIndex &
         getS2OByP(const uint32_t &pid);
-        std::unordered_multimap<uint32_t, uint32_t>
+        /* object -> subjects index of @pid, use `get(oid)` for the range of subjects of an object */
+        const CsrIndex &
         getO2SByP(const uint32_t &pid);
 
 //        std::set<std::pair<uint32_t, uint32_t>> getSOByP(const uint32_t &pid);
 
+    private:
+        /* the snapshot read by the getters and the generation of the database it was taken at */
+        struct View {
+            std::shared_ptr<const Snapshot> snapshot;
+            uint64_t generation;
+        };
+
+        std::shared_ptr<const Snapshot> view_() const;
+
     private:
         std::shared_ptr<Impl> impl_;
+        std::shared_ptr<const Snapshot> snapshot_;
+        // read and replaced by `std::atomic_load` and `std::atomic_store`, the getters may run concurrently
+        mutable std::shared_ptr<const View> current_;
     };
 };
 
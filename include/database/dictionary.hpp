@@ -0,0 +1,133 @@
+/*
+ * @FileName   : dictionary.hpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: compact string dictionary which maps terms to ids (starting from 1) and back.
+ *               Terms are sorted and front-coded in blocks of `BLOCK_SIZE`: the first term of a block is
+ *               stored in full, every following one as <shared prefix length, suffix>, which compresses the
+ *               long common prefixes of IRIs. `rank2id` and `id2rank` connect the sorted rank with the id,
+ *               and an open-addressing hash table of <fingerprint, id> answers term -> id lookups.
+ *               All of them are stored in the file as they are in memory, so a saved dictionary is
+ *               memory-mapped and usable at once, without parsing or rebuilding hash tables.
+ *               Newly inserted terms are kept in a hash map tail until `compact` merges them into the blocks.
+ *               `append` stores the terms inserted since the last store into a tail file next to the dictionary
+ *               file, so storing a few new terms doesn't rewrite the blocks, `Load` reads them back into the tail.
+ */
+
+#ifndef PISANO_DICTIONARY_HPP
+#define PISANO_DICTIONARY_HPP
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <unordered_map>
+
+namespace inno {
+
+class Dictionary {
+public:
+    static const uint32_t BLOCK_SIZE = 16;
+    // the tail file is merged into the blocks once it holds more than 1 / `TAIL_RATIO` of the stored terms
+    static const uint32_t TAIL_RATIO = 8;
+
+public:
+    Dictionary();
+    ~Dictionary();
+
+    Dictionary(Dictionary &&) = default;
+    Dictionary &operator=(Dictionary &&) = default;
+    Dictionary(const Dictionary &) = delete;
+    Dictionary &operator=(const Dictionary &) = delete;
+
+    /* load the dictionary from file @path, the file is memory-mapped rather than parsed.
+     * The terms of its tail file are inserted, except the ones whose ids are over @size */
+    static bool Load(const std::string &path, Dictionary &dictionary,
+                     const uint32_t &size = std::numeric_limits<uint32_t>::max());
+
+    /* merge the tail into the blocks, then store the dictionary into file @path and remove its tail file */
+    bool save(const std::string &path);
+
+    /* store the terms inserted since the dictionary was loaded from or stored into file @path by appending them
+     * to its tail file, the dictionary is saved as a whole instead if it has never been or the tail gets long */
+    bool append(const std::string &path);
+
+    /* whether `append` appends to the tail file rather than saving the dictionary as a whole */
+    bool appendable() const { return file_size_ > 0 && size() - file_size_ <= file_size_ / TAIL_RATIO; }
+
+    /* the tail file of dictionary file @path */
+    static std::string TailPath(const std::string &path);
+
+    /* number of the terms stored into the dictionary file and its tail file */
+    uint32_t storedSize() const { return static_cast<uint32_t>(stored_size_); }
+
+    /* format version of dictionary file @path, 0 means a legacy text file */
+    static uint32_t FileVersion(const std::string &path);
+    static uint32_t CurrentFileVersion();
+
+    /* id of @term, 0 if it doesn't exist */
+    uint32_t find(const std::string &term) const;
+
+    /* id of @term, throw `std::out_of_range` if it doesn't exist */
+    uint32_t getId(const std::string &term) const;
+
+    /* term of @id, throw `std::out_of_range` if it doesn't exist */
+    std::string getTerm(const uint32_t &id) const;
+
+    /* insert @term with the next id if it doesn't exist, return its id and whether it is inserted */
+    std::pair<uint32_t, bool> insert(const std::string &term);
+
+    /* merge the terms inserted since the last compaction into the front-coded blocks */
+    void compact();
+
+    void clear();
+
+    /* copy of the terms merged into the blocks, which shares their storage with this dictionary.
+     * The tail isn't copied, so the copy is cheap and never changes when terms are inserted here */
+    Dictionary compacted() const;
+
+    /* whether @other is or was copied from the same blocks as this dictionary */
+    bool sharesBlocks(const Dictionary &other) const { return holder_ == other.holder_; }
+
+    /* number of the terms merged into the blocks, their ids are 1 .. `compactedSize()` */
+    uint32_t compactedSize() const { return static_cast<uint32_t>(size_); }
+
+    uint32_t size() const { return static_cast<uint32_t>(size_ + tail_.size()); }
+    bool empty() const { return size() == 0; }
+
+private:
+    uint32_t find_in_buckets_(const std::string &term) const;
+    uint32_t find_in_blocks_(const std::string &term) const;
+    int compare_block_head_(const uint64_t &block, const std::string &term) const;
+
+    /* call @func(term, id) for every term in the blocks, in sorted order */
+    template<typename Func>
+    void for_each_(Func func) const;
+
+private:
+    std::shared_ptr<const void> holder_; // owns the arrays below, either vectors or the loaded file
+    const char *heap_;                   // front-coded blocks
+    const uint64_t *block_offsets_;      // [block_size_ + 1], offset of every block inside `heap_`
+    const uint32_t *rank2id_;            // [size_], id of the term with sorted rank
+    const uint32_t *id2rank_;            // [size_], sorted rank of the term with id - 1
+    const uint64_t *buckets_;            // [bucket_size_], `fingerprint << 32 | id` of a term, 0 means empty
+    uint64_t block_size_;
+    uint64_t bucket_size_;               // power of 2, 0 if the file has no hash table
+    uint64_t size_;
+
+    // the stored dictionary file has `file_size_` terms, its tail file has the next ones up to `stored_size_`
+    // in `tail_file_bytes_` bytes
+    uint64_t file_size_;
+    uint64_t stored_size_;
+    uint64_t tail_file_bytes_;
+
+    std::unordered_map<std::string, uint32_t> tail_map_;
+    std::vector<const std::string *> tail_;  // id - size_ - 1 -> key of `tail_map_`
+};
+
+}
+
+#endif //PISANO_DICTIONARY_HPP
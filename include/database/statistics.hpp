@@ -0,0 +1,100 @@
+/*
+ * @FileName   : statistics.hpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: cardinality statistics of the pairs of one predicate, which the query planner estimates the sizes
+ *               of triplet patterns with. Either side (subjects and objects) keeps its number of distinct keys,
+ *               the keys with the most pairs (heavy hitters) with their degrees, and a histogram of the degrees
+ *               in power-of-2 buckets, where the degree of a key is its number of pairs.
+ *               The characteristic sets of the subjects group the subjects by the set of their predicates,
+ *               which estimates the size of a star of patterns on one subject without assuming that
+ *               the predicates are independent.
+ */
+
+#ifndef PISANO_STATISTICS_HPP
+#define PISANO_STATISTICS_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <functional>
+
+#include "database/csr_index.hpp"
+
+namespace inno {
+
+class PredicateStatistics {
+public:
+    static const uint32_t HEAVY_HITTER_SIZE = 16;
+
+    /* summary of the degrees of the keys of one side */
+    struct Side {
+        uint32_t distinct = 0;
+        std::vector<std::pair<uint32_t, uint32_t>> heavy_hitters;   // <key, degree> in descending degree
+        std::vector<uint32_t> histogram;                            // [i]: keys whose degree is in [2^i, 2^(i+1))
+
+        /* estimated degree of @key among @size pairs, exact for a heavy hitter, the average of the others else */
+        double degree(const uint32_t &key, const uint64_t &size) const;
+
+        /* account @count removed pairs of @key, which has no pairs left if @emptied.
+         * The histogram isn't changed, it is summarized again by `Compute` */
+        void remove(const uint32_t &key, const uint32_t &count, const bool &emptied);
+    };
+
+public:
+    /* statistics of the pairs of @s2o, @o2s is the reverse index of it */
+    static PredicateStatistics Compute(const CsrIndex &s2o, const CsrIndex &o2s);
+
+    /* store the statistics of every predicate, indexed by pid, into file @path */
+    static bool Store(const std::string &path, const std::vector<PredicateStatistics> &statistics);
+    static bool Load(const std::string &path, std::vector<PredicateStatistics> &statistics);
+
+    /* estimated number of the objects of subject @sid, and of the subjects of object @oid */
+    double objectsOf(const uint32_t &sid) const { return subjects.degree(sid, size); }
+    double subjectsOf(const uint32_t &oid) const { return objects.degree(oid, size); }
+
+    /* whether the pairs have been summarized, the predicates of databases built by older versions haven't */
+    bool known() const { return size == 0 || subjects.distinct > 0; }
+
+public:
+    uint64_t size = 0;      // number of pairs
+    Side subjects;
+    Side objects;
+};
+
+class CharacteristicSets {
+public:
+    /* the subjects which have exactly the predicates of `predicates` */
+    struct Set {
+        std::vector<uint32_t> predicates;   // sorted pids
+        std::vector<uint64_t> occurrences;  // [i]: number of the pairs of `predicates[i]` of the subjects
+        uint64_t count = 0;                 // number of the subjects
+    };
+
+    /* <pid, selectivity> of a pattern of a star, the selectivity is the fraction of the pairs of the predicate
+     * which match the object of the pattern, 1 for a variable */
+    using Pattern = std::pair<uint32_t, double>;
+
+public:
+    /* compute the sets from the subject -> objects index of every predicate, @index_of gives the one of a pid */
+    static CharacteristicSets Compute(const uint32_t &predicate_size,
+                                      const std::function<CsrIndex(const uint32_t &)> &index_of);
+
+    bool save(const std::string &path) const;
+    static bool Load(const std::string &path, CharacteristicSets &sets);
+
+    /* estimated number of the results of the star of @patterns on one subject variable */
+    double estimate(const std::vector<Pattern> &patterns) const;
+
+    const std::vector<Set> &sets() const { return sets_; }
+    bool empty() const { return sets_.empty(); }
+
+private:
+    std::vector<Set> sets_;     // in descending `count`
+};
+
+}
+
+#endif //PISANO_STATISTICS_HPP
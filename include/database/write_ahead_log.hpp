@@ -0,0 +1,67 @@
+/*
+ * @FileName   : write_ahead_log.hpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: append-only write-ahead log of inserted and deleted triplets. Every batch is one record with
+ *               a sequence number and a checksum, and is flushed to disk before the insertion or deletion
+ *               returns, so a batch costs one sequential write instead of rewriting the database files.
+ *               On load the records newer than the last checkpoint are replayed, a torn record at the end,
+ *               which is left by a crash during an append, is dropped. A checkpoint stores the database files
+ *               together with the last sequence number, then empties the log.
+ */
+
+#ifndef PISANO_WRITE_AHEAD_LOG_HPP
+#define PISANO_WRITE_AHEAD_LOG_HPP
+
+#include <tuple>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <functional>
+
+namespace inno {
+
+class WriteAheadLog {
+public:
+    enum Operation { INSERT, REMOVE };
+
+    using Triplet = std::tuple<std::string, std::string, std::string>;
+    using ReplayFunc = std::function<void(const Operation &, const std::vector<Triplet> &)>;
+
+public:
+    WriteAheadLog();
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+    /* open log @path for appending, the file is created if it doesn't exist.
+     * The batches of the records after sequence number @checkpoint are passed to @replay in order */
+    bool open(const std::string &path, const uint64_t &checkpoint, const ReplayFunc &replay);
+    void close();
+    bool isOpen() const { return file_ != nullptr; }
+
+    /* append @operation of @triplets as one record and flush it to disk, return its sequence number, 0 on failure */
+    uint64_t append(const Operation &operation, const std::vector<Triplet> &triplets);
+
+    /* drop all records, they are covered by a checkpoint now */
+    bool reset();
+
+    /* sequence number of the last record */
+    uint64_t sequence() const { return sequence_; }
+
+    /* bytes of the records in the log */
+    uint64_t size() const { return size_; }
+
+private:
+    std::string path_;
+    std::FILE *file_;
+    uint64_t sequence_;
+    uint64_t size_;
+};
+
+}
+
+#endif //PISANO_WRITE_AHEAD_LOG_HPP
@@ -16,6 +16,9 @@
 namespace inno {
 
 class SparqlParser {
+public:
+    static const std::size_t NO_LIMIT = static_cast<std::size_t>(-1);
+
 public:
     SparqlParser();
     ~SparqlParser();
@@ -28,7 +31,12 @@ public:
     std::vector<std::string> getPredicateIndexedList() const;
     std::vector<Triplet> getInsertTriplets();
     std::vector<Triplet> getInsertTriplets() const;
+    /* triplets of DELETE DATA, or the pattern of DELETE WHERE whose variables are bound by querying it */
+    std::vector<Triplet> getDeleteTriplets() const;
     bool isDistinctQuery();
+    /* LIMIT and OFFSET of a SELECT, `NO_LIMIT` and 0 if it has none */
+    std::size_t getLimit() const;
+    std::size_t getOffset() const;
 
 private:
     class Impl;
@@ -0,0 +1,112 @@
+/*
+ * @FileName   : hash_distinct.hpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: DISTINCT on rows of entity ids. The rows are hashed into `1 << PARTITION_BITS` partitions,
+ *               each one an open-addressing table over its flat rows, so a row is told new or duplicated as
+ *               soon as it is inserted and the result can stream. Once the tables grow over the memory limit
+ *               the largest partition is spilled into a temporary file, its later rows are deferred to
+ *               `finish`, which deduplicates the spilled partitions one by one, several at once on a pool.
+ *               A spilled partition whose rows don't fit into its share of the limit is split again on the
+ *               next bits of the hash, so `finish` keeps under the limit as well. The spill files are unbuffered,
+ *               the records are buffered here instead, so a failed write tells which rows aren't written and the
+ *               deferred rows of a partition which cannot be written any more are kept in memory.
+ */
+
+#ifndef PISANO_HASH_DISTINCT_HPP
+#define PISANO_HASH_DISTINCT_HPP
+
+#include <cstdio>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "common/thread_pool.hpp"
+#include "common/binding_table.hpp"
+
+namespace inno {
+
+class HashDistinct {
+public:
+    static const uint32_t PARTITION_BITS = 6;
+    // a spilled partition is split at most `MAX_LEVEL` times, until the bits of the hash are used up
+    static const uint32_t MAX_LEVEL = 64 / PARTITION_BITS - 1;
+    static const std::size_t DEFAULT_MEMORY_LIMIT = std::size_t(256) << 20;
+    // records buffered before they are written into a spill file, about the size of a stdio buffer
+    static const std::size_t BUFFER_RECORDS = 256;
+
+    enum Status {
+        NEW,        // the row is seen for the first time
+        DUPLICATE,  // the row is seen already
+        DEFERRED,   // the partition of the row is spilled, it is told by `finish`
+    };
+
+public:
+    /* rows of @width ids, the tables in memory are kept under @memory_limit bytes */
+    explicit HashDistinct(std::size_t width, std::size_t memory_limit = DEFAULT_MEMORY_LIMIT);
+    ~HashDistinct();
+
+    HashDistinct(const HashDistinct &) = delete;
+    HashDistinct &operator=(const HashDistinct &) = delete;
+
+    Status insert(const uint32_t *row);
+
+    /* hand the new ones of the deferred rows to @emit until it returns false, false is returned then.
+     * The spilled partitions are deduplicated up to @parallelism at a time on @pool, each of them within
+     * an equal share of the memory limit. It is called once after the last `insert` */
+    bool finish(const std::function<bool(const uint32_t *)> &emit,
+                ThreadPool *pool = nullptr, std::size_t parallelism = 1);
+
+    std::size_t memoryUsage() const { return memory_; }
+    std::size_t spilledPartitions() const;
+
+private:
+    struct Table {
+        std::vector<uint32_t> rows;   // flat rows
+        std::vector<uint32_t> slots;  // index + 1 of a row, 0 means empty, the size is a power of 2
+        std::size_t size = 0;
+
+        /* insert @row if it is new */
+        bool insert(const uint32_t *row, const std::size_t &width, const uint64_t &hash);
+        std::size_t memoryUsage() const;
+    };
+
+    struct Partition {
+        Table table;
+        std::FILE *spill = nullptr;    // records of a flag and a row, the flag tells whether it was emitted
+        std::vector<uint32_t> buffer;  // deferred records which aren't written into `spill` yet
+        Table deferred;                // deferred rows kept in memory once a write into `spill` failed
+        bool failed = false;
+    };
+
+    static uint64_t Hash(const uint32_t *row, const std::size_t &width);
+
+    /* a temporary file without a stdio buffer, nullptr if it cannot be created */
+    static std::FILE *CreateSpill();
+    /* write the records of @buffer into @file, the ones which aren't written whole are left in @buffer */
+    static bool Write(std::FILE *file, std::vector<uint32_t> &buffer, const std::size_t &record_size);
+
+    /* write the buffered records of spilled @partition, they are kept in memory if the write fails */
+    void flush_(Partition &partition);
+
+    /* move the largest partition in memory into a temporary file */
+    bool spill_();
+
+    /* append the rows of spilled partition @file which weren't emitted before and are new to @output.
+     * The partition is split into the next @level if its rows take more than @budget bytes */
+    void deduplicate_(std::FILE *file, const uint32_t &level, const std::size_t &budget,
+                      BindingTable &output) const;
+    /* same as `deduplicate_`, the deferred rows kept in memory by @partition come after the ones of its file */
+    void deduplicate_(const Partition &partition, const std::size_t &budget, BindingTable &output) const;
+
+private:
+    std::size_t width_;
+    std::size_t memory_limit_;
+    std::size_t memory_;
+    std::vector<Partition> partitions_;
+};
+
+}
+
+#endif //PISANO_HASH_DISTINCT_HPP
@@ -0,0 +1,65 @@
+/*
+ * @FileName   : join_optimizer.hpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: cost-based join order of the patterns of a query. The result size of every subset of the
+ *               patterns is estimated from the statistics of their predicates: the join on a variable keeps
+ *               1 / max of the distinct values of its sides, and a star on one subject variable is estimated
+ *               by the characteristic sets instead. The order with the least sum of the intermediate result
+ *               sizes is found by dynamic programming over the subsets for up to `DP_LIMIT` patterns, larger
+ *               queries are ordered greedily by the smallest next intermediate result.
+ */
+
+#ifndef PISANO_JOIN_OPTIMIZER_HPP
+#define PISANO_JOIN_OPTIMIZER_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "common/type.hpp"
+#include "database/database.hpp"
+#include "database/statistics.hpp"
+
+namespace inno {
+
+class JoinOptimizer {
+public:
+    static const std::size_t DP_LIMIT = 12;
+
+    /* the cardinality model of one pattern */
+    struct Pattern {
+        double size = 0;                                        // estimated number of matches
+        std::vector<std::pair<std::string, double>> variables;  // <variable, estimated distinct values>
+        std::string subject;                                    // subject variable, empty if it is bound
+        CharacteristicSets::Pattern star{0, 1};                 // the pattern as a part of the star of `subject`
+    };
+
+public:
+    JoinOptimizer(std::vector<Pattern> patterns, const CharacteristicSets &characteristic_sets);
+
+    /* the model of @triplet from the statistics of @db, the predicate of @triplet must be bound */
+    static Pattern Estimate(const DatabaseBuilder::Option &db, const Triplet &triplet);
+
+    /* estimated result size of the join of the patterns of @subset, which are indexes of the patterns */
+    double estimate(const std::vector<std::size_t> &subset) const;
+
+    /* the order to evaluate the patterns in, as indexes of the patterns */
+    std::vector<std::size_t> order() const;
+
+private:
+    std::vector<std::size_t> order_by_subsets_() const;
+    std::vector<std::size_t> order_greedily_() const;
+
+    /* whether the patterns @a and @b share a variable */
+    bool connected_(const std::size_t &a, const std::size_t &b) const;
+
+private:
+    std::vector<Pattern> patterns_;
+    const CharacteristicSets &characteristic_sets_;
+};
+
+}
+
+#endif //PISANO_JOIN_OPTIMIZER_HPP
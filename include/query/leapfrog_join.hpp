@@ -0,0 +1,68 @@
+/*
+ * @FileName   : leapfrog_join.hpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: worst-case optimal multiway join of the patterns of a cyclic query (Leapfrog Triejoin).
+ *               The variables are bound one at a time in a global order, every pattern is a trie of its
+ *               sorted per-predicate index whose keys are the variable earlier in the order, and a value is
+ *               bound only if all the patterns on the variable have it. So no intermediate binding can be
+ *               extended by fewer than all of its patterns, which bounds the work by the AGM bound of the
+ *               patterns instead of the sizes of the pairwise joins.
+ */
+
+#ifndef PISANO_LEAPFROG_JOIN_HPP
+#define PISANO_LEAPFROG_JOIN_HPP
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "common/type.hpp"
+#include "database/csr_index.hpp"
+
+namespace inno {
+
+class LeapfrogJoin {
+public:
+    /* one pattern: the keys of `index` bind the slot `key_slot` and the values of a key bind `value_slot`.
+     * A pattern with a bound side has no index, its `values` bind `value_slot` and only filter it */
+    struct Atom {
+        const CsrIndex *index = nullptr;
+        uint32_t key_slot = 0;
+        uint32_t value_slot = 0;
+        IdSpan values;
+    };
+
+public:
+    /* @order lists the slots to bind, the key slot of every atom with an index must come before its value slot */
+    LeapfrogJoin(std::vector<Atom> atoms, std::vector<uint32_t> order);
+
+    /* extend every row of @input with the bindings matching all atoms, the slots bound in a row already are
+     * checked instead. A pair stored n times yields n rows, like the pairwise joins */
+    BindingTable join(const BindingTable &input) const;
+
+    /* like `join`, but hand the rows to @emit in tables of @batch_size rows at most, and stop once @emit
+     * returns false, false is returned then */
+    bool join(const BindingTable &input, const std::size_t &batch_size,
+              const std::function<bool(const BindingTable &)> &emit) const;
+
+private:
+    struct Output {
+        BindingTable rows;
+        std::size_t batch_size;
+        const std::function<bool(const BindingTable &)> &emit;
+    };
+
+    bool bind_(const std::size_t &level, uint32_t *row, const std::size_t &multiplicity, Output &output) const;
+
+private:
+    std::vector<Atom> atoms_;
+    std::vector<uint32_t> order_;
+    std::vector<std::vector<std::size_t>> keys_;    // atoms whose keys bind the slot of a level
+    std::vector<std::vector<std::size_t>> values_;  // atoms whose values bind the slot of a level
+};
+
+}
+
+#endif //PISANO_LEAPFROG_JOIN_HPP
@@ -0,0 +1,120 @@
+/*
+ * @FileName   : query_result.hpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: result of a query as a cursor over rows of entity ids, one id per query variable.
+ *               The terms are decoded from the dictionary only when a cell is read, so a large result keeps
+ *               4 bytes per cell until the caller walks it, and a row that is never read is never decoded.
+ *               The result holds the database it was queried from, so it stays readable on its own.
+ */
+
+#ifndef PISANO_QUERY_RESULT_HPP
+#define PISANO_QUERY_RESULT_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iterator>
+
+#include "common/type.hpp"
+#include "database/database.hpp"
+
+namespace inno {
+
+class QueryResult {
+public:
+    class Row;
+    class iterator;
+
+public:
+    QueryResult() = default;
+    /* @rows has a slot per variable of @variables, `BindingTable::UNBOUND` for a variable left unbound */
+    QueryResult(std::shared_ptr<DatabaseBuilder::Option> db, std::vector<std::string> variables, BindingTable rows);
+
+    const std::vector<std::string> &variables() const { return variables_; }
+    std::size_t size() const { return rows_.size(); }
+    bool empty() const { return rows_.empty(); }
+
+    Row operator[](const std::size_t &index) const;
+    iterator begin() const;
+    iterator end() const;
+
+    /* id of the variable @column in row @index */
+    uint32_t id(const std::size_t &index, const std::size_t &column) const {
+        return rows_.row(index)[column];
+    }
+
+    /* term of the variable @column in row @index, empty if it is unbound */
+    std::string term(const std::size_t &index, const std::size_t &column) const;
+
+    /* every row decoded, sorted and without duplicates */
+    ResultSet toResultSet() const;
+
+private:
+    std::shared_ptr<DatabaseBuilder::Option> db_;
+    std::vector<std::string> variables_;
+    BindingTable rows_{0};
+};
+
+/* one row of a `QueryResult`, which is valid as long as the result */
+class QueryResult::Row {
+public:
+    Row(const QueryResult *result, const std::size_t &index) : result_(result), index_(index) {}
+
+    std::size_t size() const { return result_->variables_.size(); }
+    uint32_t id(const std::size_t &column) const { return result_->id(index_, column); }
+    std::string operator[](const std::size_t &column) const { return result_->term(index_, column); }
+
+    /* all terms of the row */
+    std::vector<std::string> terms() const;
+
+private:
+    const QueryResult *result_;
+    std::size_t index_;
+};
+
+class QueryResult::iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Row;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Row *;
+    using reference = Row;
+
+    iterator(const QueryResult *result, const std::size_t &index) : result_(result), index_(index) {}
+
+    Row operator*() const { return {result_, index_}; }
+    iterator &operator++() {
+        ++index_;
+        return *this;
+    }
+    iterator operator++(int) {
+        iterator old = *this;
+        ++index_;
+        return old;
+    }
+    bool operator==(const iterator &other) const { return index_ == other.index_ && result_ == other.result_; }
+    bool operator!=(const iterator &other) const { return !(*this == other); }
+
+private:
+    const QueryResult *result_;
+    std::size_t index_;
+};
+
+inline QueryResult::Row QueryResult::operator[](const std::size_t &index) const {
+    return {this, index};
+}
+
+inline QueryResult::iterator QueryResult::begin() const {
+    return {this, 0};
+}
+
+inline QueryResult::iterator QueryResult::end() const {
+    return {this, size()};
+}
+
+}
+
+#endif //PISANO_QUERY_RESULT_HPP
@@ -14,6 +14,7 @@
 #include "database/database.hpp"
 #include "parser/sparql_parser.hpp"
 #include "common/type.hpp"
+#include "query/query_result.hpp"
 
 namespace inno {
 class SparqlQuery {
@@ -24,9 +25,18 @@ public:
     explicit SparqlQuery(const std::shared_ptr<DatabaseBuilder::Option> &db);
     ~SparqlQuery();
 
-    ResultSet query(SparqlParser &parser);
+    /* the rows of the query variables, their terms are decoded when they are read.
+     * A query reads a snapshot of the database taken when it starts, unless the database is one already */
+    QueryResult query(SparqlParser &parser);
+    /* delete the triplets of a DELETE DATA, or every match of the pattern of a DELETE WHERE */
+    bool remove(SparqlParser &parser);
     double getQueryTime() const;
 
+    /* number of threads a query runs on, 0 means all hardware threads. The inputs of every step are split
+     * into morsels taken by the workers of the shared pool, the default 1 runs queries on the calling thread */
+    void setParallelism(std::size_t parallelism);
+    std::size_t getParallelism() const;
+
 private:
     class Impl;
     std::shared_ptr<Impl> impl_;
@@ -13,27 +13,60 @@
 #include <spdlog/spdlog.h>
 #include <spdlog/pattern_formatter.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
+#include <boost/program_options.hpp>
 
 #include "database/database.hpp"
 #include "common/utils.hpp"
 
+namespace opt = boost::program_options;
+
 static const auto _ = []{
     spdlog::set_pattern("[%l]\t%v");
     return 0;
 }();
 
 int main (int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "./psoBuild <db_name> <raw_rdf_file_path>" << std::endl;
+    opt::options_description desc("./psoBuild <db_name> <raw_rdf_file_path> [thread_num]");
+    desc.add_options()
+            ("db_name", opt::value<std::string>(), "database name")
+            ("data_file", opt::value<std::string>(), "raw RDF file path")
+            ("thread-num,t", opt::value<uint32_t>()->default_value(0), "encoding threads, 0 means all hardware threads")
+            ("memory-limit,m", opt::value<std::string>(),
+             "build out of core with about this much memory for triplets, e.g. 512M, 8G")
+            ("help,h", "produce help message");
+    opt::positional_options_description positional;
+    positional.add("db_name", 1).add("data_file", 1).add("thread-num", 1);
+
+    opt::variables_map vm;
+    try {
+        opt::store(opt::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+        opt::notify(vm);
+    } catch (const opt::error &e) {
+        std::cerr << e.what() << std::endl << desc << std::endl;
         return 0;
     }
 
-    std::string dbname = argv[1];
-    std::string datafile = argv[2];
+    if (vm.count("help") || !vm.count("db_name") || !vm.count("data_file")) {
+        std::cerr << desc << std::endl;
+        return 0;
+    }
+
+    std::string dbname = vm["db_name"].as<std::string>();
+    std::string datafile = vm["data_file"].as<std::string>();
+    uint32_t thread_num = vm["thread-num"].as<uint32_t>();
+    size_t memory_limit = 0;
+    if (vm.count("memory-limit") && !inno::parseMemorySize(vm["memory-limit"].as<std::string>(), memory_limit)) {
+        std::cerr << "invalid memory limit '" << vm["memory-limit"].as<std::string>() << "'" << std::endl;
+        return 0;
+    }
 
     spdlog::info("create RDF database <{}> from path '{}'.", dbname, datafile);
 
-    auto ret = inno::timeit(inno::DatabaseBuilder::Create, dbname, datafile);
+    auto create = [](const std::string &dbname, const std::string &datafile,
+                     const uint32_t &thread_num, const size_t &memory_limit) {
+        return inno::DatabaseBuilder::Create(dbname, datafile, thread_num, memory_limit);
+    };
+    auto ret = inno::timeit(create, dbname, datafile, thread_num, memory_limit);
 
     spdlog::info("Used time: {} ms.", std::get<1>(ret));
 
@@ -0,0 +1,38 @@
+/*
+ * @FileName   : psoConvert.cpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: command-line tool for converting the text triplet and entity files of an existing database into binary format.
+ */
+
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include <spdlog/spdlog.h>
+
+#include "database/database.hpp"
+#include "common/utils.hpp"
+
+static const auto _ = []{
+    spdlog::set_pattern("[%l]\t%v");
+    return 0;
+}();
+
+int main (int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "./psoConvert <db_name>" << std::endl;
+        return 0;
+    }
+
+    std::string dbname = argv[1];
+
+    spdlog::info("convert RDF database <{}> into binary format.", dbname);
+
+    auto ret = inno::timeit(inno::DatabaseBuilder::Convert, dbname);
+
+    spdlog::info("Used time: {} ms.", std::get<1>(ret));
+
+    return std::get<0>(ret) ? 0 : 1;
+}
@@ -19,15 +19,23 @@
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
 
+#include "common/utils.hpp"
 #include "query/sparql_query.hpp"
 
 namespace opt = boost::program_options;
 namespace fs = boost::filesystem;
 
+// the handlers run concurrently, `db` is read and replaced atomically, every request reads its own snapshot of it
 std::shared_ptr<inno::DatabaseBuilder::Option> db;
-std::unique_ptr<inno::SparqlQuery> sparqlQuery;
-inno::SparqlParser parser;
 std::string db_name;
+size_t memory_limit = 0;  // 0 means loading all predicates, otherwise page them in lazily under this budget
+
+std::shared_ptr<inno::DatabaseBuilder::Option> loadRDFdb(const std::string &name) {
+    if (memory_limit > 0) {
+        return inno::DatabaseBuilder::LoadLazy(name, memory_limit);
+    }
+    return inno::DatabaseBuilder::LoadAll(name);
+}
 
 std::vector<std::string> listRDFdb() {
     std::vector<std::string> rdf_db_list;
@@ -52,14 +60,17 @@ std::vector<std::string> listRDFdb() {
 
 std::vector<std::unordered_map<std::string, std::string>>
 execute_query(std::string &sparql) {
-    if (sparqlQuery == nullptr) {
+    auto database = std::atomic_load(&db);
+    if (database == nullptr) {
         spdlog::error("database doesn't be loaded correctly.");
         return {};
     }
 
+    inno::SparqlParser parser;
     parser.parse(sparql);
+    inno::SparqlQuery sparqlQuery(database->snapshot());
 
-    auto result = sparqlQuery->query(parser);
+    auto result = sparqlQuery.query(parser);
     if (result.empty()) {
         return {};
     }
@@ -85,8 +96,18 @@ execute_query(std::string &sparql) {
 }
 
 bool execute_insert(std::string &sparql) {
+    inno::SparqlParser parser;
+    parser.parse(sparql);
+    bool status = std::atomic_load(&db)->insert(parser.getInsertTriplets());
+    return status;
+}
+
+bool execute_delete(std::string &sparql) {
+    inno::SparqlParser parser;
     parser.parse(sparql);
-    bool status = db->insert(parser.getInsertTriplets());
+    // the matches are queried on a snapshot, then deleted from the database
+    inno::SparqlQuery sparqlQuery(std::atomic_load(&db)->snapshot());
+    bool status = sparqlQuery.remove(parser);
     return status;
 }
 
@@ -102,10 +123,11 @@ void info(const httplib::Request &req, httplib::Response &res) {
     res.set_header("Access-Control-Allow-Origin", "*");
     spdlog::info("Catch info request from http://{}:{}", req.remote_addr, req.remote_port);
     std::unordered_map<std::string, uint32_t> data;
+    auto snapshot = std::atomic_load(&db)->snapshot();
 
-    data["triplets"] = db->getTripletSize();
-    data["predicates"] = db->getPredicateSize();
-    data["entities"] = db->getEntitySize();
+    data["triplets"] = snapshot->getTripletSize();
+    data["predicates"] = snapshot->getPredicateSize();
+    data["entities"] = snapshot->getEntitySize();
 
     nlohmann::json j;
     j["data"] = data;
@@ -115,7 +137,8 @@ void info(const httplib::Request &req, httplib::Response &res) {
 void visualize(const httplib::Request &req, httplib::Response &res) {
     res.set_header("Access-Control-Allow-Origin", "*");
     spdlog::info("Catch visualize request from http://{}:{}", req.remote_addr, req.remote_port);
-    auto predicate_stat = db->getPredicateStatistics();
+    auto snapshot = std::atomic_load(&db)->snapshot();
+    auto predicate_stat = snapshot->getPredicateStatistics();
     std::unordered_map<uint32_t, nlohmann::json> node_map;
     std::set<std::pair<uint32_t, uint32_t>> edge_set;
     std::vector<nlohmann::json> nodes;
@@ -123,13 +146,13 @@ void visualize(const httplib::Request &req, httplib::Response &res) {
 
     std::vector<std::string> categories;
     for (size_t pid = 1; pid < predicate_stat.size(); pid++) {
-        categories.push_back(db->getPredicateById(pid));
+        categories.push_back(snapshot->getPredicateById(pid));
     }
     // insert object node;
     for (size_t pid = 1; pid < predicate_stat.size(); pid++) {
         size_t num = predicate_stat[pid] % 20; // every predicate limit 20 triplets
 
-        auto so = db->getS2OByP(pid);
+        auto so = snapshot->getS2OByP(pid);
         for (const auto &item : so) {
             if (num != 0) num--;
             else break;
@@ -139,7 +162,7 @@ void visualize(const httplib::Request &req, httplib::Response &res) {
             if (!node_map.count(oid)) {
                 nlohmann::json object = {
                         {"id", oid_str},
-                        {"name", db->getEntityById(oid)},
+                        {"name", snapshot->getEntityById(oid)},
                         {"category", pid - 1}
                 };
                 node_map[oid] = object;
@@ -152,7 +175,7 @@ void visualize(const httplib::Request &req, httplib::Response &res) {
     for (size_t pid = 1; pid < predicate_stat.size(); pid++) {
         size_t num = predicate_stat[pid] % 20; // every predicate limit 20 triplets
 
-        auto so = db->getS2OByP(pid);
+        auto so = snapshot->getS2OByP(pid);
         std::string category = categories[pid - 1];
         std::string new_category = "Source" + category;
         for (const auto &item : so) {
@@ -169,7 +192,7 @@ void visualize(const httplib::Request &req, httplib::Response &res) {
                 }
                 nlohmann::json subject = {
                         {"id", sid_str},
-                        {"name", db->getEntityById(sid)},
+                        {"name", snapshot->getEntityById(sid)},
                         {"category", categories.size() - 1}
                 };
                 node_map[sid] = subject;
@@ -182,8 +205,8 @@ void visualize(const httplib::Request &req, httplib::Response &res) {
     for (size_t pid = 1; pid < predicate_stat.size(); pid++) {
         size_t num = predicate_stat[pid] % 20; // every predicate limit 20 triplets
 
-        std::string predicate = db->getPredicateById(pid);
-        auto so = db->getS2OByP(pid);
+        std::string predicate = snapshot->getPredicateById(pid);
+        auto so = snapshot->getS2OByP(pid);
         for (const auto &item : so) {
             if (num != 0) num--;
             else break;
@@ -340,6 +363,28 @@ void insert(const httplib::Request &req, httplib::Response &res) {
     res.set_content(j.dump(2), "text/plain;charset=utf-8");
 }
 
+void delete_triplets(const httplib::Request &req, httplib::Response &res) {
+    res.set_header("Access-Control-Allow-Origin", "*");
+    spdlog::info("Catch Delete Request.");
+
+    if (!req.has_param("sparql")) {
+        return;
+    }
+
+    std::string sparql = req.get_param_value("sparql");
+    spdlog::info("Receive SPARQL: {}", sparql);
+
+    bool status = execute_delete(sparql);
+    nlohmann::json j;
+    j["code"] = 1;
+    if (status) {
+        j["message"] = "Success";
+    } else {
+        j["message"] = "Failed";
+    }
+    res.set_content(j.dump(2), "text/plain;charset=utf-8");
+}
+
 void create(const httplib::Request &req, httplib::Response &res) {
     res.set_header("Access-Control-Allow-Origin", "*");
     spdlog::info("Catch create request from http://{}:{}", req.remote_addr, req.remote_port);
@@ -362,8 +407,7 @@ void create(const httplib::Request &req, httplib::Response &res) {
     std::string rdf = req.get_param_value("rdf");
     std::string file_name = req.get_param_value("file_name");
     spdlog::info("rdf: {}, file_name: {}", rdf, file_name);
-    db = inno::DatabaseBuilder::Create(rdf, file_name);
-    sparqlQuery = std::make_unique<inno::SparqlQuery>(db);
+    std::atomic_store(&db, inno::DatabaseBuilder::Create(rdf, file_name));
     db_name = rdf;
 
     j["code"] = 1;
@@ -392,8 +436,7 @@ void switchRDF(const httplib::Request &req, httplib::Response &res) {
         return;
     }
 
-    db = inno::DatabaseBuilder::LoadAll(rdf);
-    sparqlQuery = std::make_unique<inno::SparqlQuery>(db);
+    std::atomic_store(&db, loadRDFdb(rdf));
     db_name = rdf;
 
     j["code"] = 1;
@@ -436,6 +479,8 @@ int main(int argc, char **argv) {
             ("host,H", opt::value<std::string>()->default_value("0.0.0.0"), "IP address")
             ("port,P", opt::value<int>()->default_value(8998), "port")
             ("db_name,n", opt::value<std::string>(), "database name")
+            ("memory-limit,m", opt::value<std::string>(),
+             "page predicates in on demand and keep at most this much resident, e.g. 512M, 8G")
             ("help,h", "produce help message");
 
     opt::variables_map vm;
@@ -447,10 +492,14 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    if (vm.count("memory-limit") && !inno::parseMemorySize(vm["memory-limit"].as<std::string>(), memory_limit)) {
+        spdlog::error("invalid memory limit '{}'", vm["memory-limit"].as<std::string>());
+        return 1;
+    }
+
     if (vm.count("db_name")) {
         db_name = vm["db_name"].as<std::string>();
-        db = inno::DatabaseBuilder::LoadAll(db_name);
-        sparqlQuery = std::make_unique<inno::SparqlQuery>(db);
+        db = loadRDFdb(db_name);
     } else {
         spdlog::info("haven't specify database name.");
     }
@@ -492,6 +541,7 @@ int main(int argc, char **argv) {
     svr.Post(base_url + "/upload", upload); // upload RDF file
     svr.Post(base_url + "/query", query);   // query on RDF
     svr.Post(base_url + "/insert", insert); // insert new data into RDF
+    svr.Post(base_url + "/delete", delete_triplets); // delete data from RDF
 
     // disconnect
     svr.Get(base_url + "/disconnect", [&](const httplib::Request &req, httplib::Response &res) {
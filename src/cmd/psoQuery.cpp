@@ -3,6 +3,7 @@
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <functional>
 
 #include <spdlog/spdlog.h>
 
@@ -47,20 +48,58 @@ void execute_query(inno::SparqlQuery& sparqlQuery, inno::SparqlParser& parser) {
         std::copy(variables.begin(), variables.end(), std::ostream_iterator<std::string>(std::cout, "\t"));
         std::cout << std::endl;
 
+        // the terms are decoded row by row while they are printed
         for (const auto &item : result) {
-            std::copy(item.begin(), item.end(), std::ostream_iterator<std::string>(std::cout, "\t"));
-            std::cout << std::endl;
+            for (size_t column = 0; column < item.size(); ++column) {
+                std::cout << item[column] << '\t';
+            }
+            std::cout << '\n';
         }
+        std::cout.flush();
     }
 }
 
+void execute_delete(inno::SparqlQuery& sparqlQuery, inno::SparqlParser& parser) {
+    double used_time = 0;
+    bool status = false;
+    std::tie(status, used_time) =
+            inno::timeit(std::bind(&inno::SparqlQuery::remove, &sparqlQuery, std::ref(parser)));
+    if (status) {
+        spdlog::info("Delete done, used {} ms.", used_time);
+    } else {
+        spdlog::error("Delete failed.");
+    }
+}
+
+void execute(inno::SparqlQuery& sparqlQuery, inno::SparqlParser& parser) {
+    if (!parser.getDeleteTriplets().empty()) {
+        execute_delete(sparqlQuery, parser);
+    } else {
+        execute_query(sparqlQuery, parser);
+    }
+}
+
+/* parse a thread number made of digits only, `std::stoul` would accept a sign or trailing garbage */
+bool parseThreadNum(const std::string &text, size_t &thread_num) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    try {
+        thread_num = std::stoul(text);
+    } catch (const std::exception &) {
+        return false;
+    }
+    return true;
+}
+
 int main(int argc, char** argv) {
     std::ios::sync_with_stdio(false);
     std::cin.tie(nullptr);
     std::cout.tie(nullptr);
 
-    if (argc == 1) {
-        std::cout << "psoQuery <db_name> <query_file>" << std::endl;
+    size_t thread_num = 1;
+    if (argc == 1 || (argc >= 4 && !parseThreadNum(argv[3], thread_num))) {
+        std::cout << "psoQuery <db_name> <query_file> [thread_num]" << std::endl;
         std::cout << "psoQuery <db_name>" << std::endl;
         return 1;
     }
@@ -81,7 +120,10 @@ int main(int argc, char** argv) {
         spdlog::info("<{}> loadAll done, used {} ms.", dbname, used_time);
 
         inno::SparqlQuery sparqlQuery(db);
-        execute_query(sparqlQuery, parser);
+        if (argc >= 4) {
+            sparqlQuery.setParallelism(thread_num);
+        }
+        execute(sparqlQuery, parser);
     } else {
         std::tie(db, used_time) = inno::timeit(inno::DatabaseBuilder::LoadAll, dbname);
         spdlog::info("<{}> load done, used {} ms.", dbname, used_time);
@@ -96,7 +138,7 @@ int main(int argc, char** argv) {
 
             sparql = readSPARQLFromFile(query_file);
             parser.parse(sparql);
-            execute_query(sparqlQuery, parser);
+            execute(sparqlQuery, parser);
         }
     }
 
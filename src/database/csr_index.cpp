@@ -0,0 +1,547 @@
+/*
+ * @FileName   : csr_index.cpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: implement `CsrIndex` and the binary triplet file layout
+ */
+
+#include "database/csr_index.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace inno {
+
+namespace fs = boost::filesystem;
+namespace io = boost::iostreams;
+
+/* on-disk layout of `triplet/<pid>`, all integers are written in native byte order
+ * so that the file can be memory-mapped and used without parsing.
+ *   version 1: header, `count` sorted <key, value> pairs of uint32_t
+ *   version 2: header, `key_count` (uint64_t), keys[key_count], offsets[key_count + 1], values[count]
+ *   version 3: header, `key_count` (uint64_t), `byte_count` (uint64_t), block_offsets[block_count] (uint64_t),
+ *              keys[key_count], offsets[key_count + 1], block_first[block_count], bytes[byte_count] (uint8_t),
+ *              where block_count = ceil(count / `IdSpan::BLOCK_SIZE`) */
+const char TRIPLET_FILE_MAGIC[4] = {'P', 'S', 'O', 'T'};
+const uint32_t TRIPLET_FILE_VERSION = 3;
+
+struct TripletFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+};
+
+namespace {
+
+struct CsrStorage {
+    std::vector<uint32_t> keys;
+    std::vector<uint32_t> offsets;
+    std::vector<uint64_t> block_offsets;
+    std::vector<uint32_t> block_first;
+    std::vector<uint8_t> bytes;
+
+    void key(const uint32_t &key, const uint32_t &offset) {
+        keys.emplace_back(key);
+        offsets.emplace_back(offset);
+    }
+
+    void block(const uint64_t &offset, const uint32_t &first) {
+        block_offsets.emplace_back(offset);
+        block_first.emplace_back(first);
+    }
+
+    void code(const uint8_t *data, const std::size_t &size) {
+        bytes.insert(bytes.end(), data, data + size);
+    }
+};
+
+uint64_t block_count(const uint64_t &count) {
+    return (count + IdSpan::BLOCK_SIZE - 1) / IdSpan::BLOCK_SIZE;
+}
+
+template<typename T>
+void write_array(std::ostream &out, const T *data, const std::size_t &size) {
+    if (size > 0) {
+        out.write(reinterpret_cast<const char *>(data), size * sizeof(T));
+    }
+}
+
+}
+
+/* the first value of a key and of a block is stored as is, the others as the delta to the previous value */
+template<typename Sink>
+void CsrIndex::encode_(EncodeState &state, Sink &sink, const uint32_t &key, const uint32_t &value) {
+    bool new_key = state.size == 0 || key != state.last_key;
+    if (new_key) {
+        sink.key(key, static_cast<uint32_t>(state.size));
+        state.last_key = key;
+        ++state.key_size;
+    }
+    bool new_block = state.size % IdSpan::BLOCK_SIZE == 0;
+    if (new_block) {
+        sink.block(state.byte_size, value);
+    }
+
+    uint32_t code = new_key || new_block ? value : value - state.last_value;
+    uint8_t buf[5];
+    std::size_t len = 0;
+    while (code >= 0x80) {
+        buf[len++] = static_cast<uint8_t>(code | 0x80);
+        code >>= 7;
+    }
+    buf[len++] = static_cast<uint8_t>(code);
+    sink.code(buf, len);
+
+    state.byte_size += len;
+    state.last_value = value;
+    ++state.size;
+}
+
+const std::size_t CsrIndex::BITMAP_MIN_SIZE;
+
+CsrIndex::CsrIndex()
+    : keys_(nullptr), offsets_(nullptr), values_(nullptr), bytes_(nullptr)
+    , block_offsets_(nullptr), block_first_(nullptr), key_size_(0), size_(0), byte_size_(0), hidden_(0) {}
+
+CsrIndex::~CsrIndex() = default;
+
+CsrIndex CsrIndex::Build(std::vector<std::pair<uint32_t, uint32_t>> &pairs) {
+    std::sort(pairs.begin(), pairs.end());
+
+    auto storage = std::make_shared<CsrStorage>();
+    storage->block_offsets.reserve(block_count(pairs.size()));
+    storage->block_first.reserve(block_count(pairs.size()));
+    storage->bytes.reserve(pairs.size());
+    EncodeState state;
+    for (const auto &kv : pairs) {
+        encode_(state, *storage, kv.first, kv.second);
+    }
+    storage->offsets.emplace_back(static_cast<uint32_t>(state.size));
+
+    CsrIndex index;
+    index.keys_ = storage->keys.data();
+    index.offsets_ = storage->offsets.data();
+    index.bytes_ = storage->bytes.data();
+    index.block_offsets_ = storage->block_offsets.data();
+    index.block_first_ = storage->block_first.data();
+    index.key_size_ = state.key_size;
+    index.size_ = state.size;
+    index.byte_size_ = state.byte_size;
+    index.holder_ = std::move(storage);
+    index.bitmaps_ = std::make_shared<Bitmaps>();
+    return index;
+}
+
+bool CsrIndex::Load(const std::string &path, CsrIndex &index) {
+    if (!fs::exists(path) || fs::file_size(path) < sizeof(TripletFileHeader)) {
+        spdlog::error("`{}` cannot be read or is not a binary triplet file, "
+                      "use psoConvert to upgrade the database.", path);
+        return false;
+    }
+
+    auto file = std::make_shared<io::mapped_file_source>(path);
+    const char *data = file->data();
+    auto header = reinterpret_cast<const TripletFileHeader *>(data);
+    if (std::memcmp(header->magic, TRIPLET_FILE_MAGIC, sizeof(header->magic)) != 0) {
+        spdlog::error("`{}` is not a binary triplet file, "
+                      "use psoConvert to upgrade the database.", path);
+        return false;
+    }
+
+    data += sizeof(TripletFileHeader);
+    if (header->version == 1) {
+        if (file->size() != sizeof(TripletFileHeader) + header->count * 2 * sizeof(uint32_t)) {
+            spdlog::error("`{}` is truncated.", path);
+            return false;
+        }
+        auto so = reinterpret_cast<const uint32_t *>(data);
+        std::vector<std::pair<uint32_t, uint32_t>> pairs;
+        pairs.reserve(header->count);
+        for (uint64_t i = 0; i < header->count; ++i) {
+            pairs.emplace_back(so[2 * i], so[2 * i + 1]);
+        }
+        index = Build(pairs);
+        return true;
+    }
+
+    if (header->version == 2) {
+        uint64_t key_count = *reinterpret_cast<const uint64_t *>(data);
+        data += sizeof(uint64_t);
+        if (file->size() != sizeof(TripletFileHeader) + sizeof(uint64_t) +
+                            (key_count + key_count + 1 + header->count) * sizeof(uint32_t)) {
+            spdlog::error("`{}` is truncated.", path);
+            return false;
+        }
+
+        index = CsrIndex();
+        index.keys_ = reinterpret_cast<const uint32_t *>(data);
+        index.offsets_ = index.keys_ + key_count;
+        index.values_ = index.offsets_ + key_count + 1;
+        index.key_size_ = key_count;
+        index.size_ = header->count;
+        index.holder_ = std::move(file);
+        index.bitmaps_ = std::make_shared<Bitmaps>();
+        return true;
+    }
+
+    if (header->version != TRIPLET_FILE_VERSION) {
+        spdlog::error("`{}` has unsupported version {}.", path, header->version);
+        return false;
+    }
+
+    if (file->size() < sizeof(TripletFileHeader) + 2 * sizeof(uint64_t)) {
+        spdlog::error("`{}` is truncated.", path);
+        return false;
+    }
+    uint64_t key_count = reinterpret_cast<const uint64_t *>(data)[0];
+    uint64_t byte_count = reinterpret_cast<const uint64_t *>(data)[1];
+    uint64_t blocks = block_count(header->count);
+    data += 2 * sizeof(uint64_t);
+    if (file->size() != sizeof(TripletFileHeader) + 2 * sizeof(uint64_t) + blocks * sizeof(uint64_t) +
+                        (key_count + key_count + 1 + blocks) * sizeof(uint32_t) + byte_count) {
+        spdlog::error("`{}` is truncated.", path);
+        return false;
+    }
+
+    index = CsrIndex();
+    index.block_offsets_ = reinterpret_cast<const uint64_t *>(data);
+    index.keys_ = reinterpret_cast<const uint32_t *>(index.block_offsets_ + blocks);
+    index.offsets_ = index.keys_ + key_count;
+    index.block_first_ = index.offsets_ + key_count + 1;
+    index.bytes_ = reinterpret_cast<const uint8_t *>(index.block_first_ + blocks);
+    index.key_size_ = key_count;
+    index.size_ = header->count;
+    index.byte_size_ = byte_count;
+    index.holder_ = std::move(file);
+    index.bitmaps_ = std::make_shared<Bitmaps>();
+    return true;
+}
+
+bool CsrIndex::save(const std::string &path) const {
+    // the file may be mapped by this or another index, so write a new file and replace it
+    std::string tmp_path = path + ".tmp";
+
+    if (values_ || hidden_ > 0 || delta_) {
+        // a version 2 index holds plain values, compress them on the way out,
+        // drop the tombstoned pairs and merge the inserted ones
+        Writer writer(tmp_path);
+        for (const auto &kv : *this) {
+            writer.append(kv.first, kv.second);
+        }
+        if (!writer.close()) {
+            return false;
+        }
+        fs::rename(tmp_path, path);
+        return true;
+    }
+
+    fs::ofstream out(tmp_path, fs::ofstream::out | fs::ofstream::binary);
+    if (!out.is_open()) {
+        spdlog::error("`{}` cannot be written.", path);
+        return false;
+    }
+
+    TripletFileHeader header{};
+    std::memcpy(header.magic, TRIPLET_FILE_MAGIC, sizeof(header.magic));
+    header.version = TRIPLET_FILE_VERSION;
+    header.count = size_;
+    uint64_t sizes[2] = {key_size_, byte_size_};
+    uint64_t blocks = block_count(size_);
+    uint32_t zero = 0;
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+    write_array(out, block_offsets_, blocks);
+    write_array(out, keys_, key_size_);
+    if (key_size_ == 0) {
+        out.write(reinterpret_cast<const char *>(&zero), sizeof(zero));
+    } else {
+        write_array(out, offsets_, key_size_ + 1);
+    }
+    write_array(out, block_first_, blocks);
+    write_array(out, bytes_, byte_size_);
+    out.close();
+    if (!out) {
+        spdlog::error("`{}` cannot be written.", path);
+        return false;
+    }
+    fs::rename(tmp_path, path);
+    return true;
+}
+
+uint32_t CsrIndex::FileVersion(const std::string &path) {
+    fs::ifstream in(path, fs::ifstream::in | fs::ifstream::binary);
+    TripletFileHeader header{};
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!in || std::memcmp(header.magic, TRIPLET_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        return 0;
+    }
+    return header.version;
+}
+
+uint32_t CsrIndex::CurrentFileVersion() {
+    return TRIPLET_FILE_VERSION;
+}
+
+struct CsrIndex::Writer::FileSink {
+    Writer &writer;
+
+    void key(const uint32_t &key, const uint32_t &offset) {
+        writer.keys_.write(reinterpret_cast<const char *>(&key), sizeof(key));
+        writer.offsets_.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    }
+
+    void block(const uint64_t &offset, const uint32_t &first) {
+        writer.block_offsets_.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+        writer.block_first_.write(reinterpret_cast<const char *>(&first), sizeof(first));
+    }
+
+    void code(const uint8_t *data, const std::size_t &size) {
+        writer.bytes_.write(reinterpret_cast<const char *>(data), size);
+    }
+};
+
+CsrIndex::Writer::Writer(const std::string &path)
+    : path_(path)
+    , keys_(path + ".keys", std::ofstream::out | std::ofstream::binary)
+    , offsets_(path + ".offsets", std::ofstream::out | std::ofstream::binary)
+    , block_offsets_(path + ".block_offsets", std::ofstream::out | std::ofstream::binary)
+    , block_first_(path + ".block_first", std::ofstream::out | std::ofstream::binary)
+    , bytes_(path + ".bytes", std::ofstream::out | std::ofstream::binary)
+    , closed_(false) {}
+
+CsrIndex::Writer::~Writer() {
+    close();
+}
+
+void CsrIndex::Writer::append(const uint32_t &key, const uint32_t &value) {
+    FileSink sink{*this};
+    encode_(state_, sink, key, value);
+}
+
+bool CsrIndex::Writer::close() {
+    if (closed_) {
+        return true;
+    }
+    closed_ = true;
+
+    uint32_t offset = static_cast<uint32_t>(state_.size);
+    offsets_.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    keys_.close();
+    offsets_.close();
+    block_offsets_.close();
+    block_first_.close();
+    bytes_.close();
+
+    fs::ofstream out(path_, fs::ofstream::out | fs::ofstream::binary);
+    if (!out.is_open() || !keys_ || !offsets_ || !block_offsets_ || !block_first_ || !bytes_) {
+        spdlog::error("`{}` cannot be written.", path_);
+        return false;
+    }
+
+    TripletFileHeader header{};
+    std::memcpy(header.magic, TRIPLET_FILE_MAGIC, sizeof(header.magic));
+    header.version = TRIPLET_FILE_VERSION;
+    header.count = state_.size;
+    uint64_t sizes[2] = {state_.key_size, state_.byte_size};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+    for (const char *suffix : {".block_offsets", ".keys", ".offsets", ".block_first", ".bytes"}) {
+        std::string part = path_ + suffix;
+        if (fs::file_size(part) > 0) {
+            fs::ifstream in(part, fs::ifstream::in | fs::ifstream::binary);
+            out << in.rdbuf();
+            in.close();
+        }
+        fs::remove(part);
+    }
+    out.close();
+    return static_cast<bool>(out);
+}
+
+IdSpan CsrIndex::values_at_(const std::size_t &key_idx) const {
+    uint64_t lo = offsets_[key_idx];
+    uint64_t hi = offsets_[key_idx + 1];
+    IdSpan values;
+    if (values_) {
+        values = IdSpan(values_ + lo, values_ + hi);
+    } else {
+        // jump to the block of the first value, then skip the codes before it
+        const uint8_t *ptr = bytes_ + block_offsets_[lo / IdSpan::BLOCK_SIZE];
+        for (uint64_t i = lo % IdSpan::BLOCK_SIZE; i > 0; --i) {
+            while (*ptr++ & 0x80) {}
+        }
+        values = IdSpan(ptr, lo, hi, bytes_, block_offsets_, block_first_);
+    }
+    overlay_(keys_[key_idx], values);
+    return values;
+}
+
+void CsrIndex::overlay_(const uint32_t &key, IdSpan &values) const {
+    if (delta_) {
+        auto iter = delta_->values.find(key);
+        if (iter != delta_->values.end()) {
+            const auto &inserted = iter->second;
+            values.extend(inserted.data(), inserted.data() + inserted.size());
+        }
+    }
+    if (tombstones_) {
+        auto iter = tombstones_->find(key);
+        if (iter != tombstones_->end()) {
+            const auto &skipped = iter->second.values;
+            values.skip(skipped.data(), skipped.data() + skipped.size(), iter->second.hidden);
+        }
+    }
+}
+
+IdSpan CsrIndex::get(const uint32_t &key) const {
+    const uint32_t *keys_end = keys_ + key_size_;
+    const uint32_t *it = std::lower_bound(keys_, keys_end, key);
+    if (it != keys_end && *it == key) {
+        return values_at_(it - keys_);
+    }
+    IdSpan values;
+    if (delta_) {
+        overlay_(key, values);
+    }
+    return values;
+}
+
+void CsrIndex::build_bitmaps_() const {
+    std::size_t usage = 0;
+    for (std::size_t i = 0; i < key_size_; ++i) {
+        if (offsets_[i + 1] - offsets_[i] >= BITMAP_MIN_SIZE) {
+            IdSpan values = values_at_(i);
+            auto bitmap = RoaringBitmap::FromSorted(values.begin(), values.end());
+            usage += bitmap.memoryUsage();
+            bitmaps_->values.emplace(keys_[i], std::move(bitmap));
+        }
+    }
+    bitmaps_->usage = usage;
+}
+
+bool CsrIndex::contains(const uint32_t &key, const uint32_t &value) const {
+    const RoaringBitmap *values = bitmap(key);
+    return values ? values->contains(value) : get(key).contains(value);
+}
+
+const RoaringBitmap *CsrIndex::bitmap(const uint32_t &key) const {
+    if (!bitmaps_ || (tombstones_ && tombstones_->count(key)) || (delta_ && delta_->values.count(key))) {
+        return nullptr;
+    }
+    std::call_once(bitmaps_->built, &CsrIndex::build_bitmaps_, this);
+    auto iter = bitmaps_->values.find(key);
+    return iter == bitmaps_->values.end() ? nullptr : &iter->second;
+}
+
+std::size_t CsrIndex::remove(std::vector<std::pair<uint32_t, uint32_t>> pairs) {
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    // readers may hold spans over the current tombstones, so the new ones are built on a copy
+    auto tombstones = tombstones_ ? std::make_shared<std::unordered_map<uint32_t, Tombstone>>(*tombstones_)
+                                  : std::make_shared<std::unordered_map<uint32_t, Tombstone>>();
+    std::size_t removed = 0;
+    for (const auto &kv : pairs) {
+        std::size_t count = get(kv.first).count(kv.second);
+        if (count == 0) {
+            continue;
+        }
+        Tombstone &tombstone = (*tombstones)[kv.first];
+        tombstone.values.insert(std::lower_bound(tombstone.values.begin(), tombstone.values.end(), kv.second),
+                                kv.second);
+        tombstone.hidden += count;
+        removed += count;
+    }
+
+    if (removed > 0) {
+        tombstones_ = std::move(tombstones);
+        hidden_ += removed;
+    }
+    return removed;
+}
+
+std::size_t CsrIndex::insert(std::vector<std::pair<uint32_t, uint32_t>> pairs) {
+    if (pairs.empty()) {
+        return 0;
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    if (tombstones_) {
+        for (const auto &kv : pairs) {
+            auto iter = tombstones_->find(kv.first);
+            if (iter != tombstones_->end() &&
+                std::binary_search(iter->second.values.begin(), iter->second.values.end(), kv.second)) {
+                std::vector<std::pair<uint32_t, uint32_t>> merged = this->pairs();
+                merged.insert(merged.end(), pairs.begin(), pairs.end());
+                *this = Build(merged);
+                return pairs.size();
+            }
+        }
+    }
+
+    // readers may hold spans over the current delta, so the new pairs are merged into a copy
+    auto delta = delta_ ? std::make_shared<Delta>(*delta_) : std::make_shared<Delta>();
+    std::vector<uint32_t> new_keys;
+    for (auto first = pairs.begin(); first != pairs.end(); ) {
+        uint32_t key = first->first;
+        std::vector<uint32_t> &values = delta->values[key];
+        if (values.empty() && !std::binary_search(keys_, keys_ + key_size_, key)) {
+            new_keys.emplace_back(key);
+        }
+        std::size_t middle = values.size();
+        for (; first != pairs.end() && first->first == key; ++first) {
+            values.emplace_back(first->second);
+        }
+        std::inplace_merge(values.begin(), values.begin() + middle, values.end());
+    }
+    std::size_t middle = delta->keys.size();
+    delta->keys.insert(delta->keys.end(), new_keys.begin(), new_keys.end());
+    std::inplace_merge(delta->keys.begin(), delta->keys.begin() + middle, delta->keys.end());
+    delta->size += pairs.size();
+
+    delta_ = std::move(delta);
+    return pairs.size();
+}
+
+IdSpan CsrIndex::keys() const {
+    IdSpan keys(keys_, keys_ + key_size_);
+    if (delta_) {
+        keys.extend(delta_->keys.data(), delta_->keys.data() + delta_->keys.size());
+    }
+    return keys;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> CsrIndex::pairs() const {
+    return {begin(), end()};
+}
+
+std::size_t CsrIndex::memoryUsage() const {
+    std::size_t usage = (key_size_ + key_size_ + 1) * sizeof(uint32_t);
+    if (delta_) {
+        usage += (delta_->size + delta_->keys.size()) * sizeof(uint32_t);
+    }
+    if (bitmaps_) {
+        usage += bitmaps_->usage;
+    }
+    if (values_) {
+        return usage + size_ * sizeof(uint32_t);
+    }
+    return usage + block_count(size_) * (sizeof(uint64_t) + sizeof(uint32_t)) + byte_size_;
+}
+
+CsrIndex::iterator CsrIndex::begin() const {
+    return {this, keys().begin()};
+}
+
+CsrIndex::iterator CsrIndex::end() const {
+    return {this, keys().end()};
+}
+
+}
@@ -10,40 +10,180 @@
 #include "database/database.hpp"
 
 #include <set>
+#include <list>
+#include <mutex>
+#include <atomic>
 #include <vector>
+#include <queue>
+#include <tuple>
+#include <chrono>
 #include <future>
+#include <thread>
+#include <memory>
 #include <fstream>
+#include <algorithm>
 #include <unordered_map>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <spdlog/spdlog.h>
 #include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/utility/string_view.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "common/thread_pool.hpp"
+#include "database/csr_index.hpp"
+#include "database/dictionary.hpp"
+#include "database/statistics.hpp"
+#include "database/write_ahead_log.hpp"
 
 namespace inno {
 
 namespace fs = boost::filesystem;
+namespace io = boost::iostreams;
 
 class DatabaseBuilder::Impl {
+    friend class DatabaseBuilder::Snapshot;
+
 private:
 //    using entity_pair_set = inno::SkipList<std::pair<uint32_t, uint32_t>>;
 //    using entity_pair_set = std::set<std::pair<uint32_t, uint32_t>>;
-    using entity_pair_set = std::unordered_multimap<uint32_t, uint32_t>;
+//    using entity_pair_set = std::unordered_multimap<uint32_t, uint32_t>;
+    using entity_pair_list = std::vector<std::pair<uint32_t, uint32_t>>;
+
+    /* forward (subject -> objects) and reverse (object -> subjects) index of one predicate */
+    struct entity_pair_set {
+        CsrIndex s2o;
+        CsrIndex o2s;
+    };
+
+    /* entity counts are published in chunks, so a version only copies the chunks changed since the last one */
+    static const size_t COUNT_CHUNK_SIZE = 1 << 16;
+
+    /* terms inserted after the dictionary blocks of a version were taken, `terms[i]` has id `first + i` */
+    struct TermSegment {
+        uint32_t first = 0;
+        std::vector<const std::string *> terms;           // keys of `ids`
+        std::unordered_map<std::string, uint32_t> ids;
+    };
 
 public:
+    /* everything a reader needs of one state of the database. A published version is never changed,
+     * it shares the indexes, the dictionary blocks and the unchanged parts with the previous version */
+    struct Version {
+        uint32_t predicate_size = 0;
+        uint32_t entity_size = 0;
+        size_t triplet_size = 0;
+        std::shared_ptr<const std::unordered_map<std::string, uint32_t>> p2id;
+        std::shared_ptr<const std::vector<std::string>> id2p;
+        std::vector<uint32_t> id2p_count;
+        std::vector<std::shared_ptr<const std::vector<uint32_t>>> id2so_count;  // chunks of `COUNT_CHUNK_SIZE`
+        std::vector<std::shared_ptr<const std::vector<uint32_t>>> id2s_count;   // chunks of `COUNT_CHUNK_SIZE`
+        std::shared_ptr<const std::vector<PredicateStatistics>> predicate_statistics;
+        std::shared_ptr<const CharacteristicSets> characteristic_sets;
+        std::shared_ptr<const Dictionary> entities;
+        std::vector<std::shared_ptr<const TermSegment>> segments;              // sorted by `first`
+        std::unordered_map<uint32_t, entity_pair_set> storage;
+
+        /* id of @term, 0 if it doesn't exist */
+        uint32_t findEntity(const std::string &term) const {
+            uint32_t id = entities->find(term);
+            for (auto segment = segments.begin(); id == 0 && segment != segments.end(); ++segment) {
+                auto iter = (*segment)->ids.find(term);
+                id = iter == (*segment)->ids.end() ? 0 : iter->second;
+            }
+            return id;
+        }
+
+        /* term of @id, throw `std::out_of_range` if it doesn't exist */
+        std::string getEntity(const uint32_t &id) const {
+            if (id <= entities->size() || id > entity_size) {
+                return entities->getTerm(id);
+            }
+            auto segment = std::upper_bound(segments.begin(), segments.end(), id,
+                                            [](const uint32_t &id, const std::shared_ptr<const TermSegment> &seg) {
+                                                return id < seg->first;
+                                            }) - 1;
+            return *(*segment)->terms[id - (*segment)->first];
+        }
+
+        uint32_t getEntityCount(const uint32_t &id) const {
+            return (*id2so_count[id / COUNT_CHUNK_SIZE])[id % COUNT_CHUNK_SIZE];
+        }
+
+        uint32_t getSubjectCount(const uint32_t &id) const {
+            return (*id2s_count[id / COUNT_CHUNK_SIZE])[id % COUNT_CHUNK_SIZE];
+        }
+    };
+
     Impl() : info_path_("info")
            , id_predicates_path_("id_predicates")
            , id_entities_path_("id_entities")
+           , entity_count_path_("id_entities_count")
+           , entity_subject_count_path_("id_entities_subject_count")
+           , predicate_statistics_path_("predicate_statistics")
+           , characteristic_sets_path_("characteristic_sets")
            , triplet_path_("triplet")
-           { initialize_(); }
+           , reverse_triplet_path_("reverse_triplet")
+           , run_path_("tmp_runs")
+           , wal_path_("wal")
+           , checkpoint_path_("checkpoint")
+           , memory_limit_(0)
+           , characteristic_changes_(0)
+           , saved_(false)
+           , checkpoint_aborted_(false)
+           , lazy_(false)
+           , cache_limit_(0)
+           , cache_size_(0)
+           , checkpoint_sequence_(0)
+           , checkpoint_size_(64ull << 20)
+           , background_(std::make_shared<ThreadPool>(1))
+           , stale_(false)
+           , generation_(0)
+           , statistics_changed_(false)
+           { initialize_(); setThreadNum(0); publish_(true); }
 
     ~Impl() { unload(); }
 
+    /* use a pool of @thread_num workers, 0 means the shared pool which has a worker per hardware thread */
+    void setThreadNum(const uint32_t &thread_num) {
+        pool_ = ThreadPool::Shared();
+        if (thread_num > 0 && thread_num != pool_->size()) {
+            pool_ = std::make_shared<ThreadPool>(thread_num);
+        }
+        thread_num_ = static_cast<uint32_t>(pool_->size());
+    }
+
+    void setMemoryLimit(const size_t &memory_limit) {
+        memory_limit_ = memory_limit;
+    }
+
+    void setCheckpointSize(const size_t &checkpoint_size) {
+        checkpoint_size_ = checkpoint_size;
+    }
+
     void create(const std::string &db_name, const std::string &data_file) {
         db_name_ = db_name;
-        if (fs::exists(data_file)) {
+        if (fs::exists(data_file) && memory_limit_ > 0) {
+            insertFromFileExternal(data_file);
+        } else if (fs::exists(data_file)) {
             insertFromFile(data_file);
         } else {
             spdlog::info("data file path '{}' doesn't exist.", data_file);
         }
+
+        // a log left by an earlier database of the same name doesn't belong to this one
+        fs::path db_path = fs::current_path().append(db_name + ".db");
+        if (fs::exists(db_path)) {
+            fs::remove(db_path / wal_path_);
+            open_wal_(db_path);
+        }
+
+        std::unique_lock<std::mutex> lock(write_mutex_);
+        publish_(true);
     }
 
     bool insertFromFile(const std::string &data_file) {
@@ -51,43 +191,170 @@ public:
             spdlog::info("<{}> haven't been specify, choose one to add data.");
             return false;
         }
-        std::ifstream infile(data_file, std::ifstream::binary);
-        std::ifstream::sync_with_stdio(false);
+        if (!fs::exists(data_file)) {
+            spdlog::error("Cannot open RDF data file, problem occurs by path '{}'", data_file);
+            return false;
+        }
 
         size_t affect = 0;
-        if (infile.is_open()) {
-            std::string s, p, o;
-            while (infile >> s >> p) {
-                infile.ignore();
-                std::getline(infile, o);
-                for (o.pop_back(); o.back() == ' ' || o.back() == '.'; o.pop_back()) {}
+        if (fs::file_size(data_file) > 0) {
+            io::mapped_file_source file(data_file);
+            affect = bulk_insert_(file.data(), file.data() + file.size());
+        }
 
-                affect += insert(s, p, o) ? 1 : 0;
-            }
+        save();
+        spdlog::info("{} triplet(s) have been inserted.", affect);
+        return true;
+    }
 
-            save();
-            spdlog::info("{} triplet(s) have been inserted.", affect);
-            return true;
-        } else {
+    /* same as `insertFromFile`, but the file is encoded segment by segment, the triplets of every segment
+     * are spilled into sorted runs under `tmp_runs`, then the runs are merged into the triplet files directly.
+     * Only the dictionary and about `memory_limit_` bytes of triplets are kept in memory. */
+    bool insertFromFileExternal(const std::string &data_file) {
+        if (db_name_.empty()) {
+            spdlog::info("<{}> haven't been specify, choose one to add data.");
+            return false;
+        }
+        if (!fs::exists(data_file)) {
             spdlog::error("Cannot open RDF data file, problem occurs by path '{}'", data_file);
             return false;
         }
-    }
 
-    bool insertFromTriplets(const std::vector<std::tuple<std::string, std::string, std::string>> &triplets) {
-        std::string s, p, o;
+        fs::path db_path = fs::current_path().append(db_name_ + ".db");
+        fs::path run_dir = db_path / run_path_;
+        fs::create_directories(db_path / triplet_path_);
+        fs::create_directories(db_path / reverse_triplet_path_);
+        fs::create_directories(run_dir);
+        // the runs are removed on every exit, including the failed spills and merges
+        struct RunRemover {
+            ~RunRemover() {
+                boost::system::error_code ec;
+                fs::remove_all(path, ec);
+            }
+            fs::path path;
+        } run_remover{run_dir};
+
+        // 1. encode the file segment by segment and spill every segment as a sorted run
         size_t affect = 0;
-        for (const auto &triplet : triplets) {
-            std::tie(s, p, o) = triplet;
-            affect += insert(s, p, o) ? 1 : 0;
+        std::vector<fs::path> forward_runs, reverse_runs;
+        if (fs::file_size(data_file) > 0) {
+            io::mapped_file_source file(data_file);
+            const char *end = file.data() + file.size();
+            size_t segment_size = std::max<size_t>(memory_limit_ / 2, 1 << 16);
+            for (const char *segment = file.data(); segment < end; ) {
+                const char *segment_end = segment + std::min<size_t>(segment_size, end - segment);
+                segment_end = std::find(segment_end, end, '\n');
+                segment_end = segment_end == end ? end : segment_end + 1;
+
+                affect += bulk_insert_(segment, segment_end);
+                forward_runs.emplace_back(run_dir / fs::path(std::to_string(forward_runs.size()) + ".spo"));
+                reverse_runs.emplace_back(run_dir / fs::path(std::to_string(reverse_runs.size()) + ".pos"));
+                if (!spill_pending_(forward_runs.back(), reverse_runs.back())) {
+                    return false;
+                }
+                segment = segment_end;
+            }
+        }
+        spdlog::info("{} triplet(s) have been spilled into {} run(s).", affect, forward_runs.size());
+
+        // 2. merge the runs into `triplet/<pid>` and `reverse_triplet/<pid>`
+        auto forward_merge_task = pool_->submit(&DatabaseBuilder::Impl::merge_runs_,
+                                                this, forward_runs, db_path / triplet_path_);
+        auto reverse_merge_task = pool_->submit(&DatabaseBuilder::Impl::merge_runs_,
+                                                this, reverse_runs, db_path / reverse_triplet_path_);
+        bool merged = pool_->wait(forward_merge_task);
+        merged = pool_->wait(reverse_merge_task) && merged;
+        // free the disk space of the runs before the merged files are mapped
+        fs::remove_all(run_dir);
+        if (!merged) {
+            return false;
         }
+
+        // 3. no predicate is loaded, so only the dictionary and info are written, then map the merged files
         save();
+        if (!load_all_triplet_(db_path / triplet_path_, predicate_size_)) {
+            return false;
+        }
+        std::vector<uint32_t> pid_list;
+        for (uint32_t pid = 1; pid <= predicate_size_; ++pid) {
+            pid_list.emplace_back(pid);
+        }
+        refresh_statistics_(pid_list);
+        if (!PredicateStatistics::Store((db_path / predicate_statistics_path_).string(), predicate_statistics_)) {
+            return false;
+        }
         spdlog::info("{} triplet(s) have been inserted.", affect);
         return true;
     }
 
+    /* insert @triplets as one batch, the batch is durable once it is appended to the write-ahead log,
+     * the database files are rewritten by a background checkpoint when the log grows over `checkpoint_size_` */
+    bool insertFromTriplets(const std::vector<std::tuple<std::string, std::string, std::string>> &triplets) {
+        {
+            std::unique_lock<std::mutex> lock(write_mutex_);
+            if (wal_.isOpen() && wal_.append(WriteAheadLog::INSERT, triplets) == 0) {
+                spdlog::error("insertion failed, the triplets cannot be written into the write-ahead log.");
+                return false;
+            }
+
+            std::string s, p, o;
+            size_t affect = 0;
+            for (const auto &triplet : triplets) {
+                std::tie(s, p, o) = triplet;
+                affect += insert(s, p, o) ? 1 : 0;
+            }
+            spdlog::info("{} triplet(s) have been inserted.", affect);
+
+            if (wal_.isOpen()) {
+                publish_();
+                schedule_checkpoint_();
+                return true;
+            }
+        }
+        // no log to append to, e.g. the database hasn't been saved yet
+        return save();
+    }
+
+    /* delete every copy of @triplets as one batch, which is logged like an inserted one.
+     * The pairs are tombstoned, the predicates are rewritten without them by a background compaction */
+    bool removeFromTriplets(const std::vector<std::tuple<std::string, std::string, std::string>> &triplets) {
+        {
+            std::unique_lock<std::mutex> lock(write_mutex_);
+            if (wal_.isOpen() && wal_.append(WriteAheadLog::REMOVE, triplets) == 0) {
+                spdlog::error("deletion failed, the triplets cannot be written into the write-ahead log.");
+                return false;
+            }
+
+            size_t affect = remove_(triplets, true);
+            spdlog::info("{} triplet(s) have been deleted.", affect);
+
+            if (wal_.isOpen()) {
+                publish_();
+                schedule_checkpoint_();
+                return true;
+            }
+        }
+        return save();
+    }
+
+    /* insert one triplet, which is in memory only until `save`, snapshots see it once they are taken
+     * while no other write is running */
+    bool insertTriplet(const std::string &s, const std::string &p, const std::string &o) {
+        std::unique_lock<std::mutex> lock(write_mutex_);
+        return insert(s, p, o);
+    }
+
+    /* a snapshot of the latest version, the pending writes are published firstly unless a writer is running */
+    std::shared_ptr<const Snapshot> snapshot();
+
+    /* a snapshot of every finished write, a running writer is waited for */
+    std::shared_ptr<const Snapshot> current();
+
     bool insert(const std::string &s, const std::string &p, const std::string &o) {
+        stale_ = true;
+        ++ generation_;
         triplet_size_ ++;
+        characteristic_changes_ ++;
 
         if (!p2id_.count(p)) {
             p2id_[p] = ++ predicate_size_;
@@ -97,26 +364,34 @@ public:
             id2p_count_[p2id_[p]]++;
         }
 
-        if (!so2id_.count(s)) {
-            so2id_[s] = ++ entity_size_;
-            id2so_.emplace_back(s);
-            id2so_count_.emplace_back(1);
-        } else {
-            id2so_count_[so2id_[s]]++;
-        }
-
-        if (!so2id_.count(o)) {
-            so2id_[o] = ++ entity_size_;
-            id2so_.emplace_back(o);
-            id2so_count_.emplace_back(1);
-        } else {
-            id2so_count_[so2id_[o]]++;
-        }
+        uint32_t sid = encode_entity_(s, 1, 1);
+        uint32_t oid = encode_entity_(o, 1, 0);
 
-        predicate_indexed_storage_[p2id_[p]].insert({so2id_[s], so2id_[o]});
+        pending_storage_[p2id_[p]].emplace_back(sid, oid);
         return true;
     }
 
+    /* get the index of @pid, pending inserted pairs are overlaid on it firstly.
+     * A lazily loaded database pages the predicate in on its first access */
+    const entity_pair_set &getIndex(const uint32_t &pid) {
+        std::unique_lock<std::mutex> lock(cache_mutex_, std::defer_lock);
+        if (lazy_) {
+            lock.lock();
+        }
+        if (!pending_storage_.empty()) {
+            overlay_pending_(pid);
+        }
+        if (lazy_) {
+            return page_in_(pid);
+        }
+        auto iter = predicate_indexed_storage_.find(pid);
+        if (iter == predicate_indexed_storage_.end()) {
+            static const entity_pair_set empty;
+            return empty;
+        }
+        return iter->second;
+    }
+
     bool save() {
         if (db_name_.empty()) {
             spdlog::info("Save Failed! Haven't specified a database yet, "
@@ -126,7 +401,14 @@ public:
         return save(db_name_);
     }
 
+    /* store the database as @db_name. Storing the loaded database is a checkpoint, `info` holds the sequence
+     * number of the newest logged batch, then the log is emptied.
+     * The rewritten files are staged beside the stored ones and committed at once by the `checkpoint` file,
+     * then installed, so a crash never leaves the files of a part of a checkpoint (see `recover_checkpoint_`).
+     * The files of the loaded database are updated incrementally: only the changed predicates and entity counters
+     * are rewritten, and the new entities are appended to the dictionary */
     bool save(const std::string &db_name) {
+        std::unique_lock<std::mutex> lock(write_mutex_);
         fs::ofstream::sync_with_stdio(false);
 
         fs::path db_path = fs::current_path().append(db_name + ".db");
@@ -137,32 +419,88 @@ public:
         if (!fs::exists(db_path / triplet_path_)) {
             fs::create_directories(db_path / triplet_path_);
         }
+        if (!fs::exists(db_path / reverse_triplet_path_)) {
+            fs::create_directories(db_path / reverse_triplet_path_);
+        }
 
-        auto info_store_task = std::async(std::launch::async,
-                                          &DatabaseBuilder::Impl::store_basic_info,
-                                          this,
-                                          db_path / info_path_);
-
-        auto pid_store_task = std::async(std::launch::async,
-                                          &DatabaseBuilder::Impl::store_predicate_ids_,
-                                          this,
-                                         db_path / id_predicates_path_);
+        {
+            std::unique_lock<std::mutex> cache_lock(cache_mutex_, std::defer_lock);
+            if (lazy_) {
+                cache_lock.lock();
+            }
+            if (!flush_pending_()) {
+                return false;
+            }
+        }
 
-        auto soid_store_task = std::async(std::launch::async,
-                                         &DatabaseBuilder::Impl::store_entity_ids_,
-                                         this,
-                                          db_path / id_entities_path_);
+        bool incremental = saved_ && db_name == db_name_ && !checkpoint_aborted_;
+        bool stored = true;
+        // the statistics of the predicates change with their pairs only
+        if (!incremental || !dirty_.empty() || !fs::exists(db_path / predicate_statistics_path_)) {
+            auto pid_store_task = pool_->submit(&DatabaseBuilder::Impl::store_predicate_ids_,
+                                                this,
+                                                staged_(db_path / id_predicates_path_));
+            stored = PredicateStatistics::Store(staged_(db_path / predicate_statistics_path_).string(),
+                                                predicate_statistics_);
+            stored = pool_->wait(pid_store_task) && stored;
+        }
+        // the characteristic sets read every predicate, so they are only rebuilt once enough triplets changed
+        if (!incremental || characteristic_changes_ * CHARACTERISTIC_SETS_RATIO > triplet_size_ ||
+            !fs::exists(db_path / characteristic_sets_path_)) {
+            std::unique_lock<std::mutex> cache_lock(cache_mutex_, std::defer_lock);
+            if (lazy_) {
+                cache_lock.lock();
+            }
+            compute_characteristic_sets_(fs::current_path().append(db_name_ + ".db"));
+            stored = characteristic_sets_->save(staged_(db_path / characteristic_sets_path_).string()) && stored;
+        }
 
-        auto triplet_store_task = std::async(std::launch::async,
-                                         &DatabaseBuilder::Impl::store_triplet_,
-                                         this,
-                                             db_path / triplet_path_);
+        auto soid_store_task = pool_->submit(&DatabaseBuilder::Impl::store_entity_ids_,
+                                             this,
+                                             db_path / id_entities_path_, incremental);
+
+        auto triplet_store_task = pool_->submit(&DatabaseBuilder::Impl::store_triplet_,
+                                                this,
+                                                db_path / triplet_path_, incremental);
+
+        stored = pool_->wait(triplet_store_task) && stored;
+        stored = pool_->wait(soid_store_task) && stored;
+
+        // the staged files have to be on disk before they are committed, and installed before the log is emptied
+        bool checkpoint = db_name == db_name_ && wal_.isOpen();
+        uint64_t sequence = checkpoint ? wal_.sequence() : 0;
+        if (!stored || !store_basic_info(staged_(db_path / info_path_), sequence) ||
+            !sync_stored_(db_path) || !commit_checkpoint_(db_path, sequence)) {
+            discard_checkpoint_(db_path);
+            checkpoint_aborted_ = true;
+            return false;
+        }
+        // a failed install is finished by the next load, which finds the committed checkpoint
+        if (!install_checkpoint_(db_path)) {
+            return false;
+        }
+        checkpoint_aborted_ = false;
+        if (checkpoint) {
+            checkpoint_sequence_ = sequence;
+            wal_.reset();
+        }
 
-        triplet_store_task.get();
-        info_store_task.get();
-        pid_store_task.get();
-        soid_store_task.get();
+        if (db_name == db_name_) {
+            // the changed predicates are on disk now, a lazily loaded database can evict them again
+            std::unique_lock<std::mutex> cache_lock(cache_mutex_, std::defer_lock);
+            if (lazy_) {
+                cache_lock.lock();
+            }
+            saved_ = true;
+            dirty_.clear();
+            unsaved_count_chunks_.clear();
+            if (lazy_) {
+                evict_(0);
+            }
+        }
 
+        // the dictionary may have merged its tail into the blocks, share them with the readers
+        publish_();
         return true;
     }
 
@@ -175,22 +513,36 @@ public:
         }
         db_name_ = db_name;
 
+        recover_checkpoint_(db_path);
         load_basic_info(db_path / info_path_);
 
-        auto pid_load_task = std::async(std::launch::async,
-                                        &DatabaseBuilder::Impl::load_predicate_ids_,
-                                        this,
-                                        db_path / id_predicates_path_,
-                                        predicate_size_);
+        auto pid_load_task = pool_->submit(&DatabaseBuilder::Impl::load_predicate_ids_,
+                                           this,
+                                           db_path / id_predicates_path_,
+                                           predicate_size_);
 
-        auto soid_load_task = std::async(std::launch::async,
-                                         &DatabaseBuilder::Impl::load_entity_ids_,
-                                         this,
-                                         db_path / id_entities_path_,
-                                         entity_size_);
+        auto soid_load_task = pool_->submit(&DatabaseBuilder::Impl::load_entity_ids_,
+                                            this,
+                                            db_path / id_entities_path_,
+                                            entity_size_);
 
-        pid_load_task.get();
-        soid_load_task.get();
+        pool_->wait(pid_load_task);
+        pool_->wait(soid_load_task);
+        load_statistics_(db_path);
+        saved_ = true;
+        open_wal_(db_path);
+
+        std::unique_lock<std::mutex> lock(write_mutex_);
+        publish_(true);
+    }
+
+    /* load the basic information of @db_name, the predicates are paged in when they are accessed,
+     * and the least recently used ones are evicted once they take more than @memory_limit bytes */
+    void loadLazy(const std::string &db_name, const size_t &memory_limit) {
+        // the deletions replayed by `loadBasic` page their predicates in
+        lazy_ = true;
+        cache_limit_ = memory_limit;
+        loadBasic(db_name);
     }
 
     void loadAll(const std::string &db_name) {
@@ -203,29 +555,37 @@ public:
         }
         db_name_ = db_name;
 
+        recover_checkpoint_(db_path);
         load_basic_info(db_path / info_path_);
 
-        auto pid_load_task = std::async(std::launch::async,
-                                         &DatabaseBuilder::Impl::load_predicate_ids_,
-                                         this,
-                                         db_path / id_predicates_path_,
-                                         predicate_size_);
-
-        auto soid_load_task = std::async(std::launch::async,
-                                          &DatabaseBuilder::Impl::load_entity_ids_,
-                                          this,
-                                          db_path / id_entities_path_,
-                                          entity_size_);
-
-        auto triplet_load_task = std::async(std::launch::async,
-                                             &DatabaseBuilder::Impl::load_all_triplet_,
-                                             this,
-                                             db_path / triplet_path_,
-                                             predicate_size_);
+        auto pid_load_task = pool_->submit(&DatabaseBuilder::Impl::load_predicate_ids_,
+                                           this,
+                                           db_path / id_predicates_path_,
+                                           predicate_size_);
+
+        auto soid_load_task = pool_->submit(&DatabaseBuilder::Impl::load_entity_ids_,
+                                            this,
+                                            db_path / id_entities_path_,
+                                            entity_size_);
+
+        auto triplet_load_task = pool_->submit(&DatabaseBuilder::Impl::load_all_triplet_,
+                                               this,
+                                               db_path / triplet_path_,
+                                               predicate_size_);
+
+        pool_->wait(pid_load_task);
+        pool_->wait(soid_load_task);
+        if (!pool_->wait(triplet_load_task)) {
+            spdlog::error("the triplet files of <{}> cannot be read, it isn't loaded.", db_path.string());
+            unload();
+            return;
+        }
+        load_statistics_(db_path);
+        saved_ = true;
+        open_wal_(db_path);
 
-        pid_load_task.get();
-        soid_load_task.get();
-        triplet_load_task.get();
+        std::unique_lock<std::mutex> lock(write_mutex_);
+        publish_(true);
     }
 
     void loadPartial(const std::string &db_name, const std::vector<std::string> &predicate_indexed_list) {
@@ -237,22 +597,21 @@ public:
         }
         db_name_ = db_name;
 
+        recover_checkpoint_(db_path);
         load_basic_info(db_path / info_path_);
 
-        auto pid_load_task = std::async(std::launch::async,
-                                        &DatabaseBuilder::Impl::load_predicate_ids_,
-                                        this,
-                                        db_path / id_predicates_path_,
-                                        predicate_size_);
+        auto pid_load_task = pool_->submit(&DatabaseBuilder::Impl::load_predicate_ids_,
+                                           this,
+                                           db_path / id_predicates_path_,
+                                           predicate_size_);
 
-        auto soid_load_task = std::async(std::launch::async,
-                                         &DatabaseBuilder::Impl::load_entity_ids_,
-                                         this,
-                                         db_path / id_entities_path_,
-                                         entity_size_);
+        auto soid_load_task = pool_->submit(&DatabaseBuilder::Impl::load_entity_ids_,
+                                            this,
+                                            db_path / id_entities_path_,
+                                            entity_size_);
 
-        pid_load_task.get();
-        soid_load_task.get();
+        pool_->wait(pid_load_task);
+        pool_->wait(soid_load_task);
 
         std::vector<uint32_t> pid_list;
         pid_list.reserve(predicate_indexed_list.size());
@@ -270,31 +629,140 @@ public:
 //        triplet_load_task.get();
 
         // Read data asynchronously
-        std::vector<std::future<entity_pair_set>> task_list;
-        task_list.reserve(pid_list.size());
-        for (const auto &pid : pid_list) {
-           task_list.emplace_back(std::async(std::launch::async,
-                                             &DatabaseBuilder::Impl::load_triplet_with_pid_,
-                                             this,
-                                             db_path/triplet_path_
-                                             ,pid));
+        if (!load_triplet_with_pids_(db_path / triplet_path_, pid_list)) {
+            spdlog::error("the triplet files of <{}> cannot be read, it isn't loaded.", db_path.string());
+            unload();
+            return;
         }
-        for(int i = 0; i < pid_list.size(); i++) {
-            predicate_indexed_storage_.emplace(pid_list[i], std::move(task_list[i].get()));
+        load_statistics_(db_path);
+        saved_ = true;
+        open_wal_(db_path);
+
+        std::unique_lock<std::mutex> lock(write_mutex_);
+        publish_(true);
+    }
+
+    /* convert the text or older binary triplet files of database @db_name into the current binary format */
+    bool convert(const std::string &db_name) {
+        fs::path db_path = fs::current_path().append(db_name + ".db");
+        if (!fs::exists(db_path)) {
+            spdlog::info("<{}> doesn't exist, create or build it firstly please.", db_path.string());
+            return false;
         }
+
+        initialize_();
+        recover_checkpoint_(db_path);
+        load_basic_info(db_path / info_path_);
+        bool has_statistics = fs::exists(db_path / predicate_statistics_path_) &&
+                              fs::exists(db_path / entity_subject_count_path_);
+
+        if (!fs::exists(db_path / reverse_triplet_path_)) {
+            fs::create_directories(db_path / reverse_triplet_path_);
+        }
+
+        if (Dictionary::FileVersion((db_path / id_entities_path_).string()) != Dictionary::CurrentFileVersion()) {
+            if (!load_entity_ids_(db_path / id_entities_path_, entity_size_) ||
+                !store_entity_ids_(db_path / id_entities_path_, false) || !install_checkpoint_(db_path)) {
+                return false;
+            }
+            spdlog::info("`id_entities` of <{}> has been converted.", db_name);
+        }
+
+        size_t converted = 0;
+        for (uint32_t pid = 1; pid <= predicate_size_; ++pid) {
+            fs::path child_path = db_path / triplet_path_ / fs::path(std::to_string(pid));
+            fs::path reverse_path = db_path / reverse_triplet_path_ / fs::path(std::to_string(pid));
+            uint32_t version = CsrIndex::FileVersion(child_path.string());
+            if (version == CsrIndex::CurrentFileVersion() &&
+                CsrIndex::FileVersion(reverse_path.string()) == CsrIndex::CurrentFileVersion()) {
+                continue;
+            }
+
+            CsrIndex index;
+            if (version == 0) {
+                // legacy text file, one "sid oid" pair per line
+                fs::ifstream in(child_path, fs::ifstream::in | fs::ifstream::binary);
+                if (!in.is_open()) {
+                    spdlog::error("convert function occurs problem, "
+                                  "`{}` cannot be read.", child_path.string());
+                    return false;
+                }
+                entity_pair_list pairs;
+                uint32_t sid, oid;
+                while (in >> sid >> oid) {
+                    pairs.emplace_back(sid, oid);
+                }
+                in.close();
+                index = CsrIndex::Build(pairs);
+            } else if (!CsrIndex::Load(child_path.string(), index)) {
+                return false;
+            }
+
+            if (!reverse_(index).save(reverse_path.string())) {
+                return false;
+            }
+            if (version != CsrIndex::CurrentFileVersion() && !index.save(child_path.string())) {
+                return false;
+            }
+            converted++;
+        }
+
+        spdlog::info("{} triplet file(s) of <{}> have been converted.", converted, db_name);
+
+        if (!has_statistics) {
+            if (!compute_statistics_(db_path) ||
+                !PredicateStatistics::Store((db_path / predicate_statistics_path_).string(), predicate_statistics_) ||
+                !store_entity_counts_(db_path / entity_subject_count_path_, id2s_count_, false, 0) ||
+                !install_checkpoint_(db_path)) {
+                return false;
+            }
+            spdlog::info("the statistics of <{}> have been computed.", db_name);
+        }
+        if (!fs::exists(db_path / characteristic_sets_path_)) {
+            compute_characteristic_sets_(db_path);
+            if (!characteristic_sets_->save((db_path / characteristic_sets_path_).string())) {
+                return false;
+            }
+            spdlog::info("the characteristic sets of <{}> have been computed.", db_name);
+        }
+        return true;
     }
 
-        void unload() {
+    void unload() {
+        if (checkpoint_task_.valid()) {
+            checkpoint_task_.wait();
+        }
+        for (auto &task : compaction_tasks_) {
+            task.second.wait();
+        }
+        compaction_tasks_.clear();
+
+        std::unique_lock<std::mutex> lock(write_mutex_);
+        wal_.close();
+        checkpoint_sequence_ = 0;
         db_name_.clear();
         predicate_size_ = 0;
         entity_size_ = 0;
         triplet_size_ = 0;
         id2p_count_.clear();
-        so2id_.clear();
+        id2so_count_.clear();
+        id2s_count_.clear();
+        predicate_statistics_.clear();
+        characteristic_sets_ = std::make_shared<const CharacteristicSets>();
+        characteristic_changes_ = 0;
         p2id_.clear();
-        id2so_.clear();
+        entities_.clear();
         id2p_.clear();
         predicate_indexed_storage_.clear();
+        pending_storage_.clear();
+        lru_.clear();
+        lru_index_.clear();
+        dirty_.clear();
+        saved_ = false;
+        unsaved_count_chunks_.clear();
+        cache_size_ = 0;
+        lazy_ = false;
+        publish_(true);
     }
 //
 //    uint32_t getPredicateId(const std::string &p) const {
@@ -366,28 +834,862 @@ public:
 //        return ret;
 //    }
 
-//    std::set<std::pair<uint32_t, uint32_t>> getSOByP(const uint32_t &pid) {
-//        return predicate_indexed_storage_[pid];
-//    }
+//    std::set<std::pair<uint32_t, uint32_t>> getSOByP(const uint32_t &pid) {
+//        return predicate_indexed_storage_[pid];
+//    }
+
+private:
+    struct string_view_hash {
+        size_t operator()(const boost::string_view &str) const {
+            return boost::hash_range(str.begin(), str.end());
+        }
+    };
+
+    using term_map = std::unordered_map<boost::string_view, uint32_t, string_view_hash>;
+
+    /* terms and triplets of one byte range of the data file, encoded with chunk-local ids */
+    struct parsed_chunk {
+        std::vector<boost::string_view> entities;   // local entity id -> term, in first-occurrence order
+        std::vector<boost::string_view> predicates; // local predicate id -> term, in first-occurrence order
+        std::vector<uint32_t> entity_count;
+        std::vector<uint32_t> subject_count;        // number of the triplets whose subject is the local entity
+        std::vector<uint32_t> predicate_count;
+        std::vector<uint32_t> triplets;             // local <s, p, o> ids
+    };
+
+    /* insert all triplets between @begin and @end, which is the content of a data file,
+     * each line is `<s> <p> <o> .`. The content is split into byte ranges at line boundaries,
+     * every range is tokenized and encoded with local ids in parallel, then the local ids are
+     * mapped to global ones chunk by chunk in file order, so the ids are identical to inserting
+     * the triplets one by one. */
+    size_t bulk_insert_(const char *begin, const char *end) {
+        size_t chunk_num = std::max<size_t>(1, std::min<size_t>(thread_num_, (end - begin) >> 16));
+        std::vector<const char *> bounds{begin};
+        for (size_t i = 1; i < chunk_num; ++i) {
+            const char *bound = std::max(bounds.back(), begin + (end - begin) / chunk_num * i);
+            bound = std::find(bound, end, '\n');
+            bounds.emplace_back(bound == end ? end : bound + 1);
+        }
+        bounds.emplace_back(end);
+
+        // 1. tokenize and encode every chunk with local ids
+        std::vector<std::future<parsed_chunk>> parse_tasks;
+        for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+            parse_tasks.emplace_back(pool_->submit(&DatabaseBuilder::Impl::parse_chunk_,
+                                                   bounds[i], bounds[i + 1]));
+        }
+        std::vector<parsed_chunk> chunks;
+        chunks.reserve(parse_tasks.size());
+        for (auto &task : parse_tasks) {
+            chunks.emplace_back(pool_->wait(task));
+        }
+
+        // 2. assign global ids in file order
+        std::vector<std::vector<uint32_t>> entity_ids(chunks.size());
+        std::vector<std::vector<uint32_t>> predicate_ids(chunks.size());
+        size_t affect = 0;
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            const auto &chunk = chunks[i];
+            predicate_ids[i].reserve(chunk.predicates.size());
+            for (size_t k = 0; k < chunk.predicates.size(); ++k) {
+                predicate_ids[i].emplace_back(encode_predicate_(chunk.predicates[k].to_string(),
+                                                                chunk.predicate_count[k]));
+            }
+            entity_ids[i].reserve(chunk.entities.size());
+            for (size_t k = 0; k < chunk.entities.size(); ++k) {
+                entity_ids[i].emplace_back(encode_entity_(chunk.entities[k].to_string(),
+                                                          chunk.entity_count[k], chunk.subject_count[k]));
+            }
+            affect += chunk.triplets.size() / 3;
+        }
+        triplet_size_ += affect;
+        characteristic_changes_ += affect;
+
+        // 3. map local ids to global ones and group the pairs by predicate
+        std::vector<std::future<std::vector<entity_pair_list>>> encode_tasks;
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            encode_tasks.emplace_back(pool_->submit([&, i]() {
+                std::vector<entity_pair_list> pairs(predicate_size_ + 1);
+                const auto &triplets = chunks[i].triplets;
+                for (size_t k = 0; k < triplets.size(); k += 3) {
+                    pairs[predicate_ids[i][triplets[k + 1]]].emplace_back(entity_ids[i][triplets[k]],
+                                                                          entity_ids[i][triplets[k + 2]]);
+                }
+                return pairs;
+            }));
+        }
+        for (auto &task : encode_tasks) {
+            auto pairs = pool_->wait(task);
+            for (uint32_t pid = 1; pid < pairs.size(); ++pid) {
+                if (pairs[pid].empty()) {
+                    continue;
+                }
+                auto &pending = pending_storage_[pid];
+                if (pending.empty()) {
+                    pending = std::move(pairs[pid]);
+                } else {
+                    pending.insert(pending.end(), pairs[pid].begin(), pairs[pid].end());
+                }
+            }
+        }
+
+        return affect;
+    }
+
+    /* tokenize the lines between @begin and @end, same as `infile >> s >> p; infile.ignore(); getline(infile, o)`
+     * followed by stripping the trailing " ." of o */
+    static parsed_chunk parse_chunk_(const char *begin, const char *end) {
+        parsed_chunk chunk;
+        term_map entity_map, predicate_map;
+
+        auto encode = [](term_map &map, std::vector<boost::string_view> &terms,
+                         std::vector<uint32_t> &count, const boost::string_view &term) {
+            auto ret = map.emplace(term, static_cast<uint32_t>(terms.size()));
+            if (ret.second) {
+                terms.emplace_back(term);
+                count.emplace_back(0);
+            }
+            count[ret.first->second]++;
+            return ret.first->second;
+        };
+        auto is_space = [](char ch) { return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n'; };
+        auto token = [&](const char *&ptr, const char *line_end) {
+            while (ptr < line_end && is_space(*ptr)) ++ptr;
+            const char *token_begin = ptr;
+            while (ptr < line_end && !is_space(*ptr)) ++ptr;
+            return boost::string_view(token_begin, ptr - token_begin);
+        };
+
+        for (const char *line = begin; line < end; ) {
+            const char *line_end = std::find(line, end, '\n');
+            const char *ptr = line;
+            const char *next = line_end == end ? end : line_end + 1;
+
+            boost::string_view s = token(ptr, line_end);
+            boost::string_view p = token(ptr, line_end);
+            if (s.empty() || s[0] == '#' || p.empty() || ptr + 1 >= line_end) {
+                line = next;
+                continue;
+            }
+
+            // skip the separator after p, drop the last character, then strip trailing ' ' and '.'
+            const char *o_begin = ptr + 1;
+            const char *o_end = line_end - 1;
+            while (o_end > o_begin && (o_end[-1] == ' ' || o_end[-1] == '.')) --o_end;
+            boost::string_view o(o_begin, o_end - o_begin);
+
+            uint32_t pid = encode(predicate_map, chunk.predicates, chunk.predicate_count, p);
+            uint32_t sid = encode(entity_map, chunk.entities, chunk.entity_count, s);
+            uint32_t oid = encode(entity_map, chunk.entities, chunk.entity_count, o);
+            chunk.subject_count.resize(chunk.entities.size(), 0);
+            chunk.subject_count[sid]++;
+            chunk.triplets.emplace_back(sid);
+            chunk.triplets.emplace_back(pid);
+            chunk.triplets.emplace_back(oid);
+
+            line = next;
+        }
+        return chunk;
+    }
+
+    uint32_t encode_predicate_(const std::string &p, const uint32_t &count) {
+        auto iter = p2id_.find(p);
+        if (iter != p2id_.end()) {
+            id2p_count_[iter->second] += count;
+            return iter->second;
+        }
+        p2id_[p] = ++ predicate_size_;
+        id2p_.emplace_back(p);
+        id2p_count_.emplace_back(count);
+        return predicate_size_;
+    }
+
+    /* @count triplets have entity @so, it is the subject of @subject_count of them */
+    uint32_t encode_entity_(const std::string &so, const uint32_t &count, const uint32_t &subject_count) {
+        auto ret = entities_.insert(so);
+        if (!ret.second) {
+            id2so_count_[ret.first] += count;
+            id2s_count_[ret.first] += subject_count;
+            changed_count_chunks_.insert(ret.first / COUNT_CHUNK_SIZE);
+            unsaved_count_chunks_.insert(ret.first / COUNT_CHUNK_SIZE);
+            return ret.first;
+        }
+        ++ entity_size_;
+        id2so_count_.emplace_back(count);
+        id2s_count_.emplace_back(subject_count);
+        return ret.first;
+    }
+
+    /* one <pid, key, value> triplet of a sorted run file */
+    struct run_record {
+        uint32_t pid;
+        uint32_t key;
+        uint32_t value;
+
+        bool operator<(const run_record &other) const {
+            return std::tie(pid, key, value) < std::tie(other.pid, other.key, other.value);
+        }
+    };
+
+    /* sequential buffered reader of a run file */
+    class run_reader {
+    public:
+        run_reader(const fs::path &path, const size_t &buffer_size)
+            : in_(path, fs::ifstream::in | fs::ifstream::binary), buffer_(buffer_size), pos_(0), size_(0) {}
+
+        bool next(run_record &record) {
+            if (pos_ == size_) {
+                in_.read(reinterpret_cast<char *>(buffer_.data()), buffer_.size() * sizeof(run_record));
+                size_ = static_cast<size_t>(in_.gcount()) / sizeof(run_record);
+                pos_ = 0;
+                if (size_ == 0) {
+                    return false;
+                }
+            }
+            record = buffer_[pos_++];
+            return true;
+        }
+
+    private:
+        fs::ifstream in_;
+        std::vector<run_record> buffer_;
+        size_t pos_;
+        size_t size_;
+    };
+
+    /* write the pending pairs into run @forward_path as sorted <pid, s, o>
+     * and into run @reverse_path as sorted <pid, o, s>, the pending pairs are consumed */
+    bool spill_pending_(const fs::path &forward_path, const fs::path &reverse_path) {
+        std::vector<uint32_t> pid_list;
+        pid_list.reserve(pending_storage_.size());
+        for (const auto &pending : pending_storage_) {
+            pid_list.emplace_back(pending.first);
+        }
+        std::sort(pid_list.begin(), pid_list.end());
+
+        auto sort_pending = [&](bool reverse) {
+            std::vector<std::future<void>> task_list;
+            task_list.reserve(pid_list.size());
+            for (const auto &pid : pid_list) {
+                auto &pairs = pending_storage_.at(pid);
+                task_list.emplace_back(pool_->submit([&pairs, reverse]() {
+                    if (reverse) {
+                        for (auto &so : pairs) {
+                            std::swap(so.first, so.second);
+                        }
+                    }
+                    std::sort(pairs.begin(), pairs.end());
+                }));
+            }
+            for (auto &task : task_list) {
+                pool_->wait(task);
+            }
+        };
+        auto write_run = [&](const fs::path &path) {
+            fs::ofstream out(path, fs::ofstream::out | fs::ofstream::binary);
+            std::vector<run_record> buffer;
+            buffer.reserve(1 << 16);
+            for (const auto &pid : pid_list) {
+                for (const auto &kv : pending_storage_.at(pid)) {
+                    buffer.push_back({pid, kv.first, kv.second});
+                    if (buffer.size() == buffer.capacity()) {
+                        out.write(reinterpret_cast<const char *>(buffer.data()), buffer.size() * sizeof(run_record));
+                        buffer.clear();
+                    }
+                }
+            }
+            out.write(reinterpret_cast<const char *>(buffer.data()), buffer.size() * sizeof(run_record));
+            out.close();
+            if (!out) {
+                spdlog::error("spill_pending_ function occurs problem, "
+                              "`{}` cannot be written.", path.string());
+                return false;
+            }
+            return true;
+        };
+
+        sort_pending(false);
+        if (!write_run(forward_path)) {
+            return false;
+        }
+        sort_pending(true);
+        if (!write_run(reverse_path)) {
+            return false;
+        }
+        pending_storage_.clear();
+        return true;
+    }
+
+    /* k-way merge the sorted runs @run_list, the pairs of every pid are streamed into triplet file `@path/<pid>` */
+    bool merge_runs_(const std::vector<fs::path> &run_list, const fs::path &path) {
+        using run_entry = std::pair<run_record, size_t>;
+        auto greater = [](const run_entry &lhs, const run_entry &rhs) { return rhs < lhs; };
+        std::priority_queue<run_entry, std::vector<run_entry>, decltype(greater)> heap(greater);
+
+        // the budget is shared by the readers of both forward and reverse merge
+        size_t buffer_size = std::max<size_t>(memory_limit_ / 2 / std::max<size_t>(1, run_list.size())
+                                              / sizeof(run_record), 1024);
+        std::vector<std::unique_ptr<run_reader>> readers;
+        readers.reserve(run_list.size());
+        for (const auto &run : run_list) {
+            readers.emplace_back(new run_reader(run, buffer_size));
+            run_record record{};
+            if (readers.back()->next(record)) {
+                heap.emplace(record, readers.size() - 1);
+            }
+        }
+
+        std::unique_ptr<CsrIndex::Writer> writer;
+        uint32_t pid = 0;
+        while (!heap.empty()) {
+            run_entry top = heap.top();
+            heap.pop();
+            if (!writer || top.first.pid != pid) {
+                if (writer && !writer->close()) {
+                    return false;
+                }
+                pid = top.first.pid;
+                writer.reset(new CsrIndex::Writer((path / fs::path(std::to_string(pid))).string()));
+            }
+            writer->append(top.first.key, top.first.value);
+
+            if (readers[top.second]->next(top.first)) {
+                heap.push(top);
+            }
+        }
+        return !writer || writer->close();
+    }
+
+    /* rebuild the CSR index of the predicates which have pending inserted pairs or a delta overlay,
+     * which is done by `save` only, a write overlays its pairs instead, see `overlay_pending_`.
+     * It fails without changing anything if the stored pairs of a predicate cannot be read */
+    bool flush_pending_() {
+        std::vector<uint32_t> pid_list;
+        pid_list.reserve(pending_storage_.size());
+        for (const auto &pending : pending_storage_) {
+            if (!load_for_write_(pending.first)) {
+                return false;
+            }
+        }
+        for (const auto &pending : pending_storage_) {
+            dirty_.insert(pending.first);
+            pid_list.emplace_back(pending.first);
+        }
+        // the overlaid predicates are unsaved, so they are resident. The statistics of the tombstoned ones
+        // are summarized again, which a deletion only adjusts
+        std::vector<uint32_t> tombstoned;
+        for (const auto &pid : dirty_) {
+            auto iter = predicate_indexed_storage_.find(pid);
+            if (pending_storage_.count(pid) || iter == predicate_indexed_storage_.end()) {
+                continue;
+            }
+            if (iter->second.s2o.deltaSize() > 0) {
+                pid_list.emplace_back(pid);
+            } else if (iter->second.s2o.tombstoneSize() > 0) {
+                tombstoned.emplace_back(pid);
+            }
+        }
+
+        std::vector<std::future<entity_pair_set>> task_list;
+        task_list.reserve(pid_list.size());
+        for (const auto &pid : pid_list) {
+            task_list.emplace_back(pool_->submit(&DatabaseBuilder::Impl::merge_pending_, this, pid));
+        }
+        // the tasks read `predicate_indexed_storage_`, so it isn't changed until all of them are done
+        std::vector<entity_pair_set> merged;
+        merged.reserve(pid_list.size());
+        for (auto &task : task_list) {
+            merged.emplace_back(pool_->wait(task));
+        }
+        for (size_t i = 0; i < pid_list.size(); ++i) {
+            predicate_indexed_storage_[pid_list[i]] = std::move(merged[i]);
+            if (lazy_) {
+                account_(pid_list[i]);
+            }
+        }
+        pending_storage_.clear();
+        pid_list.insert(pid_list.end(), tombstoned.begin(), tombstoned.end());
+        if (!pid_list.empty()) {
+            refresh_statistics_(pid_list);
+        }
+        return true;
+    }
+
+    /* add the pending inserted pairs of every predicate to its index as a delta overlay */
+    void overlay_pending_() {
+        std::vector<uint32_t> pid_list;
+        pid_list.reserve(pending_storage_.size());
+        for (const auto &pending : pending_storage_) {
+            pid_list.emplace_back(pending.first);
+        }
+        for (const auto &pid : pid_list) {
+            overlay_pending_(pid);
+        }
+    }
+
+    /* add the pending inserted pairs of @pid to its index as a delta overlay, which costs the size of the
+     * overlay rather than a rebuild of the predicate. The overlay is merged by the next checkpoint */
+    void overlay_pending_(const uint32_t &pid) {
+        auto pending = pending_storage_.find(pid);
+        // the pairs stay pending if the stored ones cannot be read, they would be lost by the checkpoint
+        if (pending == pending_storage_.end() || !load_for_write_(pid)) {
+            return;
+        }
+        // unsaved pairs are only in memory, a lazily loaded database keeps the predicate resident until `save`
+        dirty_.insert(pid);
+        entity_pair_list pairs = std::move(pending->second);
+        pending_storage_.erase(pending);
+        entity_pair_list reversed;
+        reversed.reserve(pairs.size());
+        for (const auto &so : pairs) {
+            reversed.emplace_back(so.second, so.first);
+        }
+
+        entity_pair_set &pair_set = predicate_indexed_storage_[pid];
+        size_t subjects = pair_set.s2o.keySize();
+        size_t objects = pair_set.o2s.keySize();
+        pair_set.s2o.insert(std::move(pairs));
+        pair_set.o2s.insert(std::move(reversed));
+        if (lazy_) {
+            account_(pid);
+        }
+
+        if (pair_set.s2o.deltaSize() == 0) {
+            // a tombstoned pair was inserted again, which rebuilt the index
+            refresh_statistics_({pid});
+            return;
+        }
+        // the sizes are kept exact, the degrees of the keys are summarized again by the checkpoint
+        if (predicate_statistics_.size() <= predicate_size_) {
+            predicate_statistics_.resize(predicate_size_ + 1);
+        }
+        PredicateStatistics &statistics = predicate_statistics_[pid];
+        statistics.size = pair_set.s2o.size();
+        statistics.subjects.distinct += static_cast<uint32_t>(pair_set.s2o.keySize() - subjects);
+        statistics.objects.distinct += static_cast<uint32_t>(pair_set.o2s.keySize() - objects);
+        statistics_changed_ = true;
+    }
+
+    /* recompute the statistics of the predicates of @pid_list from their indexes, which are resident */
+    void refresh_statistics_(const std::vector<uint32_t> &pid_list) {
+        if (predicate_statistics_.size() <= predicate_size_) {
+            predicate_statistics_.resize(predicate_size_ + 1);
+        }
+        auto compute = [this](const uint32_t &pid) {
+            const entity_pair_set &pair_set = predicate_indexed_storage_.at(pid);
+            return PredicateStatistics::Compute(pair_set.s2o, pair_set.o2s);
+        };
+        if (pid_list.size() == 1) {
+            predicate_statistics_[pid_list[0]] = compute(pid_list[0]);
+        } else {
+            std::vector<std::future<PredicateStatistics>> task_list;
+            task_list.reserve(pid_list.size());
+            for (const auto &pid : pid_list) {
+                task_list.emplace_back(pool_->submit(compute, pid));
+            }
+            for (size_t i = 0; i < pid_list.size(); ++i) {
+                predicate_statistics_[pid_list[i]] = pool_->wait(task_list[i]);
+            }
+        }
+        statistics_changed_ = true;
+    }
+
+    /* load the stored pairs of @pid if it isn't loaded by `LoadBasic` or `LoadPartial`, before it is changed,
+     * false if its triplet file cannot be read */
+    bool load_stored_(const uint32_t &pid) {
+        if (!saved_ || predicate_indexed_storage_.count(pid)) {
+            return true;
+        }
+        fs::path db_path = fs::current_path().append(db_name_ + ".db");
+        if (!fs::exists(db_path / triplet_path_ / fs::path(std::to_string(pid)))) {
+            return true;
+        }
+        entity_pair_set pair_set;
+        if (!load_triplet_with_pid_(db_path / triplet_path_, pid, pair_set)) {
+            return false;
+        }
+        predicate_indexed_storage_.emplace(pid, std::move(pair_set));
+        return true;
+    }
+
+    /* make @pid resident and the most recently used one, then evict the cold predicates over the budget.
+     * A predicate whose triplet file cannot be read is empty and isn't kept, so it is read again next time */
+    const entity_pair_set &page_in_(const uint32_t &pid) {
+        static const entity_pair_set empty;
+        auto iter = predicate_indexed_storage_.find(pid);
+        if (iter == predicate_indexed_storage_.end()) {
+            if (pid == 0 || pid > predicate_size_) {
+                return empty;
+            }
+            // a predicate created after the last checkpoint has no triplet file yet
+            fs::path db_path = fs::current_path().append(db_name_ + ".db");
+            entity_pair_set pair_set;
+            if (fs::exists(db_path / triplet_path_ / fs::path(std::to_string(pid))) &&
+                !load_triplet_with_pid_(db_path / triplet_path_, pid, pair_set)) {
+                return empty;
+            }
+            iter = predicate_indexed_storage_.emplace(pid, std::move(pair_set)).first;
+        }
+        account_(pid);
+        evict_(pid);
+        return iter->second;
+    }
+
+    /* make the stored pairs of @pid resident before it is changed, false if they cannot be read */
+    bool load_for_write_(const uint32_t &pid) {
+        if (!lazy_) {
+            return load_stored_(pid);
+        }
+        page_in_(pid);
+        if (pid <= predicate_size_ && !predicate_indexed_storage_.count(pid)) {
+            return false;
+        }
+        preserve_(pid);
+        return true;
+    }
+
+    /* move @pid to the front of the LRU list and refresh its memory usage */
+    void account_(const uint32_t &pid) {
+        auto iter = lru_index_.find(pid);
+        if (iter != lru_index_.end()) {
+            cache_size_ -= iter->second->second;
+            lru_.erase(iter->second);
+        }
+        const auto &pair_set = predicate_indexed_storage_.at(pid);
+        size_t bytes = pair_set.s2o.memoryUsage() + pair_set.o2s.memoryUsage();
+        lru_.emplace_front(pid, bytes);
+        lru_index_[pid] = lru_.begin();
+        cache_size_ += bytes;
+    }
+
+    /* evict the least recently used predicates except @keep and the unsaved ones until the budget is met */
+    void evict_(const uint32_t &keep) {
+        for (auto iter = lru_.end(); cache_size_ > cache_limit_ && iter != lru_.begin(); ) {
+            --iter;
+            if (iter->first == keep || dirty_.count(iter->first)) {
+                continue;
+            }
+            cache_size_ -= iter->second;
+            predicate_indexed_storage_.erase(iter->first);
+            lru_index_.erase(iter->first);
+            iter = lru_.erase(iter);
+        }
+    }
+
+    /* merge the pending pairs of @pid with its current index and its delta overlay,
+     * the pending pairs are consumed */
+    entity_pair_set merge_pending_(const uint32_t pid) {
+        entity_pair_list pairs;
+        auto pending = pending_storage_.find(pid);
+        if (pending != pending_storage_.end()) {
+            pairs = std::move(pending->second);
+        }
+
+        auto iter = predicate_indexed_storage_.find(pid);
+        if (iter != predicate_indexed_storage_.end()) {
+            pairs.reserve(pairs.size() + iter->second.s2o.size());
+            pairs.insert(pairs.end(), iter->second.s2o.begin(), iter->second.s2o.end());
+        }
+        entity_pair_set pair_set;
+        pair_set.s2o = CsrIndex::Build(pairs);
+        pair_set.o2s = reverse_(pair_set.s2o);
+        return pair_set;
+    }
+
+    /* build the object -> subjects index from the subject -> objects one */
+    static CsrIndex reverse_(const CsrIndex &index) {
+        entity_pair_list pairs;
+        pairs.reserve(index.size());
+        for (const auto &so : index) {
+            pairs.emplace_back(so.second, so.first);
+        }
+        return CsrIndex::Build(pairs);
+    }
+
+    /* publish the current state as the version of new snapshots, `write_mutex_` is held.
+     * The parts unchanged since the previous version are shared with it, @reset copies everything */
+    void publish_(const bool &reset = false) {
+        if (reset) {
+            ++ generation_;
+        }
+        auto version = std::make_shared<Version>();
+        {
+            std::unique_lock<std::mutex> lock(cache_mutex_, std::defer_lock);
+            if (lazy_) {
+                lock.lock();
+            }
+            overlay_pending_();
+            version->storage = predicate_indexed_storage_;
+        }
+        std::shared_ptr<const Version> previous = std::atomic_load(&version_);
+        bool copy_all = reset || !previous;
+
+        version->predicate_size = predicate_size_;
+        version->entity_size = entity_size_;
+        version->triplet_size = triplet_size_;
+        version->id2p_count = id2p_count_;
+        if (copy_all || previous->id2p->size() != id2p_.size()) {
+            version->p2id = std::make_shared<const std::unordered_map<std::string, uint32_t>>(p2id_);
+            version->id2p = std::make_shared<const std::vector<std::string>>(id2p_);
+        } else {
+            version->p2id = previous->p2id;
+            version->id2p = previous->id2p;
+        }
+
+        using count_chunks = std::vector<std::shared_ptr<const std::vector<uint32_t>>>;
+        auto publish_counts = [&](const std::vector<uint32_t> &counts, const count_chunks *published,
+                                  count_chunks &chunks) {
+            size_t chunk_count = (counts.size() + COUNT_CHUNK_SIZE - 1) / COUNT_CHUNK_SIZE;
+            chunks.reserve(chunk_count);
+            for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+                auto first = counts.begin() + chunk * COUNT_CHUNK_SIZE;
+                auto last = counts.begin() + std::min(counts.size(), (chunk + 1) * COUNT_CHUNK_SIZE);
+                if (!copy_all && chunk < published->size() && !changed_count_chunks_.count(chunk) &&
+                    (*published)[chunk]->size() == static_cast<size_t>(last - first)) {
+                    chunks.emplace_back((*published)[chunk]);
+                } else {
+                    chunks.emplace_back(std::make_shared<const std::vector<uint32_t>>(first, last));
+                }
+            }
+        };
+        publish_counts(id2so_count_, copy_all ? nullptr : &previous->id2so_count, version->id2so_count);
+        publish_counts(id2s_count_, copy_all ? nullptr : &previous->id2s_count, version->id2s_count);
+        changed_count_chunks_.clear();
+
+        if (copy_all || statistics_changed_) {
+            version->predicate_statistics =
+                    std::make_shared<const std::vector<PredicateStatistics>>(predicate_statistics_);
+        } else {
+            version->predicate_statistics = previous->predicate_statistics;
+        }
+        statistics_changed_ = false;
+        version->characteristic_sets = characteristic_sets_;
+
+        if (copy_all || !previous->entities->sharesBlocks(entities_) || previous->entity_size > entities_.size()) {
+            version->entities = std::make_shared<const Dictionary>(entities_.compacted());
+        } else {
+            version->entities = previous->entities;
+            version->segments = previous->segments;
+        }
+        uint32_t published = version->segments.empty()
+                             ? version->entities->size()
+                             : version->segments.back()->first +
+                               static_cast<uint32_t>(version->segments.back()->terms.size()) - 1;
+        if (entities_.size() > published) {
+            auto segment = std::make_shared<TermSegment>();
+            segment->first = published + 1;
+            for (uint32_t id = segment->first; id <= entities_.size(); ++id) {
+                segment->terms.emplace_back(&segment->ids.emplace(entities_.getTerm(id), id).first->first);
+            }
+            // merge the segments like a binary counter: a term is copied O(log n) times, O(log n) segments are left
+            while (!version->segments.empty() && version->segments.back()->terms.size() <= segment->terms.size()) {
+                auto merged = std::make_shared<TermSegment>();
+                merged->first = version->segments.back()->first;
+                for (const auto &part : {version->segments.back(), std::shared_ptr<const TermSegment>(segment)}) {
+                    for (const auto &term : part->terms) {
+                        uint32_t id = merged->first + static_cast<uint32_t>(merged->terms.size());
+                        merged->terms.emplace_back(&merged->ids.emplace(*term, id).first->first);
+                    }
+                }
+                version->segments.pop_back();
+                segment = std::move(merged);
+            }
+            version->segments.emplace_back(std::move(segment));
+        }
+
+        std::atomic_store(&version_, std::shared_ptr<const Version>(std::move(version)));
+        stale_ = false;
+    }
+
+    /* keep the current index of @pid in the snapshots which don't have it before it is changed,
+     * the snapshots of a lazily loaded database would page the changed one in otherwise */
+    void preserve_(const uint32_t &pid);
+
+    /* the index of @pid for a snapshot of a lazily loaded database, the predicate is paged in */
+    entity_pair_set page_in_shared_(const uint32_t &pid) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        return page_in_(pid);
+    }
+
+    /* checkpoint in the background once the log is over `checkpoint_size_`, `write_mutex_` is held */
+    void schedule_checkpoint_() {
+        bool checkpointing = checkpoint_task_.valid() &&
+                checkpoint_task_.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+        if (wal_.size() >= checkpoint_size_ && !checkpointing) {
+            checkpoint_task_ = background_->submit([this]() { return save(); });
+        }
+    }
+
+    /* tombstone every copy of @triplets, update the statistics from the removed pairs only (the degrees of the
+     * keys are summarized again by the checkpoint) and return the number of deleted triplets,
+     * a predicate is compacted in the background if @compact and its tombstones are over `COMPACTION_RATIO` */
+    size_t remove_(const std::vector<std::tuple<std::string, std::string, std::string>> &triplets,
+                   const bool &compact) {
+        ++ generation_;
+        std::unordered_map<uint32_t, entity_pair_list> pairs_by_pid;
+        for (const auto &triplet : triplets) {
+            auto pid = p2id_.find(std::get<1>(triplet));
+            uint32_t sid = entities_.find(std::get<0>(triplet));
+            uint32_t oid = entities_.find(std::get<2>(triplet));
+            if (pid != p2id_.end() && sid != 0 && oid != 0) {
+                pairs_by_pid[pid->second].emplace_back(sid, oid);
+            }
+        }
+
+        size_t affect = 0;
+        for (auto &item : pairs_by_pid) {
+            const uint32_t &pid = item.first;
+            entity_pair_list &pairs = item.second;
+            std::sort(pairs.begin(), pairs.end());
+            pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+            std::unique_lock<std::mutex> lock(cache_mutex_, std::defer_lock);
+            if (lazy_) {
+                lock.lock();
+            }
+            if (!load_for_write_(pid)) {
+                continue;
+            }
+            overlay_pending_(pid);
+            auto iter = predicate_indexed_storage_.find(pid);
+            if (iter == predicate_indexed_storage_.end()) {
+                continue;
+            }
+            // the tombstones are only in memory, like the delta overlays of `overlay_pending_`
+            dirty_.insert(pid);
+
+            entity_pair_set &pair_set = iter->second;
+            entity_pair_list reversed;
+            std::unordered_map<uint32_t, uint32_t> removed_subjects, removed_objects;
+            for (const auto &so : pairs) {
+                auto count = static_cast<uint32_t>(pair_set.s2o.get(so.first).count(so.second));
+                if (count == 0) {
+                    continue;
+                }
+                triplet_size_ -= count;
+                characteristic_changes_ += count;
+                id2p_count_[pid] -= count;
+                id2so_count_[so.first] -= count;
+                id2so_count_[so.second] -= count;
+                id2s_count_[so.first] -= count;
+                changed_count_chunks_.insert(so.first / COUNT_CHUNK_SIZE);
+                changed_count_chunks_.insert(so.second / COUNT_CHUNK_SIZE);
+                unsaved_count_chunks_.insert(so.first / COUNT_CHUNK_SIZE);
+                unsaved_count_chunks_.insert(so.second / COUNT_CHUNK_SIZE);
+                affect += count;
+                removed_subjects[so.first] += count;
+                removed_objects[so.second] += count;
+                reversed.emplace_back(so.second, so.first);
+            }
+            pair_set.s2o.remove(std::move(pairs));
+            pair_set.o2s.remove(std::move(reversed));
+
+            if (predicate_statistics_.size() <= predicate_size_) {
+                predicate_statistics_.resize(predicate_size_ + 1);
+            }
+            PredicateStatistics &statistics = predicate_statistics_[pid];
+            statistics.size = pair_set.s2o.size();
+            for (const auto &item : removed_subjects) {
+                statistics.subjects.remove(item.first, item.second, pair_set.s2o.get(item.first).empty());
+            }
+            for (const auto &item : removed_objects) {
+                statistics.objects.remove(item.first, item.second, pair_set.o2s.get(item.first).empty());
+            }
+            statistics_changed_ = true;
+
+            if (compact && pair_set.s2o.tombstoneSize() * COMPACTION_RATIO >=
+                           pair_set.s2o.size() + pair_set.s2o.tombstoneSize()) {
+                schedule_compaction_(pid);
+            }
+        }
+        return affect;
+    }
+
+    void schedule_compaction_(const uint32_t &pid) {
+        auto task = compaction_tasks_.find(pid);
+        if (task != compaction_tasks_.end()) {
+            if (task->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return;
+            }
+            compaction_tasks_.erase(task);
+        }
+        compaction_tasks_.emplace(pid, background_->submit(&DatabaseBuilder::Impl::compact_, this,
+                                                           pid, predicate_indexed_storage_.at(pid)));
+    }
+
+    /* rebuild @snapshot of @pid without its tombstones, the rebuilt index replaces the current one
+     * unless the predicate has been changed meanwhile */
+    bool compact_(const uint32_t pid, const entity_pair_set snapshot) {
+        entity_pair_list pairs = snapshot.s2o.pairs();
+        entity_pair_set compacted;
+        compacted.s2o = CsrIndex::Build(pairs);
+        compacted.o2s = reverse_(compacted.s2o);
+
+        std::unique_lock<std::mutex> write_lock(write_mutex_);
+        {
+            std::unique_lock<std::mutex> lock(cache_mutex_, std::defer_lock);
+            if (lazy_) {
+                lock.lock();
+            }
+            auto iter = predicate_indexed_storage_.find(pid);
+            if (iter == predicate_indexed_storage_.end() || !iter->second.s2o.sharesState(snapshot.s2o)) {
+                return false;
+            }
+            iter->second = std::move(compacted);
+            if (lazy_) {
+                account_(pid);
+            }
+        }
+        // let the tombstoned arrays go once the snapshots reading them are gone
+        publish_();
+        return true;
+    }
+
+    /* open the write-ahead log of database @db_path and replay the batches which are newer than `info` */
+    bool open_wal_(const fs::path &db_path) {
+        size_t replayed = 0;
+        bool opened = wal_.open((db_path / wal_path_).string(), checkpoint_sequence_,
+                                [this, &replayed](const WriteAheadLog::Operation &operation,
+                                                  const std::vector<WriteAheadLog::Triplet> &triplets) {
+            if (operation == WriteAheadLog::REMOVE) {
+                remove_(triplets, false);
+            } else {
+                for (const auto &triplet : triplets) {
+                    insert(std::get<0>(triplet), std::get<1>(triplet), std::get<2>(triplet));
+                }
+            }
+            replayed += triplets.size();
+        });
+        if (replayed > 0) {
+            spdlog::info("{} triplet(s) have been replayed from the write-ahead log.", replayed);
+        }
+        return opened;
+    }
 
-private:
     void initialize_() {
+        saved_ = false;
+        checkpoint_aborted_ = false;
+        checkpoint_sequence_ = 0;
         predicate_size_ = 0;
         entity_size_ = 0;
         triplet_size_ = 0;
-        id2so_.emplace_back("");
         id2p_.emplace_back("");
         id2so_count_.emplace_back(0);
+        id2s_count_.emplace_back(0);
         id2p_count_.emplace_back(0);
+        predicate_statistics_.emplace_back();
+        characteristic_sets_ = std::make_shared<const CharacteristicSets>();
+        characteristic_changes_ = 0;
     }
 
-    /* store database basic information */
-    bool store_basic_info(const fs::path &path) const {
+    /* store database basic information, @sequence is the last logged batch which the database files contain */
+    bool store_basic_info(const fs::path &path, const uint64_t &sequence) const {
         fs::ofstream out(path, fs::ofstream::out | fs::ofstream::binary);
         if (out.is_open()) {
             std::string content = std::to_string(triplet_size_) + "\n" +
                                   std::to_string(predicate_size_) + "\n" +
-                                  std::to_string(entity_size_) + "\n";
+                                  std::to_string(entity_size_) + "\n" +
+                                  std::to_string(sequence) + "\n";
 //            for (const uint32_t &item : id2p_count_) {
 //                content += std::to_string(item) + " ";
 //            }
@@ -401,6 +1703,128 @@ private:
         return true;
     }
 
+    /* flush file or directory @path to disk, so that it survives a power loss */
+    static bool sync_(const fs::path &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        bool synced = fd >= 0 && ::fsync(fd) == 0;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        if (!synced) {
+            spdlog::error("`{}` cannot be flushed to disk.", path.string());
+        }
+        return synced;
+    }
+
+    /* flush the files stored in database @db_path except the log, and the renames of the triplet files,
+     * which are flushed by `store_triplet_with_pid_` themselves */
+    bool sync_stored_(const fs::path &db_path) const {
+        bool synced = true;
+        for (fs::directory_iterator iter(db_path), end; iter != end; ++iter) {
+            const fs::path &path = iter->path();
+            if (fs::is_regular_file(path) && path.filename() != wal_path_) {
+                synced = sync_(path) && synced;
+            }
+        }
+        return sync_(db_path / triplet_path_) && sync_(db_path / reverse_triplet_path_) && sync_(db_path) && synced;
+    }
+
+    /* the file which a checkpoint stages in place of @path */
+    static fs::path staged_(const fs::path &path) {
+        return path.string() + ".ckpt";
+    }
+
+    /* the staged files of database @db_path, the patches of the entity counters are listed in @patches */
+    std::vector<fs::path> staged_files_(const fs::path &db_path, std::vector<fs::path> &patches) const {
+        std::vector<fs::path> staged;
+        for (const auto &dir : {db_path, db_path / triplet_path_, db_path / reverse_triplet_path_}) {
+            if (!fs::exists(dir)) {
+                continue;
+            }
+            for (fs::directory_iterator iter(dir), end; iter != end; ++iter) {
+                const fs::path &path = iter->path();
+                if (path.extension() == ".ckpt") {
+                    (path.stem().extension() == ".patch" ? patches : staged).emplace_back(path);
+                }
+            }
+        }
+        return staged;
+    }
+
+    /* commit the staged files of database @db_path, whose `info` covers the logged batches up to @sequence,
+     * by creating file `checkpoint` atomically */
+    bool commit_checkpoint_(const fs::path &db_path, const uint64_t &sequence) const {
+        fs::path tmp_path = db_path / fs::path(checkpoint_path_.string() + ".tmp");
+        fs::ofstream out(tmp_path, fs::ofstream::out | fs::ofstream::binary | fs::ofstream::trunc);
+        out << sequence << "\n";
+        out.close();
+        if (!out || !sync_(tmp_path)) {
+            spdlog::error("`{}` cannot be written.", tmp_path.string());
+            return false;
+        }
+        boost::system::error_code ec;
+        fs::rename(tmp_path, db_path / checkpoint_path_, ec);
+        if (ec) {
+            spdlog::error("`{}` cannot be renamed: {}.", tmp_path.string(), ec.message());
+            return false;
+        }
+        return sync_(db_path);
+    }
+
+    /* replace the stored files of database @db_path with the staged ones of the committed checkpoint and apply
+     * the patches, then remove `checkpoint`. Every step can be repeated, so an interrupted install is resumed */
+    bool install_checkpoint_(const fs::path &db_path) const {
+        std::vector<fs::path> patches;
+        std::vector<fs::path> staged = staged_files_(db_path, patches);
+        boost::system::error_code ec;
+        for (const auto &path : staged) {
+            fs::path stored = path.parent_path() / path.stem();
+            fs::rename(path, stored, ec);
+            if (ec) {
+                spdlog::error("`{}` cannot be installed: {}.", path.string(), ec.message());
+                return false;
+            }
+            // a dictionary stored as a whole leaves the tail of the replaced one behind
+            if (stored.filename() == id_entities_path_) {
+                fs::remove(Dictionary::TailPath(stored.string()), ec);
+            }
+        }
+        for (const auto &path : patches) {
+            fs::path stored = path.parent_path() / path.stem().stem();
+            if (!apply_patch_(path, stored) || !sync_(stored)) {
+                return false;
+            }
+            fs::remove(path, ec);
+        }
+        if (!sync_(db_path / triplet_path_) || !sync_(db_path / reverse_triplet_path_) || !sync_(db_path)) {
+            return false;
+        }
+        fs::remove(db_path / checkpoint_path_, ec);
+        return sync_(db_path);
+    }
+
+    /* remove the staged files of a checkpoint which wasn't committed */
+    void discard_checkpoint_(const fs::path &db_path) const {
+        std::vector<fs::path> patches;
+        std::vector<fs::path> staged = staged_files_(db_path, patches);
+        boost::system::error_code ec;
+        for (const auto &list : {staged, patches}) {
+            for (const auto &path : list) {
+                fs::remove(path, ec);
+            }
+        }
+    }
+
+    /* before database @db_path is loaded, finish the checkpoint which was committed but not installed,
+     * or drop the staged files of the one which a crash interrupted before it was committed */
+    void recover_checkpoint_(const fs::path &db_path) const {
+        if (!fs::exists(db_path / checkpoint_path_)) {
+            discard_checkpoint_(db_path);
+        } else if (install_checkpoint_(db_path)) {
+            spdlog::info("the interrupted checkpoint of <{}> has been finished.", db_path.string());
+        }
+    }
+
     /* load database basic information */
     bool load_basic_info(const fs::path &path) {
         fs::ifstream in(path, fs::ifstream::in | fs::ifstream::binary);
@@ -410,6 +1834,10 @@ private:
             in >> triplet_size_
                >> predicate_size_
                >> entity_size_;
+            // databases stored before the write-ahead log existed have no sequence number
+            if (!(in >> checkpoint_sequence_)) {
+                checkpoint_sequence_ = 0;
+            }
 //            id2p_count_.assign(predicate_size_ + 1, 0);
 //            for (uint32_t  &item : id2p_count_) {
 //                in >> item;
@@ -475,49 +1903,126 @@ private:
     }
 
 
-    /* store the mapping between soid and entities */
-    bool store_entity_ids_(const fs::path &path) const {
-        fs::ofstream out(path, fs::ofstream::out | fs::ofstream::binary);
-        if (out.is_open()) {
-            for (size_t i = 1; i <= entity_size_; ++ i) {
-                std::string item = std::to_string(i) + "\t" +
-                                   std::to_string(id2so_count_[i]) + "\t" +
-                                   id2so_[i] + "\n";
-                out.write(item.c_str(), item.size());
-            }
-            out.close();
-        } else {
+    /* store the mapping between soid and entities as a compact dictionary, and the statistics of entities.
+     * If @incremental, the new entities are appended to the stored dictionary, and only the chunks of
+     * the statistics which are changed or hold new entities are written into the stored file */
+    bool store_entity_ids_(const fs::path &path, const bool &incremental) {
+        // the counters of the entities after the stored ones haven't been written
+        size_t first_chunk = (entities_.storedSize() + 1) / COUNT_CHUNK_SIZE;
+        // the appended terms over the entity size of `info` are ignored by `Dictionary::Load`,
+        // so only a dictionary stored as a whole is staged
+        if (!(incremental && entities_.appendable() ? entities_.append(path.string())
+                                                    : entities_.save(staged_(path).string()))) {
             spdlog::error("store_entity_ids_ function occurs problem, "
                           "`id_entities` file cannot be written.");
             return false;
         }
+
+        if (!store_entity_counts_(path.parent_path() / entity_count_path_, id2so_count_, incremental, first_chunk) ||
+            !store_entity_counts_(path.parent_path() / entity_subject_count_path_, id2s_count_,
+                                  incremental, first_chunk)) {
+            spdlog::error("store_entity_ids_ function occurs problem, "
+                          "`id_entities_count` file cannot be written.");
+            return false;
+        }
+        return true;
+    }
+
+    /* stage the counters @counts of the entities for file @path. If @incremental and the file exists,
+     * only the chunks of `unsaved_count_chunks_` and the ones from @first_chunk are staged as a patch of it */
+    bool store_entity_counts_(const fs::path &path, const std::vector<uint32_t> &counts,
+                              const bool &incremental, const size_t &first_chunk) const {
+        if (!incremental || !fs::exists(path)) {
+            fs::ofstream out(staged_(path), fs::ofstream::out | fs::ofstream::binary);
+            out.write(reinterpret_cast<const char *>(counts.data()), (entity_size_ + 1) * sizeof(uint32_t));
+            out.close();
+            return static_cast<bool>(out);
+        }
+
+        std::vector<size_t> chunks(unsaved_count_chunks_.begin(), unsaved_count_chunks_.end());
+        for (size_t chunk = first_chunk; chunk * COUNT_CHUNK_SIZE <= entity_size_; ++chunk) {
+            chunks.emplace_back(chunk);
+        }
+        std::sort(chunks.begin(), chunks.end());
+        chunks.erase(std::unique(chunks.begin(), chunks.end()), chunks.end());
+
+        // a patch is a list of <first (uint64_t), size (uint64_t), counters[size]>
+        fs::ofstream out(staged_(path.string() + ".patch"), fs::ofstream::out | fs::ofstream::binary);
+        for (const auto &chunk : chunks) {
+            uint64_t range[2] = {chunk * COUNT_CHUNK_SIZE, 0};
+            range[1] = std::min<size_t>(entity_size_ + 1, range[0] + COUNT_CHUNK_SIZE) - range[0];
+            out.write(reinterpret_cast<const char *>(range), sizeof(range));
+            out.write(reinterpret_cast<const char *>(counts.data() + range[0]), range[1] * sizeof(uint32_t));
+        }
+        out.close();
+        return static_cast<bool>(out);
+    }
+
+    /* write the counters of patch @patch_path into their positions of file @path */
+    static bool apply_patch_(const fs::path &patch_path, const fs::path &path) {
+        fs::ifstream in(patch_path, fs::ifstream::in | fs::ifstream::binary);
+        fs::fstream out(path, fs::fstream::in | fs::fstream::out | fs::fstream::binary);
+        std::vector<uint32_t> counts;
+        uint64_t range[2];
+        while (in.is_open() && in.read(reinterpret_cast<char *>(range), sizeof(range))) {
+            counts.resize(range[1]);
+            in.read(reinterpret_cast<char *>(counts.data()), range[1] * sizeof(uint32_t));
+            out.seekp(static_cast<std::streamoff>(range[0] * sizeof(uint32_t)));
+            out.write(reinterpret_cast<const char *>(counts.data()), range[1] * sizeof(uint32_t));
+        }
+        out.close();
+        if (!in.is_open() || in.bad() || !out) {
+            spdlog::error("`{}` cannot be applied to `{}`.", patch_path.string(), path.string());
+            return false;
+        }
         return true;
     }
 
     /* load the mapping between soid and entities */
     bool load_entity_ids_(const fs::path &path, const uint32_t &entity_size) {
-        so2id_.clear();
-        so2id_.reserve(static_cast<size_t>(entity_size * 0.75));
-        id2so_.clear();
-        id2so_.resize(entity_size + 1);
         id2so_count_.clear();
         id2so_count_.resize(entity_size + 1);
+        id2s_count_.assign(entity_size + 1, 0);
+
+        if (Dictionary::FileVersion(path.string()) == 0) {
+            return load_legacy_entity_ids_(path, entity_size);
+        }
+
+        fs::ifstream in(path.parent_path() / entity_count_path_, fs::ifstream::in | fs::ifstream::binary);
+        if (!Dictionary::Load(path.string(), entities_, entity_size) || !in.is_open()) {
+            spdlog::error("load_entity_ids_ function occurs problem, "
+                          "`id_entities` file cannot be read.");
+            return false;
+        }
+        in.read(reinterpret_cast<char *>(id2so_count_.data()), (entity_size + 1) * sizeof(uint32_t));
+        in.close();
+        return true;
+    }
+
+    /* load the mapping between soid and entities from the text file written by older versions,
+     * each line is `soid\tcount\tentity` in the order of soid */
+    bool load_legacy_entity_ids_(const fs::path &path, const uint32_t &entity_size) {
+        entities_.clear();
 
         fs::ifstream in(path, fs::ifstream::in | fs::ifstream::binary);
         fs::ifstream::sync_with_stdio(false);
         in.tie(nullptr);
         if (in.is_open()) {
-            for (size_t i = 1; i <= entity_size_; ++ i) {
+            for (size_t i = 1; i <= entity_size; ++ i) {
                 uint32_t soid, soid_count;
                 std::string entity;
                 in >> soid >> soid_count;
                 in.ignore();
                 std::getline(in, entity);
-                id2so_[soid] = entity;
+                if (entities_.insert(entity).first != soid) {
+                    spdlog::error("load_entity_ids_ function occurs problem, "
+                                  "`id_entities` file is not in the order of soid.");
+                    return false;
+                }
                 id2so_count_[soid] = soid_count;
-                so2id_[entity] = soid;
             }
             in.close();
+            entities_.compact();
         } else {
             spdlog::error("load_entity_ids_ function occurs problem, "
                           "`id_entities` file cannot be read.");
@@ -526,50 +2031,56 @@ private:
         return true;
     }
 
-    /* store the predicate -> <subject, object> */
-    bool store_triplet_(const fs::path &path) {
+    /* store the predicate -> <subject, object>, only the changed predicates if @incremental */
+    bool store_triplet_(const fs::path &path, const bool &incremental) {
         if (!fs::exists(path)) {
             spdlog::error("store_triplet_ function occurs problem, "
                           "`triplet` directory cannot be created");
             return false;
         }
 
+        std::vector<uint32_t> pid_list;
+        if (incremental) {
+            pid_list.assign(dirty_.begin(), dirty_.end());
+        } else {
+            for (uint32_t pid = 1; pid <= predicate_size_; ++pid) {
+                pid_list.emplace_back(pid);
+            }
+        }
+
         std::vector<std::future<bool>> task_list;
-        task_list.reserve(predicate_indexed_storage_.size());
+        task_list.reserve(pid_list.size());
 
-        for (uint32_t pid = 1; pid <= predicate_size_; ++pid) {
-            task_list.push_back(std::move(std::async(std::launch::async,
-                                              &DatabaseBuilder::Impl::store_triplet_with_pid_,
+        for (const uint32_t &pid : pid_list) {
+            task_list.push_back(pool_->submit(&DatabaseBuilder::Impl::store_triplet_with_pid_,
                                               this,
-                                              path, pid)));
+                                              path, pid));
         }
 
+        bool stored = true;
         for (std::future<bool> &task : task_list) {
-            task.get();
+            stored = pool_->wait(task) && stored;
         }
 
-        return true;
+        return stored;
     }
 
     bool store_triplet_with_pid_(const fs::path &path, const uint32_t &pid) {
-        fs::path child_path = path/fs::path(std::to_string(pid));
-        fs::ofstream out(child_path, fs::ofstream::out | fs::ofstream::binary);
-        fs::ofstream::sync_with_stdio(false);
-        out.tie(nullptr);
-
-        if (out.is_open()) {
-            for (const auto &so : predicate_indexed_storage_[pid]) {
-                std::string item = std::to_string(so.first) + " " +
-                                   std::to_string(so.second) + "\n";
-                out.write(item.c_str(), item.size());
-            }
-            out.close();
+        auto iter = predicate_indexed_storage_.find(pid);
+        if (iter == predicate_indexed_storage_.end()) {
+            // predicate hasn't been loaded (e.g. LoadPartial), keep the file on disk untouched
             return true;
-        } else {
+        }
+
+        fs::path child_path = staged_(path/fs::path(std::to_string(pid)));
+        fs::path reverse_path = staged_(path.parent_path()/reverse_triplet_path_/fs::path(std::to_string(pid)));
+        if (!iter->second.s2o.save(child_path.string()) || !sync_(child_path) ||
+            !iter->second.o2s.save(reverse_path.string()) || !sync_(reverse_path)) {
             spdlog::error("store_triplet_ function occurs problem, "
-                          "`{}` cannot be written.", path.string());
+                          "`{}` cannot be written.", child_path.string());
             return false;
         }
+        return true;
     }
 
     /* store the predicate -> <subject, object> */
@@ -580,41 +2091,12 @@ private:
             return false;
         }
 
-        std::vector<std::future<bool>> task_list;
-        task_list.reserve(predicate_size);
-
+        std::vector<uint32_t> pid_list;
+        pid_list.reserve(predicate_size);
         for (uint32_t pid = 1; pid <= predicate_size; ++pid) {
-            fs::path child_path = path/fs::path(std::to_string(pid));
-            fs::ifstream in(child_path, fs::ifstream::in | fs::ifstream::binary);
-            fs::ifstream::sync_with_stdio(false);
-            in.tie(nullptr);
-
-            if (in.is_open()) {
-                predicate_indexed_storage_[pid].reserve(id2p_count_[pid]);
-                while (!in.eof()) {
-                    uint32_t sid, oid;
-                    in >> sid >> oid;
-                    predicate_indexed_storage_[pid].insert({sid, oid});
-                }
-                in.close();
-            } else {
-                spdlog::error("load_all_triplet_ function occurs problem, "
-                              "`{}` cannot be read.", child_path.string());
-                return false;
-            }
-//            task_list.push_back(std::move(std::async(std::launch::async,
-//                                              &DatabaseBuilder::Impl::load_triplet_with_pid_,
-//                                              this,
-//                                              path, pid)));
+            pid_list.emplace_back(pid);
         }
-
-//        predicate_indexed_storage_.clear();
-//        predicate_indexed_storage_.reserve(static_cast<size_t>(predicate_size * 0.75));
-//        for (std::future<bool> &task : task_list) {
-//            task.get();
-//        }
-
-        return true;
+        return load_triplet_with_pids_(path, pid_list);
     }
 
     /* store the predicate -> <subject, object> */
@@ -625,52 +2107,124 @@ private:
             return false;
         }
 
+        return load_triplet_with_pids_(path, pid_list);
+    }
+
+    /* read the indexes of @pid_list in parallel, nothing is kept unless all of them are read */
+    bool load_triplet_with_pids_(const fs::path &path, const std::vector<uint32_t> &pid_list) {
+        std::vector<entity_pair_set> pair_sets(pid_list.size());
         std::vector<std::future<bool>> task_list;
         task_list.reserve(pid_list.size());
+        for (size_t i = 0; i < pid_list.size(); ++i) {
+            task_list.emplace_back(pool_->submit([this, &path, &pid_list, &pair_sets, i]() {
+                return load_triplet_with_pid_(path, pid_list[i], pair_sets[i]);
+            }));
+        }
+        bool loaded = true;
+        for (auto &task : task_list) {
+            loaded = pool_->wait(task) && loaded;
+        }
+        if (!loaded) {
+            return false;
+        }
+        for (size_t i = 0; i < pid_list.size(); ++i) {
+            predicate_indexed_storage_[pid_list[i]] = std::move(pair_sets[i]);
+        }
+        return true;
+    }
 
-        for (const uint32_t &pid: pid_list) {
-            fs::path child_path = path/fs::path(std::to_string(pid));
-            fs::ifstream in(child_path, fs::ifstream::in | fs::ifstream::binary);
-            fs::ifstream::sync_with_stdio(false);
-            in.tie(nullptr);
-
-            if (in.is_open()) {
-                predicate_indexed_storage_[pid].reserve(id2p_count_[pid]);
-                while (!in.eof()) {
-                    uint32_t sid, oid;
-                    in >> sid >> oid;
-                    predicate_indexed_storage_[pid].insert({sid, oid});
-                }
-                in.close();
-            } else {
-                spdlog::error("load_partial_triplet_ function occurs problem, "
-                              "`{}` cannot be read.", child_path.string());
-                return false;
+    /* read the indexes of @pid into @pair_set, false if its triplet file is missing or corrupt */
+    bool load_triplet_with_pid_(const fs::path &path, const uint32_t &pid, entity_pair_set &pair_set) {
+        fs::path child_path = path/fs::path(std::to_string(pid));
+        fs::path reverse_path = path.parent_path()/reverse_triplet_path_/fs::path(std::to_string(pid));
+        if (!CsrIndex::Load(child_path.string(), pair_set.s2o)) {
+            spdlog::error("load_triplet_with_pid_ function occurs problem, "
+                          "`{}` cannot be read.", child_path.string());
+            pair_set = entity_pair_set();
+            return false;
+        }
+        if (!fs::exists(reverse_path) || !CsrIndex::Load(reverse_path.string(), pair_set.o2s)) {
+            // database built before the reverse index existed, build it in memory
+            pair_set.o2s = reverse_(pair_set.s2o);
+        }
+        return true;
+    }
+
+    /* load the statistics of the predicates and the subject counters of the entities of database @db_path,
+     * the ones of a database built by older versions are computed from its triplet files */
+    bool load_statistics_(const fs::path &db_path) {
+        fs::path characteristic_sets_path = db_path / characteristic_sets_path_;
+        CharacteristicSets characteristic_sets;
+        if (fs::exists(characteristic_sets_path) &&
+            CharacteristicSets::Load(characteristic_sets_path.string(), characteristic_sets)) {
+            characteristic_sets_ = std::make_shared<const CharacteristicSets>(std::move(characteristic_sets));
+        } else {
+            compute_characteristic_sets_(db_path);
+        }
+
+        fs::path statistics_path = db_path / predicate_statistics_path_;
+        fs::ifstream in(db_path / entity_subject_count_path_, fs::ifstream::in | fs::ifstream::binary);
+        if (in.is_open() && fs::exists(statistics_path) &&
+            PredicateStatistics::Load(statistics_path.string(), predicate_statistics_)) {
+            predicate_statistics_.resize(predicate_size_ + 1);
+            id2s_count_.assign(entity_size_ + 1, 0);
+            if (in.read(reinterpret_cast<char *>(id2s_count_.data()), (entity_size_ + 1) * sizeof(uint32_t))) {
+                return true;
             }
         }
+        spdlog::info("the statistics of <{}> are computed from its triplet files.", db_path.string());
+        return compute_statistics_(db_path);
+    }
+
+    /* compute the statistics of all predicates and the subject counters of the entities,
+     * the predicates which aren't loaded are read from the triplet files of database @db_path */
+    bool compute_statistics_(const fs::path &db_path) {
+        std::vector<std::future<PredicateStatistics>> task_list;
+        task_list.reserve(predicate_size_);
+        for (uint32_t pid = 1; pid <= predicate_size_; ++pid) {
+            task_list.emplace_back(pool_->submit([this, &db_path, pid]() {
+                entity_pair_set pair_set = index_of_(db_path, pid);
+                return PredicateStatistics::Compute(pair_set.s2o, pair_set.o2s);
+            }));
+        }
+        predicate_statistics_.assign(predicate_size_ + 1, PredicateStatistics());
+        for (uint32_t pid = 1; pid <= predicate_size_; ++pid) {
+            predicate_statistics_[pid] = pool_->wait(task_list[pid - 1]);
+        }
 
+        id2s_count_.assign(entity_size_ + 1, 0);
+        for (uint32_t pid = 1; pid <= predicate_size_; ++pid) {
+            entity_pair_set pair_set = index_of_(db_path, pid);
+            for (const uint32_t sid : pair_set.s2o.keys()) {
+                if (sid < id2s_count_.size()) {
+                    id2s_count_[sid] += static_cast<uint32_t>(pair_set.s2o.get(sid).size());
+                }
+            }
+        }
+        statistics_changed_ = true;
         return true;
     }
 
-    entity_pair_set load_triplet_with_pid_(const fs::path &path, const uint32_t &pid) {
-        fs::path child_path = path/fs::path(std::to_string(pid));
-        fs::ifstream in(child_path, fs::ifstream::in | fs::ifstream::binary);
+    /* compute the characteristic sets of the subjects, see `compute_statistics_` for @db_path */
+    void compute_characteristic_sets_(const fs::path &db_path) {
+        characteristic_sets_ = std::make_shared<const CharacteristicSets>(
+                CharacteristicSets::Compute(predicate_size_, [this, &db_path](const uint32_t &pid) {
+                    return index_of_(db_path, pid).s2o;
+                }));
+        characteristic_changes_ = 0;
+    }
+
+    /* the index of @pid, which is read from the triplet files of database @db_path if it isn't loaded */
+    entity_pair_set index_of_(const fs::path &db_path, const uint32_t &pid) {
+        auto iter = predicate_indexed_storage_.find(pid);
+        if (iter != predicate_indexed_storage_.end()) {
+            return iter->second;
+        }
         entity_pair_set pair_set;
-        if (in.is_open()) {
-            while (!in.eof()) {
-                uint32_t sid, oid;
-                in >> sid >> oid;
-                pair_set.emplace(sid, oid);
-            }
-            in.close();
-//            predicate_indexed_storage_.emplace(pid, std::move(pair_set));
-            return pair_set;
-        } else {
-            spdlog::error("load_triplet_with_pid_ function occurs problem, "
-                          "`{}` cannot be read.", child_path.string());
-//            return false;
-            return {};
+        if (fs::exists(db_path / triplet_path_ / fs::path(std::to_string(pid)))) {
+            load_triplet_with_pid_(db_path / triplet_path_, pid, pair_set);
         }
+        return pair_set;
     }
 
 public:
@@ -681,20 +2235,183 @@ public:
     fs::path info_path_;
     fs::path id_predicates_path_;
     fs::path id_entities_path_;
+    fs::path entity_count_path_;
+    fs::path entity_subject_count_path_;
+    fs::path predicate_statistics_path_;
+    fs::path characteristic_sets_path_;
     fs::path triplet_path_;
-    std::unordered_map<std::string, uint32_t> so2id_;
+    fs::path reverse_triplet_path_;
+    fs::path run_path_;
+    fs::path wal_path_;
+    fs::path checkpoint_path_;
+    uint32_t thread_num_;
+    std::shared_ptr<ThreadPool> pool_;
+    size_t memory_limit_;
+    Dictionary entities_;
     std::unordered_map<std::string, uint32_t> p2id_;
 //    phmap::flat_hash_map<std::string, uint32_t> so2id_;
 //    phmap::flat_hash_map<std::string, uint32_t> p2id_;
-    std::vector<std::string> id2so_;
     std::vector<std::string> id2p_;
     std::vector<uint32_t> id2so_count_;
+    std::vector<uint32_t> id2s_count_;      // number of the triplets whose subject is the entity
     std::vector<uint32_t> id2p_count_;
+    std::vector<PredicateStatistics> predicate_statistics_;
+    std::shared_ptr<const CharacteristicSets> characteristic_sets_;
+    size_t characteristic_changes_;     // triplets inserted or deleted since the characteristic sets were computed
 
     std::unordered_map<uint32_t, entity_pair_set> predicate_indexed_storage_;
+    // pairs inserted since the CSR index of the predicate was built
+    std::unordered_map<uint32_t, entity_pair_list> pending_storage_;
+    // whether the files of `db_name_` hold the database except the predicates of `dirty_`, the entity counters
+    // of `unsaved_count_chunks_` and the entities after `entities_.storedSize()`, then `save` only writes them
+    bool saved_;
+    std::unordered_set<size_t> unsaved_count_chunks_;
+    // a checkpoint failed before it was committed, the stored states kept in memory (e.g. of the dictionary)
+    // may be ahead of the files then, so the next `save` stores everything
+    bool checkpoint_aborted_;
+
+    // paging state of a lazily loaded database, `lru_` holds <pid, bytes> with the most recently used first
+    bool lazy_;
+    size_t cache_limit_;
+    size_t cache_size_;
+    std::list<std::pair<uint32_t, size_t>> lru_;
+    std::unordered_map<uint32_t, std::list<std::pair<uint32_t, size_t>>::iterator> lru_index_;
+    std::unordered_set<uint32_t> dirty_;    // predicates changed since the last save
+    std::mutex cache_mutex_;
+
+    // logged batches since the last checkpoint, `write_mutex_` serializes logged writes, checkpoints and compactions
+    WriteAheadLog wal_;
+    uint64_t checkpoint_sequence_;
+    size_t checkpoint_size_;
+    std::mutex write_mutex_;
+    // runs the checkpoints and the compactions, they take `write_mutex_` so they mustn't be run
+    // by a thread of `pool_` which helps while it waits inside a locked section
+    std::shared_ptr<ThreadPool> background_;
+    std::future<bool> checkpoint_task_;
+    std::unordered_map<uint32_t, std::future<bool>> compaction_tasks_;
+
+    // a predicate is compacted once 1 / `COMPACTION_RATIO` of its stored pairs are tombstoned
+    static const size_t COMPACTION_RATIO = 8;
+    // the characteristic sets are rebuilt by `save` once 1 / `CHARACTERISTIC_SETS_RATIO` of the triplets changed
+    static const size_t CHARACTERISTIC_SETS_RATIO = 8;
+
+    // the latest published version, which is read and replaced atomically, `stale_` tells whether
+    // there are writes after it. The snapshots of a lazily loaded database are tracked for `preserve_`
+    std::shared_ptr<const Version> version_;
+    std::atomic<bool> stale_;
+    // number of the writes, a live `Option` reads the snapshot taken after the last one, see `Option::view_`
+    std::atomic<uint64_t> generation_;
+    std::unordered_set<size_t> changed_count_chunks_;
+    bool statistics_changed_;
+    std::vector<std::weak_ptr<const Snapshot>> snapshots_;
+    std::mutex snapshot_mutex_;
 //    phmap::flat_hash_map<uint32_t, entity_pair_set> predicate_indexed_storage_;
 };
 
+/* a snapshot pins one published version. The predicates of a lazily loaded database which aren't in
+ * the version are paged in on their first access and kept by the snapshot, and the writers preserve
+ * the index of a predicate in the snapshots before they change it, so a snapshot never sees a later write */
+class DatabaseBuilder::Snapshot {
+public:
+    using Version = DatabaseBuilder::Impl::Version;
+    using entity_pair_set = DatabaseBuilder::Impl::entity_pair_set;
+
+    Snapshot(Impl *impl, std::shared_ptr<const Version> version) : impl_(impl), version_(std::move(version)) {}
+
+    const Version &version() const { return *version_; }
+
+    uint32_t getPredicateId(const std::string &predicate) const {
+        return version_->p2id->at(predicate);
+    }
+
+    uint32_t getEntityId(const std::string &entity) const {
+        uint32_t id = version_->findEntity(entity);
+        if (id == 0) {
+            throw std::out_of_range("term `" + entity + "` doesn't exist in dictionary");
+        }
+        return id;
+    }
+
+    const entity_pair_set &getIndex(const uint32_t &pid) const {
+        static const entity_pair_set empty;
+        auto iter = version_->storage.find(pid);
+        if (iter != version_->storage.end()) {
+            return iter->second;
+        }
+        if (!impl_->lazy_ || pid == 0 || pid > version_->predicate_size) {
+            return empty;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto paged = paged_.find(pid);
+            if (paged != paged_.end()) {
+                return paged->second;
+            }
+        }
+        // a writer may preserve the predicate meanwhile, then the preserved one is kept
+        entity_pair_set pair_set = impl_->page_in_shared_(pid);
+        std::lock_guard<std::mutex> lock(mutex_);
+        return paged_.emplace(pid, std::move(pair_set)).first->second;
+    }
+
+    /* keep @pair_set as the index of @pid unless the snapshot has got one */
+    void preserve(const uint32_t &pid, const entity_pair_set &pair_set) const {
+        if (pid > version_->predicate_size || version_->storage.count(pid)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        paged_.emplace(pid, pair_set);
+    }
+
+private:
+    Impl *impl_;
+    std::shared_ptr<const Version> version_;
+    mutable std::mutex mutex_;
+    mutable std::unordered_map<uint32_t, entity_pair_set> paged_;
+};
+
+std::shared_ptr<const DatabaseBuilder::Snapshot> DatabaseBuilder::Impl::snapshot() {
+    if (stale_) {
+        // a running writer publishes its writes when it finishes, so don't wait for it
+        std::unique_lock<std::mutex> lock(write_mutex_, std::try_to_lock);
+        if (lock.owns_lock()) {
+            publish_();
+        }
+    }
+    auto snapshot = std::make_shared<const Snapshot>(this, std::atomic_load(&version_));
+    if (lazy_) {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        snapshots_.erase(std::remove_if(snapshots_.begin(), snapshots_.end(),
+                                        [](const std::weak_ptr<const Snapshot> &s) { return s.expired(); }),
+                         snapshots_.end());
+        snapshots_.emplace_back(snapshot);
+    }
+    return snapshot;
+}
+
+std::shared_ptr<const DatabaseBuilder::Snapshot> DatabaseBuilder::Impl::current() {
+    if (stale_) {
+        std::unique_lock<std::mutex> lock(write_mutex_);
+        if (stale_) {
+            publish_();
+        }
+    }
+    return std::make_shared<const Snapshot>(this, std::atomic_load(&version_));
+}
+
+void DatabaseBuilder::Impl::preserve_(const uint32_t &pid) {
+    auto iter = predicate_indexed_storage_.find(pid);
+    if (iter == predicate_indexed_storage_.end()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    for (const auto &snapshot : snapshots_) {
+        if (auto pinned = snapshot.lock()) {
+            pinned->preserve(pid, iter->second);
+        }
+    }
+}
+
 DatabaseBuilder::DatabaseBuilder() = default;
 
 DatabaseBuilder::~DatabaseBuilder() = default;
@@ -706,6 +2423,21 @@ DatabaseBuilder::Create(const std::string &db_name, const std::string &data_file
     return std::make_shared<DatabaseBuilder::Option>(impl);
 }
 
+std::shared_ptr<DatabaseBuilder::Option>
+DatabaseBuilder::Create(const std::string &db_name, const std::string &data_file,
+                        const uint32_t &thread_num, const size_t &memory_limit) {
+    std::shared_ptr<Impl> impl(new Impl());
+    impl->setThreadNum(thread_num);
+    impl->setMemoryLimit(memory_limit);
+    impl->create(db_name, data_file);
+    return std::make_shared<DatabaseBuilder::Option>(impl);
+}
+
+bool DatabaseBuilder::Convert(const std::string &db_name) {
+    std::shared_ptr<Impl> impl(new Impl());
+    return impl->convert(db_name);
+}
+
 std::shared_ptr<DatabaseBuilder::Option> DatabaseBuilder::LoadBasic(const std::string &db_name) {
     std::shared_ptr<Impl> impl(new Impl());
     impl->loadBasic(db_name);
@@ -719,6 +2451,13 @@ DatabaseBuilder::LoadAll(const std::string &db_name) {
     return std::make_shared<DatabaseBuilder::Option>(impl);
 }
 
+std::shared_ptr<DatabaseBuilder::Option>
+DatabaseBuilder::LoadLazy(const std::string &db_name, const size_t &memory_limit) {
+    std::shared_ptr<Impl> impl(new Impl());
+    impl->loadLazy(db_name, memory_limit);
+    return std::make_shared<DatabaseBuilder::Option>(impl);
+}
+
 std::shared_ptr<DatabaseBuilder::Option>
 DatabaseBuilder::LoadPartial(const std::string &db_name, const std::vector<std::string> &predicate_indexed_list) {
     std::shared_ptr<Impl> impl(new Impl());
@@ -728,8 +2467,38 @@ DatabaseBuilder::LoadPartial(const std::string &db_name, const std::vector<std::
 
 DatabaseBuilder::Option::Option(std::shared_ptr<Impl> impl) : impl_(std::move(impl)) {}
 
+DatabaseBuilder::Option::Option(std::shared_ptr<Impl> impl, std::shared_ptr<const Snapshot> snapshot)
+    : impl_(std::move(impl)), snapshot_(std::move(snapshot)) {}
+
 DatabaseBuilder::Option::~Option() = default;
 
+std::shared_ptr<DatabaseBuilder::Option> DatabaseBuilder::Option::snapshot() {
+    return std::make_shared<Option>(impl_, snapshot_ ? snapshot_ : impl_->snapshot());
+}
+
+/* the background checkpoints and compactions replace the indexes of a loaded database, so its getters read
+ * a snapshot which is kept until the next write. A lazily loaded database is read directly under its cache lock */
+std::shared_ptr<const DatabaseBuilder::Snapshot> DatabaseBuilder::Option::view_() const {
+    if (snapshot_) {
+        return snapshot_;
+    }
+    if (impl_->lazy_) {
+        return nullptr;
+    }
+    uint64_t generation = impl_->generation_;
+    std::shared_ptr<const View> current = std::atomic_load(&current_);
+    if (!current || current->generation != generation) {
+        // the snapshot is tagged with the generation read before it is taken, so it is refreshed again
+        // rather than kept too long if a write runs in between
+        auto view = std::make_shared<View>();
+        view->snapshot = impl_->current();
+        view->generation = generation;
+        current = view;
+        std::atomic_store(&current_, current);
+    }
+    return current->snapshot;
+}
+
 bool DatabaseBuilder::Option::save() {
     return impl_->save();
 }
@@ -743,132 +2512,181 @@ void DatabaseBuilder::Option::unload() {
 }
 
 bool DatabaseBuilder::Option::insert(const std::string &s, const std::string &p, const std::string &o) {
-    return impl_->insert(s, p, o);
+    return impl_->insertTriplet(s, p, o);
 }
 
 bool DatabaseBuilder::Option::insert(const std::vector<std::tuple<std::string, std::string, std::string>> &triplets) {
     return impl_->insertFromTriplets(triplets);
 }
 
+bool DatabaseBuilder::Option::remove(const std::vector<std::tuple<std::string, std::string, std::string>> &triplets) {
+    return impl_->removeFromTriplets(triplets);
+}
+
+void DatabaseBuilder::Option::setCheckpointSize(const size_t &checkpoint_size) {
+    impl_->setCheckpointSize(checkpoint_size);
+}
+
 uint32_t DatabaseBuilder::Option::getPredicateId(const std::string &predicate) const {
-    return impl_->p2id_.at(predicate);
+    auto view = view_();
+    return view ? view->getPredicateId(predicate) : impl_->p2id_.at(predicate);
 }
 
 uint32_t DatabaseBuilder::Option::getPredicateId(const std::string &predicate) {
-    return impl_->p2id_.at(predicate);
+    auto view = view_();
+    return view ? view->getPredicateId(predicate) : impl_->p2id_.at(predicate);
 //    return impl_->getPredicateId(predicate);
 }
 
 std::string DatabaseBuilder::Option::getPredicateById(const uint32_t &pid) {
-        return impl_->id2p_[pid];
+    auto view = view_();
+    return view ? view->version().id2p->at(pid) : impl_->id2p_[pid];
 }
 
 uint32_t DatabaseBuilder::Option::getPredicateCountBy(const std::string &predicate) const {
-    return impl_->id2p_count_[impl_->p2id_.at(predicate)];
+    auto view = view_();
+    return view ? view->version().id2p_count[view->getPredicateId(predicate)]
+                : impl_->id2p_count_[impl_->p2id_.at(predicate)];
 //    return impl_->getPredicateCount(predicate);
 }
 
 uint32_t DatabaseBuilder::Option::getPredicateCountBy(const std::string &predicate) {
-    return impl_->id2p_count_[impl_->p2id_.at(predicate)];
+    auto view = view_();
+    return view ? view->version().id2p_count[view->getPredicateId(predicate)]
+                : impl_->id2p_count_[impl_->p2id_.at(predicate)];
 }
 
 uint32_t DatabaseBuilder::Option::getEntityCountBy(const std::string &entity) const {
-    return impl_->id2so_count_[impl_->so2id_.at(entity)];
+    auto view = view_();
+    return view ? view->version().getEntityCount(view->getEntityId(entity))
+                : impl_->id2so_count_[impl_->entities_.getId(entity)];
 }
 
 uint32_t DatabaseBuilder::Option::getEntityCountBy(const std::string &entity) {
-    return impl_->id2so_count_[impl_->so2id_.at(entity)];
+    auto view = view_();
+    return view ? view->version().getEntityCount(view->getEntityId(entity))
+                : impl_->id2so_count_[impl_->entities_.getId(entity)];
+}
+
+uint32_t DatabaseBuilder::Option::getSubjectCountBy(const std::string &entity) const {
+    auto view = view_();
+    return view ? view->version().getSubjectCount(view->getEntityId(entity))
+                : impl_->id2s_count_[impl_->entities_.getId(entity)];
+}
+
+uint32_t DatabaseBuilder::Option::getObjectCountBy(const std::string &entity) const {
+    auto view = view_();
+    if (view) {
+        uint32_t id = view->getEntityId(entity);
+        return view->version().getEntityCount(id) - view->version().getSubjectCount(id);
+    }
+    uint32_t id = impl_->entities_.getId(entity);
+    return impl_->id2so_count_[id] - impl_->id2s_count_[id];
+}
+
+const CharacteristicSets &DatabaseBuilder::Option::getCharacteristicSets() const {
+    auto view = view_();
+    return view ? *view->version().characteristic_sets : *impl_->characteristic_sets_;
+}
+
+const PredicateStatistics &DatabaseBuilder::Option::getStatisticsByP(const uint32_t &pid) const {
+    static const PredicateStatistics empty;
+    auto view = view_();
+    const auto &statistics = view ? *view->version().predicate_statistics : impl_->predicate_statistics_;
+    return pid < statistics.size() ? statistics[pid] : empty;
 }
 
 std::vector<uint32_t> DatabaseBuilder::Option::getPredicateStatistics() {
-    return impl_->id2p_count_;
+    auto view = view_();
+    return view ? view->version().id2p_count : impl_->id2p_count_;
 }
 
 uint32_t DatabaseBuilder::Option::getEntityId(const std::string &entity) {
-    return impl_->so2id_.at(entity);
+    auto view = view_();
+    return view ? view->getEntityId(entity) : impl_->entities_.getId(entity);
 //    return impl_->getEntityId(entity);
 }
 
 uint32_t DatabaseBuilder::Option::getEntityId(const std::string &entity) const {
-    return impl_->so2id_.at(entity);
+    auto view = view_();
+    return view ? view->getEntityId(entity) : impl_->entities_.getId(entity);
 //    return impl_->getEntityId(entity);
 }
 
 std::string DatabaseBuilder::Option::getEntityById(const uint32_t entity_id) {
 //    return impl_->getEntityById(entity_id);
-        return impl_->id2so_.at(entity_id);
+    auto view = view_();
+    return view ? view->version().getEntity(entity_id) : impl_->entities_.getTerm(entity_id);
 }
 
 std::string DatabaseBuilder::Option::getEntityById(uint32_t entity_id) const {
 //    return impl_->getEntityById(entity_id);
-    return impl_->id2so_.at(entity_id);
+    auto view = view_();
+    return view ? view->version().getEntity(entity_id) : impl_->entities_.getTerm(entity_id);
 }
 
-std::unordered_set<uint32_t>
+IdSpan
 DatabaseBuilder::Option::getSByPO(const uint32_t &pid, const uint32_t &oid) {
 //    return impl_->getSByPO(pid, oid);
-    std::unordered_set<uint32_t> ret;
-    ret.reserve(static_cast<size_t>(impl_->id2p_count_[pid] * 0.75));
-    for (const auto &item : impl_->predicate_indexed_storage_[pid]) {
-        if (item.second == oid) {
-            ret.insert(item.first);
-        }
-    }
-    return ret;
+    auto view = view_();
+    return (view ? view->getIndex(pid) : impl_->getIndex(pid)).o2s.get(oid);
 }
 
-std::unordered_set<uint32_t>
+IdSpan
 DatabaseBuilder::Option::getOBySP(const uint32_t &sid, const uint32_t &pid) {
 //    return impl_->getOBySP(sid, pid);
-    std::unordered_set<uint32_t> ret;
-    ret.reserve(static_cast<size_t>(impl_->id2p_count_[pid] * 0.75));
-    for (const auto &item : impl_->predicate_indexed_storage_[pid]) {
-        if (item.first == sid) {
-            ret.insert(item.second);
-        }
-    }
-    return ret;
+    auto view = view_();
+    return (view ? view->getIndex(pid) : impl_->getIndex(pid)).s2o.get(sid);
+}
+
+const RoaringBitmap *
+DatabaseBuilder::Option::getSBitmapByPO(const uint32_t &pid, const uint32_t &oid) {
+    auto view = view_();
+    return (view ? view->getIndex(pid) : impl_->getIndex(pid)).o2s.bitmap(oid);
 }
 
-const std::unordered_multimap<uint32_t, uint32_t> &
+const CsrIndex &
 DatabaseBuilder::Option::getS2OByP(const uint32_t &pid) {
 //    return impl_->getS2OByP(pid);
-    return impl_->predicate_indexed_storage_[pid];
+    auto view = view_();
+    return (view ? view->getIndex(pid) : impl_->getIndex(pid)).s2o;
 }
 
-std::unordered_multimap<uint32_t, uint32_t>
+const CsrIndex &
 DatabaseBuilder::Option::getO2SByP(const uint32_t &pid) {
 //    return impl_->getO2SByP(pid);
-    std::unordered_multimap<uint32_t, uint32_t> ret;
-    ret.reserve(static_cast<size_t>(impl_->id2p_count_[pid] * 0.75));
-    for (const auto &item : impl_->predicate_indexed_storage_[pid]) {
-        ret.emplace(item.second, item.first);
-    }
-    return ret;
+    auto view = view_();
+    return (view ? view->getIndex(pid) : impl_->getIndex(pid)).o2s;
 }
 
 uint32_t DatabaseBuilder::Option::getPredicateSize() {
-    return impl_->predicate_size_;
+    auto view = view_();
+    return view ? view->version().predicate_size : impl_->predicate_size_;
 }
 
 uint32_t DatabaseBuilder::Option::getPredicateSize() const {
-    return impl_->predicate_size_;
+    auto view = view_();
+    return view ? view->version().predicate_size : impl_->predicate_size_;
 }
 
 uint32_t DatabaseBuilder::Option::getEntitySize() {
-    return impl_->entity_size_;
+    auto view = view_();
+    return view ? view->version().entity_size : impl_->entity_size_;
 }
 
 uint32_t DatabaseBuilder::Option::getEntitySize() const {
-    return impl_->entity_size_;
+    auto view = view_();
+    return view ? view->version().entity_size : impl_->entity_size_;
 }
 
 uint32_t DatabaseBuilder::Option::getTripletSize() {
-    return impl_->triplet_size_;
+    auto view = view_();
+    return view ? view->version().triplet_size : impl_->triplet_size_;
 }
 
 uint32_t DatabaseBuilder::Option::getTripletSize() const {
-    return impl_->triplet_size_;
+    auto view = view_();
+    return view ? view->version().triplet_size : impl_->triplet_size_;
 }
 
 //std::set<std::pair<uint32_t, uint32_t>> DatabaseBuilder::Option::getSOByP(const uint32_t &pid) {
@@ -0,0 +1,508 @@
+/*
+ * @FileName   : dictionary.cpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: implement `Dictionary` and the binary dictionary file layout
+ */
+
+#include "database/dictionary.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace inno {
+
+namespace fs = boost::filesystem;
+namespace io = boost::iostreams;
+
+/* on-disk layout of `id_entities`, all integers are written in native byte order:
+ *   version 1: header, block_offsets[block_count + 1] (uint64_t), rank2id[count], id2rank[count], heap[heap_size]
+ *   version 2: header, bucket_count (uint64_t), buckets[bucket_count] (uint64_t), then the same as version 1
+ * the tail file `id_entities.tail` is a tail header, then the terms of ids `base + 1, base + 2, ...` in order,
+ * each of them is <length (uint32_t), bytes>. It belongs to the dictionary file only if `base` is its `count` */
+const char DICTIONARY_FILE_MAGIC[4] = {'P', 'S', 'O', 'D'};
+const char DICTIONARY_TAIL_MAGIC[4] = {'P', 'S', 'O', 'T'};
+const char DICTIONARY_TAIL_SUFFIX[] = ".tail";
+const uint32_t DICTIONARY_FILE_VERSION = 2;
+
+struct DictionaryFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    uint64_t block_count;
+    uint64_t heap_size;
+};
+
+struct DictionaryTailHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t base;
+};
+
+namespace {
+
+struct DictionaryStorage {
+    std::vector<char> heap;
+    std::vector<uint64_t> block_offsets;
+    std::vector<uint32_t> rank2id;
+    std::vector<uint32_t> id2rank;
+    std::vector<uint64_t> buckets;
+};
+
+/* FNV-1a followed by the MurmurHash3 finalizer, it must not change since the hash table is persisted */
+uint64_t hash_term(const std::string &term) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (char ch : term) {
+        hash ^= static_cast<uint8_t>(ch);
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+void put_varint(std::vector<char> &out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+uint32_t get_varint(const char *&ptr) {
+    uint32_t value = 0;
+    for (int shift = 0; ; shift += 7) {
+        auto byte = static_cast<uint8_t>(*ptr++);
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+}
+
+/* decode the next term of a block into @term, @term holds the previous one if @index isn't 0 */
+void next_term(const char *&ptr, const uint32_t &index, std::string &term) {
+    if (index == 0) {
+        uint32_t length = get_varint(ptr);
+        term.assign(ptr, length);
+        ptr += length;
+    } else {
+        uint32_t shared = get_varint(ptr);
+        uint32_t length = get_varint(ptr);
+        term.resize(shared);
+        term.append(ptr, length);
+        ptr += length;
+    }
+}
+
+}
+
+const uint32_t Dictionary::BLOCK_SIZE;
+const uint32_t Dictionary::TAIL_RATIO;
+
+Dictionary::Dictionary()
+    : heap_(nullptr), block_offsets_(nullptr), rank2id_(nullptr), id2rank_(nullptr), buckets_(nullptr)
+    , block_size_(0), bucket_size_(0), size_(0), file_size_(0), stored_size_(0), tail_file_bytes_(0) {}
+
+Dictionary::~Dictionary() = default;
+
+bool Dictionary::Load(const std::string &path, Dictionary &dictionary, const uint32_t &size) {
+    if (!fs::exists(path) || fs::file_size(path) < sizeof(DictionaryFileHeader)) {
+        spdlog::error("`{}` cannot be read or is not a binary dictionary file.", path);
+        return false;
+    }
+
+    auto file = std::make_shared<io::mapped_file_source>(path);
+    const char *data = file->data();
+    auto header = reinterpret_cast<const DictionaryFileHeader *>(data);
+    if (std::memcmp(header->magic, DICTIONARY_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version == 0 || header->version > DICTIONARY_FILE_VERSION) {
+        spdlog::error("`{}` is not a supported dictionary file.", path);
+        return false;
+    }
+
+    data += sizeof(DictionaryFileHeader);
+    uint64_t bucket_count = 0;
+    if (header->version >= 2) {
+        bucket_count = *reinterpret_cast<const uint64_t *>(data);
+        data += sizeof(uint64_t);
+    }
+    uint64_t expect_size = sizeof(DictionaryFileHeader) + (header->block_count + 1) * sizeof(uint64_t) +
+                           header->count * 2 * sizeof(uint32_t) + header->heap_size;
+    if (header->version >= 2) {
+        expect_size += (bucket_count + 1) * sizeof(uint64_t);
+    }
+    if (file->size() != expect_size) {
+        spdlog::error("`{}` is truncated.", path);
+        return false;
+    }
+
+    dictionary.clear();
+    dictionary.buckets_ = reinterpret_cast<const uint64_t *>(data);
+    dictionary.block_offsets_ = dictionary.buckets_ + bucket_count;
+    dictionary.rank2id_ = reinterpret_cast<const uint32_t *>(dictionary.block_offsets_ + header->block_count + 1);
+    dictionary.id2rank_ = dictionary.rank2id_ + header->count;
+    dictionary.heap_ = reinterpret_cast<const char *>(dictionary.id2rank_ + header->count);
+    dictionary.block_size_ = header->block_count;
+    dictionary.bucket_size_ = bucket_count;
+    dictionary.size_ = header->count;
+    dictionary.holder_ = std::move(file);
+    dictionary.file_size_ = header->count;
+    dictionary.stored_size_ = header->count;
+
+    std::string tail_path = path + DICTIONARY_TAIL_SUFFIX;
+    if (fs::exists(tail_path)) {
+        fs::ifstream in(tail_path, fs::ifstream::in | fs::ifstream::binary);
+        DictionaryTailHeader tail_header{};
+        in.read(reinterpret_cast<char *>(&tail_header), sizeof(tail_header));
+        // a tail left by an earlier dictionary file is ignored, and overwritten by the next append
+        if (in && std::memcmp(tail_header.magic, DICTIONARY_TAIL_MAGIC, sizeof(tail_header.magic)) == 0 &&
+            tail_header.base == header->count) {
+            uint64_t bytes = sizeof(tail_header);
+            uint32_t length;
+            std::string term;
+            while (dictionary.size() < size && in.read(reinterpret_cast<char *>(&length), sizeof(length))) {
+                term.resize(length);
+                if ((length > 0 && !in.read(&term[0], length)) || !dictionary.insert(term).second) {
+                    break;
+                }
+                bytes += sizeof(length) + length;
+            }
+            // the terms after them were appended by a store which hasn't finished
+            dictionary.stored_size_ = dictionary.size();
+            dictionary.tail_file_bytes_ = bytes;
+        }
+    }
+    return true;
+}
+
+bool Dictionary::save(const std::string &path) {
+    compact();
+
+    // the file may be mapped by this or another index, so write a new file and replace it
+    std::string tmp_path = path + ".tmp";
+    fs::ofstream out(tmp_path, fs::ofstream::out | fs::ofstream::binary);
+    if (!out.is_open()) {
+        spdlog::error("`{}` cannot be written.", path);
+        return false;
+    }
+
+    uint64_t heap_size = block_offsets_[block_size_];
+    DictionaryFileHeader header{};
+    std::memcpy(header.magic, DICTIONARY_FILE_MAGIC, sizeof(header.magic));
+    header.version = DICTIONARY_FILE_VERSION;
+    header.count = size_;
+    header.block_count = block_size_;
+    header.heap_size = heap_size;
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(&bucket_size_), sizeof(bucket_size_));
+    out.write(reinterpret_cast<const char *>(buckets_), bucket_size_ * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char *>(block_offsets_), (block_size_ + 1) * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char *>(rank2id_), size_ * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char *>(id2rank_), size_ * sizeof(uint32_t));
+    out.write(heap_, heap_size);
+    out.close();
+    if (!out) {
+        spdlog::error("`{}` cannot be written.", path);
+        return false;
+    }
+    fs::rename(tmp_path, path);
+    fs::remove(path + DICTIONARY_TAIL_SUFFIX);
+    file_size_ = size_;
+    stored_size_ = size_;
+    tail_file_bytes_ = 0;
+    return true;
+}
+
+bool Dictionary::append(const std::string &path) {
+    if (!appendable()) {
+        return save(path);
+    }
+
+    std::string tail_path = path + DICTIONARY_TAIL_SUFFIX;
+    if (tail_file_bytes_ > 0 && !fs::exists(tail_path)) {
+        stored_size_ = file_size_;
+        tail_file_bytes_ = 0;
+    } else if (tail_file_bytes_ > 0 && fs::file_size(tail_path) != tail_file_bytes_) {
+        // cut off the terms appended by a store which hasn't finished
+        fs::resize_file(tail_path, tail_file_bytes_);
+    }
+    if (stored_size_ == size()) {
+        return true;
+    }
+
+    std::string buf;
+    if (tail_file_bytes_ == 0) {
+        DictionaryTailHeader header{};
+        std::memcpy(header.magic, DICTIONARY_TAIL_MAGIC, sizeof(header.magic));
+        header.version = 1;
+        header.base = file_size_;
+        buf.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+    for (uint64_t id = stored_size_ + 1; id <= size(); ++id) {
+        std::string term = getTerm(static_cast<uint32_t>(id));
+        auto length = static_cast<uint32_t>(term.size());
+        buf.append(reinterpret_cast<const char *>(&length), sizeof(length));
+        buf.append(term);
+    }
+
+    fs::ofstream out(tail_path, fs::ofstream::out | fs::ofstream::binary |
+                                (tail_file_bytes_ == 0 ? fs::ofstream::trunc : fs::ofstream::app));
+    out.write(buf.data(), buf.size());
+    out.close();
+    if (!out) {
+        spdlog::error("`{}` cannot be written.", tail_path);
+        return false;
+    }
+    tail_file_bytes_ += buf.size();
+    stored_size_ = size();
+    return true;
+}
+
+std::string Dictionary::TailPath(const std::string &path) {
+    return path + DICTIONARY_TAIL_SUFFIX;
+}
+
+uint32_t Dictionary::FileVersion(const std::string &path) {
+    fs::ifstream in(path, fs::ifstream::in | fs::ifstream::binary);
+    DictionaryFileHeader header{};
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!in || std::memcmp(header.magic, DICTIONARY_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        return 0;
+    }
+    return header.version;
+}
+
+uint32_t Dictionary::find(const std::string &term) const {
+    if (!tail_map_.empty()) {
+        auto iter = tail_map_.find(term);
+        if (iter != tail_map_.end()) {
+            return iter->second;
+        }
+    }
+
+    return bucket_size_ > 0 ? find_in_buckets_(term) : find_in_blocks_(term);
+}
+
+uint32_t Dictionary::CurrentFileVersion() {
+    return DICTIONARY_FILE_VERSION;
+}
+
+uint32_t Dictionary::find_in_buckets_(const std::string &term) const {
+    uint64_t hash = hash_term(term);
+    auto fingerprint = static_cast<uint32_t>(hash >> 32);
+    for (uint64_t slot = hash & (bucket_size_ - 1); buckets_[slot] != 0; slot = (slot + 1) & (bucket_size_ - 1)) {
+        if (static_cast<uint32_t>(buckets_[slot] >> 32) == fingerprint) {
+            auto id = static_cast<uint32_t>(buckets_[slot]);
+            if (getTerm(id) == term) {
+                return id;
+            }
+        }
+    }
+    return 0;
+}
+
+uint32_t Dictionary::find_in_blocks_(const std::string &term) const {
+    // the last block whose first term isn't greater than @term
+    uint64_t lo = 0, hi = block_size_;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (compare_block_head_(mid, term) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
+        return 0;
+    }
+
+    uint64_t block = lo - 1;
+    const char *ptr = heap_ + block_offsets_[block];
+    std::string current;
+    for (uint32_t i = 0; i < BLOCK_SIZE && block * BLOCK_SIZE + i < size_; ++i) {
+        next_term(ptr, i, current);
+        int cmp = current.compare(term);
+        if (cmp == 0) {
+            return rank2id_[block * BLOCK_SIZE + i];
+        }
+        if (cmp > 0) {
+            break;
+        }
+    }
+    return 0;
+}
+
+uint32_t Dictionary::getId(const std::string &term) const {
+    uint32_t id = find(term);
+    if (id == 0) {
+        throw std::out_of_range("term `" + term + "` doesn't exist in dictionary");
+    }
+    return id;
+}
+
+std::string Dictionary::getTerm(const uint32_t &id) const {
+    if (id == 0 || id > size()) {
+        throw std::out_of_range("id " + std::to_string(id) + " doesn't exist in dictionary");
+    }
+    if (id > size_) {
+        return *tail_[id - size_ - 1];
+    }
+
+    uint32_t rank = id2rank_[id - 1];
+    const char *ptr = heap_ + block_offsets_[rank / BLOCK_SIZE];
+    std::string term;
+    for (uint32_t i = 0; i <= rank % BLOCK_SIZE; ++i) {
+        next_term(ptr, i, term);
+    }
+    return term;
+}
+
+std::pair<uint32_t, bool> Dictionary::insert(const std::string &term) {
+    uint32_t id = find(term);
+    if (id != 0) {
+        return {id, false};
+    }
+    id = size() + 1;
+    auto ret = tail_map_.emplace(term, id);
+    tail_.emplace_back(&ret.first->first);
+    return {id, true};
+}
+
+template<typename Func>
+void Dictionary::for_each_(Func func) const {
+    std::string term;
+    for (uint64_t block = 0; block < block_size_; ++block) {
+        const char *ptr = heap_ + block_offsets_[block];
+        for (uint32_t i = 0; i < BLOCK_SIZE && block * BLOCK_SIZE + i < size_; ++i) {
+            next_term(ptr, i, term);
+            func(term, rank2id_[block * BLOCK_SIZE + i]);
+        }
+    }
+}
+
+void Dictionary::compact() {
+    if (tail_.empty() && bucket_size_ > 0) {
+        return;
+    }
+
+    std::vector<const std::string *> tail = tail_;
+    std::sort(tail.begin(), tail.end(), [](const std::string *lhs, const std::string *rhs) {
+        return *lhs < *rhs;
+    });
+
+    auto storage = std::make_shared<DictionaryStorage>();
+    storage->rank2id.reserve(size());
+    storage->id2rank.resize(size());
+    // keep the load factor of the hash table under 0.75
+    uint64_t bucket_size = 1;
+    while (bucket_size * 3 < static_cast<uint64_t>(size()) * 4 + 3) {
+        bucket_size <<= 1;
+    }
+    storage->buckets.resize(bucket_size);
+    std::string previous;
+    auto append = [&](const std::string &term, const uint32_t &id) {
+        auto rank = static_cast<uint32_t>(storage->rank2id.size());
+        if (rank % BLOCK_SIZE == 0) {
+            storage->block_offsets.emplace_back(storage->heap.size());
+            put_varint(storage->heap, static_cast<uint32_t>(term.size()));
+            storage->heap.insert(storage->heap.end(), term.begin(), term.end());
+        } else {
+            auto shared = static_cast<uint32_t>(std::mismatch(previous.begin(),
+                                                              previous.begin() + std::min(previous.size(), term.size()),
+                                                              term.begin()).first - previous.begin());
+            put_varint(storage->heap, shared);
+            put_varint(storage->heap, static_cast<uint32_t>(term.size() - shared));
+            storage->heap.insert(storage->heap.end(), term.begin() + shared, term.end());
+        }
+        storage->rank2id.emplace_back(id);
+        storage->id2rank[id - 1] = rank;
+        previous = term;
+
+        uint64_t hash = hash_term(term);
+        uint64_t slot = hash & (bucket_size - 1);
+        while (storage->buckets[slot] != 0) {
+            slot = (slot + 1) & (bucket_size - 1);
+        }
+        storage->buckets[slot] = (hash >> 32 << 32) | id;
+    };
+
+    // merge the sorted blocks and the sorted tail
+    auto tail_iter = tail.begin();
+    for_each_([&](const std::string &term, const uint32_t &id) {
+        for (; tail_iter != tail.end() && **tail_iter < term; ++tail_iter) {
+            append(**tail_iter, tail_map_.at(**tail_iter));
+        }
+        append(term, id);
+    });
+    for (; tail_iter != tail.end(); ++tail_iter) {
+        append(**tail_iter, tail_map_.at(**tail_iter));
+    }
+    storage->block_offsets.emplace_back(storage->heap.size());
+
+    heap_ = storage->heap.data();
+    block_offsets_ = storage->block_offsets.data();
+    rank2id_ = storage->rank2id.data();
+    id2rank_ = storage->id2rank.data();
+    buckets_ = storage->buckets.data();
+    block_size_ = storage->block_offsets.size() - 1;
+    bucket_size_ = storage->buckets.size();
+    size_ = storage->rank2id.size();
+    holder_ = std::move(storage);
+    tail_.clear();
+    tail_map_.clear();
+}
+
+Dictionary Dictionary::compacted() const {
+    Dictionary dictionary;
+    dictionary.holder_ = holder_;
+    dictionary.heap_ = heap_;
+    dictionary.block_offsets_ = block_offsets_;
+    dictionary.rank2id_ = rank2id_;
+    dictionary.id2rank_ = id2rank_;
+    dictionary.buckets_ = buckets_;
+    dictionary.block_size_ = block_size_;
+    dictionary.bucket_size_ = bucket_size_;
+    dictionary.size_ = size_;
+    return dictionary;
+}
+
+void Dictionary::clear() {
+    holder_.reset();
+    heap_ = nullptr;
+    block_offsets_ = nullptr;
+    rank2id_ = nullptr;
+    id2rank_ = nullptr;
+    buckets_ = nullptr;
+    block_size_ = 0;
+    bucket_size_ = 0;
+    size_ = 0;
+    file_size_ = 0;
+    stored_size_ = 0;
+    tail_file_bytes_ = 0;
+    tail_.clear();
+    tail_map_.clear();
+}
+
+int Dictionary::compare_block_head_(const uint64_t &block, const std::string &term) const {
+    const char *ptr = heap_ + block_offsets_[block];
+    uint32_t length = get_varint(ptr);
+    int cmp = std::memcmp(ptr, term.data(), std::min<size_t>(length, term.size()));
+    if (cmp != 0) {
+        return cmp;
+    }
+    return length < term.size() ? -1 : (length > term.size() ? 1 : 0);
+}
+
+}
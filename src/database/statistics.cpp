@@ -0,0 +1,390 @@
+/*
+ * @FileName   : statistics.cpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: implement `PredicateStatistics`, `CharacteristicSets` and their file layouts
+ */
+
+#include "database/statistics.hpp"
+
+#include <queue>
+#include <algorithm>
+#include <unordered_map>
+
+#include <spdlog/spdlog.h>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+namespace inno {
+
+namespace fs = boost::filesystem;
+
+const uint32_t PredicateStatistics::HEAVY_HITTER_SIZE;
+
+/* layout of the file, all integers are written in native byte order:
+ *   header, then for every predicate: size (uint64_t), then the subjects and the objects, each of them is
+ *   distinct, the number of heavy hitters, the <key, degree> of the heavy hitters,
+ *   the number of histogram buckets and the buckets (uint32_t) */
+const uint32_t STATISTICS_MAGIC = 0x534F5350;   // "PSOS"
+const uint32_t STATISTICS_VERSION = 1;
+
+struct StatisticsHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+};
+
+/* layout of the characteristic sets file, same header as the statistics one, then for every set:
+ *   count (uint64_t), the number of predicates (uint32_t), the pids (uint32_t), the occurrences (uint64_t) */
+const uint32_t CHARACTERISTIC_SETS_MAGIC = 0x434F5350;   // "PSOC"
+const uint32_t CHARACTERISTIC_SETS_VERSION = 1;
+
+namespace {
+
+/* summarize the degrees of the keys of @index */
+PredicateStatistics::Side summarize(const CsrIndex &index) {
+    using Degree = std::pair<uint32_t, uint32_t>;
+    auto heavier = [](const Degree &a, const Degree &b) {
+        return a.second > b.second || (a.second == b.second && a.first < b.first);
+    };
+
+    PredicateStatistics::Side side;
+    // a min-heap of the heaviest keys seen so far, its top is the lightest of them
+    std::priority_queue<Degree, std::vector<Degree>, decltype(heavier)> heavy(heavier);
+    for (const uint32_t key : index.keys()) {
+        auto degree = static_cast<uint32_t>(index.get(key).size());
+        if (degree == 0) {
+            continue;  // all its pairs are tombstoned
+        }
+        ++side.distinct;
+
+        std::size_t bucket = 0;
+        while (degree >> (bucket + 1)) {
+            ++bucket;
+        }
+        if (bucket >= side.histogram.size()) {
+            side.histogram.resize(bucket + 1, 0);
+        }
+        ++side.histogram[bucket];
+
+        if (heavy.size() < PredicateStatistics::HEAVY_HITTER_SIZE) {
+            heavy.emplace(key, degree);
+        } else if (heavier({key, degree}, heavy.top())) {
+            heavy.pop();
+            heavy.emplace(key, degree);
+        }
+    }
+
+    side.heavy_hitters.resize(heavy.size());
+    for (auto it = side.heavy_hitters.rbegin(); it != side.heavy_hitters.rend(); ++it) {
+        *it = heavy.top();
+        heavy.pop();
+    }
+    return side;
+}
+
+template<typename T>
+void write_value(fs::ofstream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+bool read_value(fs::ifstream &in, T &value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+void write_side(fs::ofstream &out, const PredicateStatistics::Side &side) {
+    write_value(out, side.distinct);
+    write_value(out, static_cast<uint32_t>(side.heavy_hitters.size()));
+    for (const auto &item : side.heavy_hitters) {
+        write_value(out, item.first);
+        write_value(out, item.second);
+    }
+    write_value(out, static_cast<uint32_t>(side.histogram.size()));
+    out.write(reinterpret_cast<const char *>(side.histogram.data()),
+              static_cast<std::streamsize>(side.histogram.size() * sizeof(uint32_t)));
+}
+
+bool read_side(fs::ifstream &in, PredicateStatistics::Side &side) {
+    uint32_t size = 0;
+    if (!read_value(in, side.distinct) || !read_value(in, size) || size > PredicateStatistics::HEAVY_HITTER_SIZE) {
+        return false;
+    }
+    side.heavy_hitters.resize(size);
+    for (auto &item : side.heavy_hitters) {
+        if (!read_value(in, item.first) || !read_value(in, item.second)) {
+            return false;
+        }
+    }
+    // a degree has at most 32 bits, so has its bucket
+    if (!read_value(in, size) || size > 32) {
+        return false;
+    }
+    side.histogram.resize(size);
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(side.histogram.data()),
+                                     static_cast<std::streamsize>(size * sizeof(uint32_t))));
+}
+
+}
+
+double PredicateStatistics::Side::degree(const uint32_t &key, const uint64_t &size) const {
+    if (distinct == 0) {
+        return static_cast<double>(size);  // unknown, the number of pairs bounds it
+    }
+
+    uint64_t heavy_size = 0;
+    for (const auto &item : heavy_hitters) {
+        if (item.first == key) {
+            return item.second;
+        }
+        heavy_size += item.second;
+    }
+    if (distinct <= heavy_hitters.size()) {
+        return 0;   // every key is a heavy hitter, @key has no pairs
+    }
+    return static_cast<double>(size - heavy_size) / (distinct - heavy_hitters.size());
+}
+
+void PredicateStatistics::Side::remove(const uint32_t &key, const uint32_t &count, const bool &emptied) {
+    for (auto iter = heavy_hitters.begin(); iter != heavy_hitters.end(); ++iter) {
+        if (iter->first == key) {
+            iter->second -= std::min(iter->second, count);
+            if (iter->second == 0) {
+                heavy_hitters.erase(iter);
+            }
+            break;
+        }
+    }
+    std::stable_sort(heavy_hitters.begin(), heavy_hitters.end(),
+                     [](const std::pair<uint32_t, uint32_t> &a, const std::pair<uint32_t, uint32_t> &b) {
+                         return a.second > b.second;
+                     });
+    if (emptied && distinct > 0) {
+        --distinct;
+    }
+}
+
+PredicateStatistics PredicateStatistics::Compute(const CsrIndex &s2o, const CsrIndex &o2s) {
+    PredicateStatistics statistics;
+    statistics.size = s2o.size();
+    statistics.subjects = summarize(s2o);
+    statistics.objects = summarize(o2s);
+    return statistics;
+}
+
+bool PredicateStatistics::Store(const std::string &path, const std::vector<PredicateStatistics> &statistics) {
+    // write aside then rename, so a failed store keeps the previous file
+    fs::path tmp_path = path + ".tmp";
+    fs::ofstream out(tmp_path, fs::ofstream::out | fs::ofstream::binary | fs::ofstream::trunc);
+    if (!out.is_open()) {
+        spdlog::error("`{}` cannot be opened.", tmp_path.string());
+        return false;
+    }
+
+    StatisticsHeader header{STATISTICS_MAGIC, STATISTICS_VERSION, static_cast<uint32_t>(statistics.size())};
+    write_value(out, header);
+    for (const auto &item : statistics) {
+        write_value(out, item.size);
+        write_side(out, item.subjects);
+        write_side(out, item.objects);
+    }
+    out.close();
+    if (!out) {
+        spdlog::error("`{}` cannot be written.", tmp_path.string());
+        return false;
+    }
+
+    boost::system::error_code ec;
+    fs::rename(tmp_path, path, ec);
+    if (ec) {
+        spdlog::error("`{}` cannot be renamed to `{}`: {}.", tmp_path.string(), path, ec.message());
+        return false;
+    }
+    return true;
+}
+
+bool PredicateStatistics::Load(const std::string &path, std::vector<PredicateStatistics> &statistics) {
+    fs::ifstream in(path, fs::ifstream::in | fs::ifstream::binary);
+    if (!in.is_open()) {
+        spdlog::error("`{}` cannot be opened.", path);
+        return false;
+    }
+
+    StatisticsHeader header{};
+    if (!read_value(in, header) || header.magic != STATISTICS_MAGIC || header.version != STATISTICS_VERSION) {
+        spdlog::error("`{}` is not a statistics file of version {}.", path, STATISTICS_VERSION);
+        return false;
+    }
+
+    std::vector<PredicateStatistics> loaded(header.count);
+    for (auto &item : loaded) {
+        if (!read_value(in, item.size) || !read_side(in, item.subjects) || !read_side(in, item.objects)) {
+            spdlog::error("`{}` is truncated.", path);
+            return false;
+        }
+    }
+    statistics.swap(loaded);
+    return true;
+}
+
+CharacteristicSets CharacteristicSets::Compute(const uint32_t &predicate_size,
+                                               const std::function<CsrIndex(const uint32_t &)> &index_of) {
+    // 1. the predicates of a subject are visited in ascending pid order, so its set grows along the edges of
+    //    a trie of the interned sets, `interned[0]` is the empty set
+    std::vector<std::vector<uint32_t>> interned(1);
+    std::unordered_map<uint64_t, uint32_t> edges;
+    std::vector<uint32_t> set_of;
+    std::vector<CsrIndex> indexes(predicate_size + 1);
+    for (uint32_t pid = 1; pid <= predicate_size; ++pid) {
+        indexes[pid] = index_of(pid);
+        for (const uint32_t sid : indexes[pid].keys()) {
+            if (indexes[pid].get(sid).size() == 0) {
+                continue;  // all its pairs are tombstoned
+            }
+            if (sid >= set_of.size()) {
+                set_of.resize(sid + 1, 0);
+            }
+            uint64_t edge = (static_cast<uint64_t>(set_of[sid]) << 32) | pid;
+            auto iter = edges.find(edge);
+            if (iter == edges.end()) {
+                std::vector<uint32_t> predicates = interned[set_of[sid]];
+                predicates.emplace_back(pid);
+                interned.emplace_back(std::move(predicates));
+                iter = edges.emplace(edge, static_cast<uint32_t>(interned.size() - 1)).first;
+            }
+            set_of[sid] = iter->second;
+        }
+    }
+
+    // 2. count the subjects of the final sets, the other interned sets are prefixes of them
+    CharacteristicSets sets;
+    std::vector<uint32_t> set_index(interned.size(), UINT32_MAX);
+    for (const auto &id : set_of) {
+        if (id == 0) {
+            continue;
+        }
+        if (set_index[id] == UINT32_MAX) {
+            set_index[id] = static_cast<uint32_t>(sets.sets_.size());
+            sets.sets_.emplace_back();
+            sets.sets_.back().predicates = interned[id];
+            sets.sets_.back().occurrences.assign(interned[id].size(), 0);
+        }
+        ++sets.sets_[set_index[id]].count;
+    }
+
+    // 3. sum the pairs of every predicate of a set up
+    for (uint32_t pid = 1; pid <= predicate_size; ++pid) {
+        for (const uint32_t sid : indexes[pid].keys()) {
+            std::size_t degree = indexes[pid].get(sid).size();
+            if (degree == 0) {
+                continue;
+            }
+            Set &set = sets.sets_[set_index[set_of[sid]]];
+            auto position = std::lower_bound(set.predicates.begin(), set.predicates.end(), pid);
+            set.occurrences[position - set.predicates.begin()] += degree;
+        }
+    }
+
+    std::sort(sets.sets_.begin(), sets.sets_.end(), [](const Set &a, const Set &b) {
+        return a.count > b.count || (a.count == b.count && a.predicates < b.predicates);
+    });
+    return sets;
+}
+
+bool CharacteristicSets::save(const std::string &path) const {
+    fs::path tmp_path = path + ".tmp";
+    fs::ofstream out(tmp_path, fs::ofstream::out | fs::ofstream::binary | fs::ofstream::trunc);
+    if (!out.is_open()) {
+        spdlog::error("`{}` cannot be opened.", tmp_path.string());
+        return false;
+    }
+
+    StatisticsHeader header{CHARACTERISTIC_SETS_MAGIC, CHARACTERISTIC_SETS_VERSION,
+                            static_cast<uint32_t>(sets_.size())};
+    write_value(out, header);
+    for (const auto &set : sets_) {
+        write_value(out, set.count);
+        write_value(out, static_cast<uint32_t>(set.predicates.size()));
+        out.write(reinterpret_cast<const char *>(set.predicates.data()),
+                  static_cast<std::streamsize>(set.predicates.size() * sizeof(uint32_t)));
+        out.write(reinterpret_cast<const char *>(set.occurrences.data()),
+                  static_cast<std::streamsize>(set.occurrences.size() * sizeof(uint64_t)));
+    }
+    out.close();
+    if (!out) {
+        spdlog::error("`{}` cannot be written.", tmp_path.string());
+        return false;
+    }
+
+    boost::system::error_code ec;
+    fs::rename(tmp_path, path, ec);
+    if (ec) {
+        spdlog::error("`{}` cannot be renamed to `{}`: {}.", tmp_path.string(), path, ec.message());
+        return false;
+    }
+    return true;
+}
+
+bool CharacteristicSets::Load(const std::string &path, CharacteristicSets &sets) {
+    fs::ifstream in(path, fs::ifstream::in | fs::ifstream::binary);
+    if (!in.is_open()) {
+        spdlog::error("`{}` cannot be opened.", path);
+        return false;
+    }
+
+    StatisticsHeader header{};
+    if (!read_value(in, header) || header.magic != CHARACTERISTIC_SETS_MAGIC ||
+        header.version != CHARACTERISTIC_SETS_VERSION) {
+        spdlog::error("`{}` is not a characteristic sets file of version {}.", path, CHARACTERISTIC_SETS_VERSION);
+        return false;
+    }
+
+    std::vector<Set> loaded(header.count);
+    for (auto &set : loaded) {
+        uint32_t size = 0;
+        if (!read_value(in, set.count) || !read_value(in, size)) {
+            spdlog::error("`{}` is truncated.", path);
+            return false;
+        }
+        set.predicates.resize(size);
+        set.occurrences.resize(size);
+        if (!in.read(reinterpret_cast<char *>(set.predicates.data()),
+                     static_cast<std::streamsize>(size * sizeof(uint32_t))) ||
+            !in.read(reinterpret_cast<char *>(set.occurrences.data()),
+                     static_cast<std::streamsize>(size * sizeof(uint64_t)))) {
+            spdlog::error("`{}` is truncated.", path);
+            return false;
+        }
+    }
+    sets.sets_.swap(loaded);
+    return true;
+}
+
+double CharacteristicSets::estimate(const std::vector<Pattern> &patterns) const {
+    std::vector<uint32_t> pid_list;
+    for (const auto &pattern : patterns) {
+        pid_list.emplace_back(pattern.first);
+    }
+    std::sort(pid_list.begin(), pid_list.end());
+    pid_list.erase(std::unique(pid_list.begin(), pid_list.end()), pid_list.end());
+
+    // every subject of a set which has all the predicates joins the pairs of every pattern,
+    // a set contributes its subjects times the average pairs of the patterns
+    double estimated = 0;
+    for (const auto &set : sets_) {
+        if (!std::includes(set.predicates.begin(), set.predicates.end(), pid_list.begin(), pid_list.end())) {
+            continue;
+        }
+        double size = static_cast<double>(set.count);
+        for (const auto &pattern : patterns) {
+            auto position = std::lower_bound(set.predicates.begin(), set.predicates.end(), pattern.first);
+            size *= static_cast<double>(set.occurrences[position - set.predicates.begin()]) / set.count *
+                    pattern.second;
+        }
+        estimated += size;
+    }
+    return estimated;
+}
+
+}
@@ -0,0 +1,189 @@
+/*
+ * @FileName   : write_ahead_log.cpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: implement `WriteAheadLog` and its record layout
+ */
+
+#include "database/write_ahead_log.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+namespace inno {
+
+namespace fs = boost::filesystem;
+
+/* layout of a record, all integers are written in native byte order:
+ *   header, then `count` triplets, each of them is 3 terms of <length (uint32_t), bytes>.
+ * `magic` tells the operation of the record, `checksum` is the CRC-32 of `sequence`, `count` and the triplets */
+const uint32_t WAL_INSERT_MAGIC = 0x574F5350;   // "PSOW"
+const uint32_t WAL_REMOVE_MAGIC = 0x454F5350;   // "PSOE"
+
+struct WalRecordHeader {
+    uint32_t magic;
+    uint32_t size;          // bytes of the triplets
+    uint64_t sequence;
+    uint32_t count;
+    uint32_t checksum;
+};
+
+namespace {
+
+uint32_t checksum(const WalRecordHeader &header, const char *data, const std::size_t &size) {
+    boost::crc_32_type crc;
+    crc.process_bytes(&header.sequence, sizeof(header.sequence));
+    crc.process_bytes(&header.count, sizeof(header.count));
+    crc.process_bytes(data, size);
+    return crc.checksum();
+}
+
+bool read_term(const char *&ptr, const char *end, std::string &term) {
+    uint32_t length;
+    if (end - ptr < static_cast<std::ptrdiff_t>(sizeof(length))) {
+        return false;
+    }
+    std::memcpy(&length, ptr, sizeof(length));
+    ptr += sizeof(length);
+    if (end - ptr < static_cast<std::ptrdiff_t>(length)) {
+        return false;
+    }
+    term.assign(ptr, length);
+    ptr += length;
+    return true;
+}
+
+void write_term(std::string &buf, const std::string &term) {
+    auto length = static_cast<uint32_t>(term.size());
+    buf.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    buf.append(term);
+}
+
+}
+
+WriteAheadLog::WriteAheadLog() : file_(nullptr), sequence_(0), size_(0) {}
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+bool WriteAheadLog::open(const std::string &path, const uint64_t &checkpoint, const ReplayFunc &replay) {
+    close();
+    path_ = path;
+    sequence_ = checkpoint;
+    size_ = 0;
+
+    if (fs::exists(path)) {
+        fs::ifstream in(path, fs::ifstream::in | fs::ifstream::binary);
+        WalRecordHeader header{};
+        std::string data;
+        std::vector<Triplet> triplets;
+        while (in.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+            if (header.magic != WAL_INSERT_MAGIC && header.magic != WAL_REMOVE_MAGIC) {
+                break;
+            }
+            data.resize(header.size);
+            if (!in.read(&data[0], header.size) || checksum(header, data.data(), data.size()) != header.checksum) {
+                break;
+            }
+
+            triplets.clear();
+            const char *ptr = data.data();
+            const char *end = ptr + data.size();
+            std::string s, p, o;
+            for (uint32_t i = 0; i < header.count; ++i) {
+                if (!read_term(ptr, end, s) || !read_term(ptr, end, p) || !read_term(ptr, end, o)) {
+                    break;
+                }
+                triplets.emplace_back(std::move(s), std::move(p), std::move(o));
+            }
+            if (triplets.size() != header.count) {
+                break;
+            }
+
+            size_ += sizeof(header) + header.size;
+            if (header.sequence > checkpoint) {
+                replay(header.magic == WAL_INSERT_MAGIC ? INSERT : REMOVE, triplets);
+            }
+            sequence_ = std::max(sequence_, header.sequence);
+        }
+        in.close();
+
+        if (fs::file_size(path) > size_) {
+            // the last append was interrupted, it has never been acknowledged
+            spdlog::warn("`{}` has a torn record at byte {}, which is dropped.", path, size_);
+            fs::resize_file(path, size_);
+        }
+    }
+
+    file_ = std::fopen(path.c_str(), "ab");
+    if (!file_) {
+        spdlog::error("`{}` cannot be opened for appending.", path);
+        return false;
+    }
+    return true;
+}
+
+void WriteAheadLog::close() {
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+uint64_t WriteAheadLog::append(const Operation &operation, const std::vector<Triplet> &triplets) {
+    if (!file_) {
+        return 0;
+    }
+
+    std::string buf(sizeof(WalRecordHeader), '\0');
+    for (const auto &triplet : triplets) {
+        write_term(buf, std::get<0>(triplet));
+        write_term(buf, std::get<1>(triplet));
+        write_term(buf, std::get<2>(triplet));
+    }
+
+    WalRecordHeader header{};
+    header.magic = operation == INSERT ? WAL_INSERT_MAGIC : WAL_REMOVE_MAGIC;
+    header.size = static_cast<uint32_t>(buf.size() - sizeof(header));
+    header.sequence = sequence_ + 1;
+    header.count = static_cast<uint32_t>(triplets.size());
+    header.checksum = checksum(header, buf.data() + sizeof(header), header.size);
+    std::memcpy(&buf[0], &header, sizeof(header));
+
+    if (std::fwrite(buf.data(), 1, buf.size(), file_) != buf.size() ||
+        std::fflush(file_) != 0 || ::fsync(fileno(file_)) != 0) {
+        spdlog::error("`{}` cannot be written.", path_);
+        // cut the partial record off, so later records stay readable
+        std::clearerr(file_);
+        if (::ftruncate(fileno(file_), static_cast<off_t>(size_)) != 0) {
+            spdlog::error("`{}` cannot be truncated.", path_);
+        }
+        return 0;
+    }
+
+    size_ += buf.size();
+    return ++sequence_;
+}
+
+bool WriteAheadLog::reset() {
+    if (!file_) {
+        return false;
+    }
+    if (std::fflush(file_) != 0 || ::ftruncate(fileno(file_), 0) != 0 || ::fsync(fileno(file_)) != 0) {
+        spdlog::error("`{}` cannot be truncated.", path_);
+        return false;
+    }
+    size_ = 0;
+    return true;
+}
+
+}
@@ -9,6 +9,9 @@
 #include "parser/sparql_parser.hpp"
 
 #include <regex>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
 #include <sstream>
 #include <unordered_map>
 
@@ -18,32 +21,90 @@
 //const std::regex INSERT_PATTERN(R"(INSERT\s+DATA\s*\{([^}]+)\})", std::regex::icase);
 const std::regex QUERY_PATTERN(R"(SELECT\s+(DISTINCT)?(.*)[\s]*WHERE\s*\{([^}]+)\})", std::regex::icase);
 const std::regex INSERT_PATTERN(R"(INSERT\s+DATA\s*\{([^}]+)\})", std::regex::icase);
+const std::regex DELETE_DATA_PATTERN(R"(DELETE\s+DATA\s*\{([^}]+)\})", std::regex::icase);
 const std::regex DELETE_PATTERN(R"(DELETE\s+WHERE\s*\{([^}]+)\})", std::regex::icase);
+const std::regex LIMIT_PATTERN(R"(^\s*LIMIT\s+(\d+))", std::regex::icase);
+const std::regex OFFSET_PATTERN(R"(^\s*OFFSET\s+(\d+))", std::regex::icase);
 
 namespace inno {
 
 class SparqlParser::Impl {
 public:
     bool distinct_ = false;
+    std::size_t limit_ = SparqlParser::NO_LIMIT;
+    std::size_t offset_ = 0;
     std::vector<std::string> query_variables;
     std::vector<Triplet> query_triplets_;
     std::vector<Triplet> insert_triplets_;
+    std::vector<Triplet> delete_triplets_;
     std::vector<std::string> predicates_indexed_list_;
 
     void parse(const std::string &sparql) {
+        // the parser may be reused, so forget the previous statement
+        distinct_ = false;
+        limit_ = SparqlParser::NO_LIMIT;
+        offset_ = 0;
+        query_variables.clear();
+        query_triplets_.clear();
+        insert_triplets_.clear();
+        delete_triplets_.clear();
+        predicates_indexed_list_.clear();
+
         std::smatch match;
         if (std::regex_search(sparql, match, QUERY_PATTERN)) {
             distinct_ = !match.str(1).empty();
             catchQueryVariables_(match.str(2));
             catchQueryTriplets_(match.str(3));
+            catchSolutionModifiers_(match.suffix().str());
         } else if (std::regex_search(sparql, match, INSERT_PATTERN)) {
             catchInsertTriplets(match.str(1));
+        } else if (std::regex_search(sparql, match, DELETE_DATA_PATTERN)) {
+            catchDeleteTriplets_(match.str(1));
+        } else if (std::regex_search(sparql, match, DELETE_PATTERN)) {
+            // the pattern is queried like a SELECT of all its variables, every match of it is deleted
+            catchQueryTriplets_(match.str(1));
+            delete_triplets_ = query_triplets_;
+            for (const auto &triplet : query_triplets_) {
+                for (const auto &term : {std::get<0>(triplet), std::get<2>(triplet)}) {
+                    if (term[0] == '?' &&
+                        std::find(query_variables.begin(), query_variables.end(), term) == query_variables.end()) {
+                        query_variables.emplace_back(term);
+                    }
+                }
+            }
         } else {
             spdlog::error("[SPARQL parser] cannot parse it as SPARQL.");
         }
     }
 
 private:
+    /* LIMIT and OFFSET after the WHERE clause, in either order */
+    void catchSolutionModifiers_(std::string modifiers) {
+        std::smatch match;
+        for (bool found = true; found;) {
+            found = false;
+            if (std::regex_search(modifiers, match, LIMIT_PATTERN)) {
+                limit_ = count_(match.str(1));
+                found = true;
+            } else if (std::regex_search(modifiers, match, OFFSET_PATTERN)) {
+                offset_ = count_(match.str(1));
+                found = true;
+            }
+            if (found) {
+                modifiers = match.suffix().str();
+            }
+        }
+    }
+
+    /* the number of a LIMIT or OFFSET, a number too large for `std::size_t` is clamped to `NO_LIMIT` */
+    static std::size_t count_(const std::string &digits) {
+        try {
+            return static_cast<std::size_t>(std::min<unsigned long long>(std::stoull(digits), NO_LIMIT));
+        } catch (const std::out_of_range &) {
+            return NO_LIMIT;
+        }
+    }
+
     void catchQueryVariables_(const std::string &raw_variables) {
         query_variables.clear();
 
@@ -56,19 +117,28 @@ private:
         query_variables.assign(beg, end);
     }
 
-    void catchQueryTriplets_(const std::string &raw_triplet) {
-        query_triplets_.clear();
-
-        std::regex sep("\\.\\s+");
+    /* split the triplets of a group of patterns, a '.' ends a triplet only if a space or the end follows it,
+     * so the dots inside IRIs are kept, the fragments which aren't triplets are skipped */
+    static std::vector<Triplet> splitTriplets_(const std::string &raw_triplet) {
+        std::regex sep("\\.(\\s+|$)");
         std::sregex_token_iterator tokens(raw_triplet.cbegin(), raw_triplet.cend(), sep, -1);
         std::sregex_token_iterator end;
 
+        std::vector<Triplet> triplets;
         std::string s, p, o;
         for (; tokens != end; ++ tokens) {
             std::istringstream iss(*tokens);
-            iss >> s >> p >> o;
-            query_triplets_.emplace_back(s, p, o);
-            predicates_indexed_list_.emplace_back(p);
+            if (iss >> s >> p >> o) {
+                triplets.emplace_back(s, p, o);
+            }
+        }
+        return triplets;
+    }
+
+    void catchQueryTriplets_(const std::string &raw_triplet) {
+        query_triplets_ = splitTriplets_(raw_triplet);
+        for (const auto &triplet : query_triplets_) {
+            predicates_indexed_list_.emplace_back(std::get<1>(triplet));
         }
     }
 
@@ -86,8 +156,17 @@ private:
             insert_triplets_.emplace_back(s, p, o);
         }
     }
+
+    void catchDeleteTriplets_(const std::string &raw_triplet) {
+        delete_triplets_ = splitTriplets_(raw_triplet);
+        for (const auto &triplet : delete_triplets_) {
+            predicates_indexed_list_.emplace_back(std::get<1>(triplet));
+        }
+    }
 };
 
+const std::size_t SparqlParser::NO_LIMIT;
+
 SparqlParser::SparqlParser(): impl_(new Impl()) { }
 
 SparqlParser::~SparqlParser() { }
@@ -128,8 +207,20 @@ std::vector<inno::Triplet> SparqlParser::getInsertTriplets() const {
     return impl_->insert_triplets_;
 }
 
+std::vector<inno::Triplet> SparqlParser::getDeleteTriplets() const {
+    return impl_->delete_triplets_;
+}
+
 bool SparqlParser::isDistinctQuery() {
     return impl_->distinct_;
 }
 
+std::size_t SparqlParser::getLimit() const {
+    return impl_->limit_;
+}
+
+std::size_t SparqlParser::getOffset() const {
+    return impl_->offset_;
+}
+
 }
@@ -0,0 +1,341 @@
+/*
+ * @FileName   : hash_distinct.cpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: implement `HashDistinct`
+ */
+
+#include "query/hash_distinct.hpp"
+
+#include <limits>
+#include <future>
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+namespace inno {
+
+const uint32_t HashDistinct::PARTITION_BITS;
+const uint32_t HashDistinct::MAX_LEVEL;
+const std::size_t HashDistinct::DEFAULT_MEMORY_LIMIT;
+const std::size_t HashDistinct::BUFFER_RECORDS;
+
+namespace {
+
+/* reads the whole records of a spill file block by block, a torn record at its end is dropped */
+class RecordReader {
+public:
+    RecordReader(std::FILE *file, const std::size_t &record_size)
+            : file_(file), record_size_(record_size), block_(record_size * HashDistinct::BUFFER_RECORDS),
+              size_(0), pos_(0) {
+        std::rewind(file_);
+    }
+
+    /* the next record, nullptr at the end of the file */
+    const uint32_t *next() {
+        if (pos_ == size_) {
+            size_ = std::fread(block_.data(), sizeof(uint32_t), block_.size(), file_);
+            size_ -= size_ % record_size_;
+            pos_ = 0;
+            if (size_ == 0) {
+                return nullptr;
+            }
+        }
+        const uint32_t *record = block_.data() + pos_;
+        pos_ += record_size_;
+        return record;
+    }
+
+private:
+    std::FILE *file_;
+    std::size_t record_size_;
+    std::vector<uint32_t> block_;
+    std::size_t size_;
+    std::size_t pos_;
+};
+
+}
+
+HashDistinct::HashDistinct(std::size_t width, std::size_t memory_limit)
+        : width_(width), memory_limit_(memory_limit), memory_(0), partitions_(std::size_t(1) << PARTITION_BITS) {}
+
+HashDistinct::~HashDistinct() {
+    for (auto &partition : partitions_) {
+        if (partition.spill) {
+            std::fclose(partition.spill);
+        }
+    }
+}
+
+HashDistinct::Status HashDistinct::insert(const uint32_t *row) {
+    uint64_t hash = Hash(row, width_);
+    Partition &partition = partitions_[hash >> (64 - PARTITION_BITS)];
+    if (partition.spill && partition.failed) {
+        std::size_t usage = partition.deferred.memoryUsage();
+        partition.deferred.insert(row, width_, hash);
+        memory_ += partition.deferred.memoryUsage() - usage;
+        return DEFERRED;
+    }
+    if (partition.spill) {
+        partition.buffer.emplace_back(0);
+        partition.buffer.insert(partition.buffer.end(), row, row + width_);
+        if (partition.buffer.size() >= BUFFER_RECORDS * (width_ + 1)) {
+            flush_(partition);
+        }
+        return DEFERRED;
+    }
+
+    std::size_t usage = partition.table.memoryUsage();
+    if (!partition.table.insert(row, width_, hash)) {
+        return DUPLICATE;
+    }
+    memory_ += partition.table.memoryUsage() - usage;
+    while (memory_ > memory_limit_ && spill_()) {}
+    return NEW;
+}
+
+bool HashDistinct::finish(const std::function<bool(const uint32_t *)> &emit,
+                          ThreadPool *pool, std::size_t parallelism) {
+    // the rows in memory have been emitted, so the whole budget is left to the spilled partitions
+    std::vector<const Partition *> spilled;
+    for (auto &partition : partitions_) {
+        partition.table = Table();
+        if (partition.spill) {
+            flush_(partition);
+            spilled.emplace_back(&partition);
+        }
+    }
+    memory_ = 0;
+
+    // a partition holds the rows of a hash range, so the partitions are deduplicated independently,
+    // each of the ones deduplicated at once gets an equal share of the budget
+    parallelism = pool ? std::max<std::size_t>(1, std::min(parallelism, spilled.size())) : 1;
+    const std::size_t budget = memory_limit_ / parallelism;
+    for (std::size_t first = 0; first < spilled.size(); first += parallelism) {
+        std::size_t num = std::min(parallelism, spilled.size() - first);
+        std::vector<BindingTable> outputs(num, BindingTable(width_));
+        std::vector<std::future<void>> tasks;
+        for (std::size_t i = 1; i < num; ++i) {
+            tasks.emplace_back(pool->submit([this, &outputs, &spilled, first, i, budget]() {
+                deduplicate_(*spilled[first + i], budget, outputs[i]);
+            }));
+        }
+        deduplicate_(*spilled[first], budget, outputs[0]);
+        for (auto &task : tasks) {
+            pool->wait(task);
+        }
+
+        for (const auto &output : outputs) {
+            for (std::size_t i = 0; i < output.size(); ++i) {
+                if (!emit(output.row(i))) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+std::size_t HashDistinct::spilledPartitions() const {
+    return std::count_if(partitions_.begin(), partitions_.end(),
+                         [](const Partition &partition) { return partition.spill != nullptr; });
+}
+
+uint64_t HashDistinct::Hash(const uint32_t *row, const std::size_t &width) {
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ width;
+    for (std::size_t i = 0; i < width; ++i) {
+        hash = (hash ^ row[i]) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+    }
+    // the high bits pick the partition and the low ones the slot, so every bit is mixed
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+bool HashDistinct::spill_() {
+    auto largest = std::max_element(partitions_.begin(), partitions_.end(),
+                                    [](const Partition &a, const Partition &b) {
+        return a.table.size < b.table.size;
+    });
+    if (largest->table.size == 0) {
+        return false;
+    }
+
+    std::FILE *file = CreateSpill();
+    bool written = file != nullptr;
+    std::vector<uint32_t> buffer;
+    buffer.reserve(BUFFER_RECORDS * (width_ + 1));
+    for (std::size_t i = 0; written && i < largest->table.size; ++i) {
+        const uint32_t *row = largest->table.rows.data() + i * width_;
+        buffer.emplace_back(1);
+        buffer.insert(buffer.end(), row, row + width_);
+        if (buffer.size() == buffer.capacity() || i + 1 == largest->table.size) {
+            written = Write(file, buffer, width_ + 1);
+        }
+    }
+    if (!written) {
+        // keep the rows in memory from now on
+        spdlog::error("[distinct] cannot spill the rows into a temporary file, keep them in memory.");
+        if (file) {
+            std::fclose(file);
+        }
+        memory_limit_ = std::numeric_limits<std::size_t>::max();
+        return false;
+    }
+
+    memory_ -= largest->table.memoryUsage();
+    largest->table = Table();
+    largest->spill = file;
+    return true;
+}
+
+std::FILE *HashDistinct::CreateSpill() {
+    std::FILE *file = std::tmpfile();
+    if (file && std::setvbuf(file, nullptr, _IONBF, 0) != 0) {
+        std::fclose(file);
+        return nullptr;
+    }
+    return file;
+}
+
+bool HashDistinct::Write(std::FILE *file, std::vector<uint32_t> &buffer, const std::size_t &record_size) {
+    std::size_t written = std::fwrite(buffer.data(), sizeof(uint32_t), buffer.size(), file);
+    buffer.erase(buffer.begin(), buffer.begin() + written / record_size * record_size);
+    return buffer.empty();
+}
+
+void HashDistinct::flush_(Partition &partition) {
+    if (partition.failed || Write(partition.spill, partition.buffer, width_ + 1)) {
+        return;
+    }
+    // the file isn't appended to any more, so a torn record can only be its last one
+    spdlog::error("[distinct] cannot write the spilled rows, keep the deferred ones in memory.");
+    partition.failed = true;
+    std::size_t usage = partition.deferred.memoryUsage();
+    for (std::size_t i = 0; i < partition.buffer.size(); i += width_ + 1) {
+        const uint32_t *row = partition.buffer.data() + i + 1;
+        partition.deferred.insert(row, width_, Hash(row, width_));
+    }
+    memory_ += partition.deferred.memoryUsage() - usage;
+    partition.buffer = std::vector<uint32_t>();
+}
+
+void HashDistinct::deduplicate_(const Partition &partition, const std::size_t &budget,
+                                BindingTable &output) const {
+    if (!partition.failed) {
+        deduplicate_(partition.spill, 0, budget, output);
+        return;
+    }
+    // the deferred rows in memory are over the budget already, so the partition is deduplicated as a whole
+    Table table;
+    RecordReader reader(partition.spill, width_ + 1);
+    for (const uint32_t *record = reader.next(); record; record = reader.next()) {
+        if (table.insert(record + 1, width_, Hash(record + 1, width_)) && record[0] == 0) {
+            output.appendRow(record + 1);
+        }
+    }
+    for (std::size_t i = 0; i < partition.deferred.size; ++i) {
+        const uint32_t *row = partition.deferred.rows.data() + i * width_;
+        if (table.insert(row, width_, Hash(row, width_))) {
+            output.appendRow(row);
+        }
+    }
+}
+
+void HashDistinct::deduplicate_(std::FILE *file, const uint32_t &level, const std::size_t &budget,
+                                BindingTable &output) const {
+    // the emitted rows were written when the partition was spilled, so they come before the deferred ones,
+    // and a split keeps the order of the records
+    const bool splittable = level < MAX_LEVEL;
+    {
+        Table table;
+        BindingTable rows(width_);
+        bool fits = true;
+        RecordReader reader(file, width_ + 1);
+        for (const uint32_t *record = reader.next(); fits && record; record = reader.next()) {
+            const uint32_t *row = record + 1;
+            if (table.insert(row, width_, Hash(row, width_)) && record[0] == 0) {
+                rows.appendRow(row);
+            }
+            // a single row can't be split any further
+            fits = !splittable || table.size <= 1 ||
+                   table.memoryUsage() + rows.size() * width_ * sizeof(uint32_t) <= budget;
+        }
+        if (fits) {
+            output.append(rows);
+            return;
+        }
+    }
+
+    // split the partition on the next bits of the hash, which the rows of a partition don't share
+    const uint32_t shift = 64 - PARTITION_BITS * (level + 2);
+    const uint64_t mask = (uint64_t(1) << PARTITION_BITS) - 1;
+    std::vector<std::FILE *> parts(std::size_t(1) << PARTITION_BITS, nullptr);
+    bool written = true;
+    {
+        std::vector<std::vector<uint32_t>> buffers(parts.size());
+        RecordReader reader(file, width_ + 1);
+        for (const uint32_t *record = reader.next(); written && record; record = reader.next()) {
+            std::size_t index = (Hash(record + 1, width_) >> shift) & mask;
+            parts[index] = parts[index] ? parts[index] : CreateSpill();
+            buffers[index].insert(buffers[index].end(), record, record + width_ + 1);
+            written = parts[index] != nullptr;
+            if (written && buffers[index].size() >= BUFFER_RECORDS * (width_ + 1)) {
+                written = Write(parts[index], buffers[index], width_ + 1);
+            }
+        }
+        for (std::size_t index = 0; written && index < parts.size(); ++index) {
+            written = !parts[index] || Write(parts[index], buffers[index], width_ + 1);
+        }
+    }
+    if (!written) {
+        spdlog::error("[distinct] cannot split the spilled rows into temporary files, keep them in memory.");
+    }
+    for (auto &part : parts) {
+        if (part && written) {
+            deduplicate_(part, level + 1, budget, output);
+        }
+        if (part) {
+            std::fclose(part);
+        }
+    }
+    if (!written) {
+        // the partition as a whole, over the budget
+        deduplicate_(file, MAX_LEVEL, budget, output);
+    }
+}
+
+bool HashDistinct::Table::insert(const uint32_t *row, const std::size_t &width, const uint64_t &hash) {
+    if ((size + 1) * 2 > slots.size()) {
+        slots.assign(std::max<std::size_t>(16, slots.size() * 2), 0);
+        std::size_t mask = slots.size() - 1;
+        for (std::size_t i = 0; i < size; ++i) {
+            std::size_t slot = Hash(rows.data() + i * width, width) & mask;
+            while (slots[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = static_cast<uint32_t>(i + 1);
+        }
+    }
+
+    std::size_t mask = slots.size() - 1;
+    std::size_t slot = hash & mask;
+    for (; slots[slot] != 0; slot = (slot + 1) & mask) {
+        const uint32_t *other = rows.data() + (slots[slot] - 1) * width;
+        if (std::equal(row, row + width, other)) {
+            return false;
+        }
+    }
+    rows.insert(rows.end(), row, row + width);
+    slots[slot] = static_cast<uint32_t>(++size);
+    return true;
+}
+
+std::size_t HashDistinct::Table::memoryUsage() const {
+    return (rows.capacity() + slots.capacity()) * sizeof(uint32_t);
+}
+
+}
@@ -0,0 +1,209 @@
+/*
+ * @FileName   : join_optimizer.cpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: implement `JoinOptimizer`
+ */
+
+#include "query/join_optimizer.hpp"
+
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+
+namespace inno {
+
+const std::size_t JoinOptimizer::DP_LIMIT;
+
+JoinOptimizer::JoinOptimizer(std::vector<Pattern> patterns, const CharacteristicSets &characteristic_sets)
+        : patterns_(std::move(patterns)), characteristic_sets_(characteristic_sets) {}
+
+JoinOptimizer::Pattern JoinOptimizer::Estimate(const DatabaseBuilder::Option &db, const Triplet &triplet) {
+    std::string s, p, o;
+    std::tie(s, p, o) = triplet;
+    bool is_s_var = s[0] == '?';
+    bool is_o_var = o[0] == '?';
+    uint32_t pid = db.getPredicateId(p);
+    const auto &statistics = db.getStatisticsByP(pid);
+
+    Pattern pattern;
+    pattern.size = db.getPredicateCountBy(p);
+    if (!is_s_var) {
+        pattern.size = std::min<double>({pattern.size, statistics.objectsOf(db.getEntityId(s)),
+                                         static_cast<double>(db.getSubjectCountBy(s))});
+    }
+    if (!is_o_var) {
+        pattern.size = std::min<double>({pattern.size, statistics.subjectsOf(db.getEntityId(o)),
+                                         static_cast<double>(db.getObjectCountBy(o))});
+        pattern.star.second = statistics.size == 0 ? 0 : statistics.subjectsOf(db.getEntityId(o)) / statistics.size;
+    }
+    pattern.star.first = pid;
+
+    // a variable has a value per match at most, and the distinct keys of its side if the other one is free
+    auto distinct = [&pattern](const uint32_t &keys, const bool &other_free) {
+        double values = other_free && keys > 0 ? keys : pattern.size;
+        return std::max(std::min(values, pattern.size), std::min(1.0, pattern.size));
+    };
+    if (is_s_var && is_o_var && s == o) {
+        pattern.variables.emplace_back(s, distinct(std::min(statistics.subjects.distinct,
+                                                            statistics.objects.distinct), true));
+    } else {
+        if (is_s_var) {
+            pattern.variables.emplace_back(s, distinct(statistics.subjects.distinct, is_o_var));
+        }
+        if (is_o_var) {
+            pattern.variables.emplace_back(o, distinct(statistics.objects.distinct, is_s_var));
+        }
+    }
+    if (is_s_var) {
+        pattern.subject = s;
+    }
+    return pattern;
+}
+
+double JoinOptimizer::estimate(const std::vector<std::size_t> &subset) const {
+    // a star whose patterns share nothing but the subject is estimated by the characteristic sets
+    bool star = subset.size() > 1 && !characteristic_sets_.empty();
+    std::unordered_map<std::string, std::vector<double>> distinct;
+    for (const auto &i : subset) {
+        const Pattern &pattern = patterns_[i];
+        star = star && !pattern.subject.empty() && pattern.subject == patterns_[subset.front()].subject;
+        for (const auto &variable : pattern.variables) {
+            distinct[variable.first].emplace_back(variable.second);
+            star = star && (variable.first == pattern.subject || distinct[variable.first].size() == 1);
+        }
+    }
+    if (star) {
+        std::vector<CharacteristicSets::Pattern> star_patterns;
+        for (const auto &i : subset) {
+            star_patterns.emplace_back(patterns_[i].star);
+        }
+        return characteristic_sets_.estimate(star_patterns);
+    }
+
+    // |R1 join .. join Rk| on a variable = |R1| .. |Rk| / (d1 .. dk / min(d1 .. dk)) for its distinct values di
+    double size = 1;
+    for (const auto &i : subset) {
+        size *= patterns_[i].size;
+    }
+    for (const auto &item : distinct) {
+        const auto &values = item.second;
+        for (const auto &value : values) {
+            size /= std::max(value, 1.0);
+        }
+        size *= std::max(*std::min_element(values.begin(), values.end()), 1.0);
+    }
+    return size;
+}
+
+std::vector<std::size_t> JoinOptimizer::order() const {
+    if (patterns_.size() <= 1) {
+        return std::vector<std::size_t>(patterns_.size(), 0);
+    }
+    return patterns_.size() <= DP_LIMIT ? order_by_subsets_() : order_greedily_();
+}
+
+std::vector<std::size_t> JoinOptimizer::order_by_subsets_() const {
+    const std::size_t n = patterns_.size();
+    const std::size_t full = (std::size_t(1) << n) - 1;
+    std::vector<uint32_t> neighbors(n, 0);
+    for (std::size_t a = 0; a < n; ++a) {
+        for (std::size_t b = 0; b < n; ++b) {
+            if (a != b && connected_(a, b)) {
+                neighbors[a] |= uint32_t(1) << b;
+            }
+        }
+    }
+
+    // cost[mask]: least sum of the result sizes of the left-deep orders of mask,
+    // last[mask]: the pattern joined last in that order. A connected mask is only built from connected ones,
+    // so cross products are left to the masks which can't avoid them
+    std::vector<double> cost(full + 1, std::numeric_limits<double>::infinity());
+    std::vector<std::size_t> last(full + 1, 0);
+    std::vector<bool> connected(full + 1, false);
+    std::vector<std::size_t> subset;
+    for (std::size_t mask = 1; mask <= full; ++mask) {
+        subset.clear();
+        for (std::size_t i = 0; i < n; ++i) {
+            if (mask >> i & 1) {
+                subset.emplace_back(i);
+            }
+        }
+        double size = estimate(subset);
+        if (subset.size() == 1) {
+            cost[mask] = size;
+            last[mask] = subset.front();
+            connected[mask] = true;
+            continue;
+        }
+
+        auto joinable = [&](const std::size_t &i) {
+            std::size_t rest = mask & ~(std::size_t(1) << i);
+            return connected[rest] && (neighbors[i] & rest);
+        };
+        connected[mask] = std::any_of(subset.begin(), subset.end(), joinable);
+        bool chosen = false;
+        for (const auto &i : subset) {
+            std::size_t rest = mask & ~(std::size_t(1) << i);
+            if ((connected[mask] && !joinable(i)) || (chosen && cost[rest] + size >= cost[mask])) {
+                continue;
+            }
+            cost[mask] = cost[rest] + size;
+            last[mask] = i;
+            chosen = true;
+        }
+    }
+
+    std::vector<std::size_t> order;
+    for (std::size_t mask = full; mask != 0; mask &= ~(std::size_t(1) << last[mask])) {
+        order.emplace_back(last[mask]);
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+std::vector<std::size_t> JoinOptimizer::order_greedily_() const {
+    const std::size_t n = patterns_.size();
+    std::vector<std::size_t> order;
+    std::vector<bool> used(n, false);
+    while (order.size() < n) {
+        std::vector<std::size_t> subset = order;
+        subset.emplace_back(0);
+
+        std::size_t best = n;
+        double best_size = 0;
+        bool best_connected = false;
+        for (std::size_t i = 0; i < n; ++i) {
+            if (used[i]) {
+                continue;
+            }
+            bool connected = std::any_of(order.begin(), order.end(),
+                                         [this, &i](const std::size_t &j) { return connected_(i, j); });
+            subset.back() = i;
+            double size = estimate(subset);
+            if (best == n || (connected && !best_connected) ||
+                (connected == best_connected && size < best_size)) {
+                best = i;
+                best_size = size;
+                best_connected = connected;
+            }
+        }
+        used[best] = true;
+        order.emplace_back(best);
+    }
+    return order;
+}
+
+bool JoinOptimizer::connected_(const std::size_t &a, const std::size_t &b) const {
+    for (const auto &x : patterns_[a].variables) {
+        for (const auto &y : patterns_[b].variables) {
+            if (x.first == y.first) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,146 @@
+/*
+ * @FileName   : leapfrog_join.cpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: implement `LeapfrogJoin`
+ */
+
+#include "query/leapfrog_join.hpp"
+
+#include <limits>
+#include <algorithm>
+
+namespace inno {
+
+LeapfrogJoin::LeapfrogJoin(std::vector<Atom> atoms, std::vector<uint32_t> order)
+        : atoms_(std::move(atoms)), order_(std::move(order))
+        , keys_(order_.size()), values_(order_.size()) {
+    auto level_of = [this](const uint32_t &slot) {
+        return std::find(order_.begin(), order_.end(), slot) - order_.begin();
+    };
+    for (std::size_t i = 0; i < atoms_.size(); ++i) {
+        if (atoms_[i].index) {
+            keys_[level_of(atoms_[i].key_slot)].emplace_back(i);
+        }
+        values_[level_of(atoms_[i].value_slot)].emplace_back(i);
+    }
+}
+
+BindingTable LeapfrogJoin::join(const BindingTable &input) const {
+    BindingTable result(input.width());
+    join(input, std::numeric_limits<std::size_t>::max(), [&result](const BindingTable &rows) {
+        result = rows;
+        return true;
+    });
+    return result;
+}
+
+bool LeapfrogJoin::join(const BindingTable &input, const std::size_t &batch_size,
+                        const std::function<bool(const BindingTable &)> &emit) const {
+    Output output{BindingTable(input.width()), batch_size, emit};
+    std::vector<uint32_t> row(input.width());
+    for (std::size_t i = 0; i < input.size(); ++i) {
+        std::copy(input.row(i), input.row(i) + input.width(), row.begin());
+        if (!bind_(0, row.data(), 1, output)) {
+            return false;
+        }
+    }
+    return output.rows.empty() || emit(output.rows);
+}
+
+bool LeapfrogJoin::bind_(const std::size_t &level, uint32_t *row, const std::size_t &multiplicity,
+                         Output &output) const {
+    if (level == order_.size()) {
+        for (std::size_t n = multiplicity; n > 0; --n) {
+            output.rows.appendRow(row);
+            if (output.rows.size() >= output.batch_size) {
+                if (!output.emit(output.rows)) {
+                    return false;
+                }
+                output.rows.clear();
+            }
+        }
+        return true;
+    }
+
+    // the candidates of the slot: the keys of the atoms starting at it, and the values of the key bound
+    // for the atoms ending at it. Only the values of an index carry the duplicated pairs
+    const uint32_t slot = order_[level];
+    std::vector<IdSpan> spans;
+    std::vector<bool> counted;
+    for (const auto &i : keys_[level]) {
+        spans.emplace_back(atoms_[i].index->keys());
+        counted.emplace_back(false);
+    }
+    for (const auto &i : values_[level]) {
+        const Atom &atom = atoms_[i];
+        spans.emplace_back(atom.index ? atom.index->get(row[atom.key_slot]) : atom.values);
+        counted.emplace_back(atom.index != nullptr);
+    }
+    if (spans.empty()) {
+        return true;
+    }
+
+    if (row[slot] != BindingTable::UNBOUND) {
+        std::size_t n = multiplicity;
+        for (std::size_t i = 0; i < spans.size() && n > 0; ++i) {
+            std::size_t count = spans[i].count(row[slot]);
+            n = counted[i] ? n * count : (count ? n : 0);
+        }
+        return n == 0 || bind_(level + 1, row, n, output);
+    }
+
+    // leapfrog: every iterator in turn seeks the largest value seen, a value is bound once all of them agree
+    const std::size_t k = spans.size();
+    std::vector<IdSpan::iterator> iters, ends;
+    uint32_t value = 0;
+    for (const auto &span : spans) {
+        iters.emplace_back(span.begin());
+        ends.emplace_back(span.end());
+        if (iters.back() == ends.back()) {
+            return true;
+        }
+        value = std::max(value, *iters.back());
+    }
+
+    for (std::size_t p = 0, agreed = 0;; p = (p + 1) % k) {
+        IdSpan::iterator &iter = iters[p];
+        if (*iter < value) {
+            iter = spans[p].seek(value);
+            if (iter == ends[p]) {
+                return true;
+            }
+        }
+        if (*iter != value) {
+            value = *iter;
+            agreed = 0;
+        }
+        if (++agreed < k) {
+            continue;
+        }
+
+        std::size_t n = multiplicity;
+        for (std::size_t i = 0; i < k; ++i) {
+            if (counted[i]) {
+                std::size_t count = 0;
+                for (IdSpan::iterator same = iters[i]; same != ends[i] && *same == value; ++same) {
+                    ++count;
+                }
+                n *= count;
+            }
+        }
+        row[slot] = value;
+        bool going = bind_(level + 1, row, n, output);
+        row[slot] = BindingTable::UNBOUND;
+        if (!going) {
+            return false;
+        }
+
+        // the ids are less than the max of uint32_t, so the next one can be sought
+        ++value;
+        agreed = 0;
+    }
+}
+
+}
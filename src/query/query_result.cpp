@@ -0,0 +1,39 @@
+/*
+ * @FileName   : query_result.cpp
+ * @CreateAt   : 2026/10/17
+ * @Author     : Inno Fang
+ * @Email      : innofang@yeah.net
+ * @Description: implement `QueryResult`
+ */
+
+#include "query/query_result.hpp"
+
+namespace inno {
+
+QueryResult::QueryResult(std::shared_ptr<DatabaseBuilder::Option> db, std::vector<std::string> variables,
+                         BindingTable rows)
+        : db_(std::move(db)), variables_(std::move(variables)), rows_(std::move(rows)) {}
+
+std::string QueryResult::term(const std::size_t &index, const std::size_t &column) const {
+    uint32_t entity_id = id(index, column);
+    return entity_id == BindingTable::UNBOUND ? "" : db_->getEntityById(entity_id);
+}
+
+ResultSet QueryResult::toResultSet() const {
+    ResultSet result;
+    for (const auto &row : *this) {
+        result.insert(row.terms());
+    }
+    return result;
+}
+
+std::vector<std::string> QueryResult::Row::terms() const {
+    std::vector<std::string> terms;
+    terms.reserve(size());
+    for (std::size_t column = 0; column < size(); ++column) {
+        terms.emplace_back((*this)[column]);
+    }
+    return terms;
+}
+
+}
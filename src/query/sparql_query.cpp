@@ -8,6 +8,7 @@
 
 #include "query/sparql_query.hpp"
 
+#include <map>
 #include <list>
 #include <queue>
 #include <algorithm>
@@ -15,29 +16,42 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <chrono>
+#include <atomic>
+#include <future>
+#include <tuple>
+#include <thread>
 #include <utility>
 
 #include <spdlog/spdlog.h>
 
 #include "common/utils.hpp"
+#include "common/thread_pool.hpp"
+#include "query/join_optimizer.hpp"
+#include "query/leapfrog_join.hpp"
+#include "query/hash_distinct.hpp"
 
 namespace inno {
 
 class SparqlQuery::Impl {
 public:
+    /* consumer of the rows output by a step, which returns false to stop the execution */
+    using Emit = std::function<bool(const TempResult &)>;
+    using Step = std::function<bool(const TempResult &, const Emit &)>;
+    using MorselStep = std::function<void(const size_t &, const size_t &, TempResult &)>;
+
     explicit Impl(std::shared_ptr<DatabaseBuilder::Option> db)
-        : db_(std::move(db)), var_idx_(0), query_time_(0) {
+        : query_time_(0), parallelism_(1), pool_(ThreadPool::Shared()), var_idx_(0), db_(std::move(db)) {
         using namespace std::placeholders;
-        query_selector_.emplace(JOIN_S, std::bind(&SparqlQuery::Impl::join_s_, this, _1, _2));
-        query_selector_.emplace(JOIN_O, std::bind(&SparqlQuery::Impl::join_o_, this, _1, _2));
+        query_selector_.emplace(JOIN_S, std::bind(&SparqlQuery::Impl::join_s_, this, _1, _2, _3));
+        query_selector_.emplace(JOIN_O, std::bind(&SparqlQuery::Impl::join_o_, this, _1, _2, _3));
 
-        query_selector_.emplace(FILTER_S, std::bind(&SparqlQuery::Impl::filter_s_, this, _1, _2));
-        query_selector_.emplace(FILTER_O, std::bind(&SparqlQuery::Impl::filter_o_, this, _1, _2));
-        query_selector_.emplace(FILTER_SO, std::bind(&SparqlQuery::Impl::filter_so_, this, _1, _2));
+        query_selector_.emplace(FILTER_S, std::bind(&SparqlQuery::Impl::filter_s_, this, _1, _2, _3));
+        query_selector_.emplace(FILTER_O, std::bind(&SparqlQuery::Impl::filter_o_, this, _1, _2, _3));
+        query_selector_.emplace(FILTER_SO, std::bind(&SparqlQuery::Impl::filter_so_, this, _1, _2, _3));
 
-        query_selector_.emplace(SINGLE_S, std::bind(&SparqlQuery::Impl::single_query_, this, _1, _2));
-        query_selector_.emplace(SINGLE_O, std::bind(&SparqlQuery::Impl::single_query_, this, _1, _2));
-        query_selector_.emplace(SINGLE_SO, std::bind(&SparqlQuery::Impl::single_query_, this, _1, _2));
+        query_selector_.emplace(SINGLE_S, std::bind(&SparqlQuery::Impl::single_query_, this, _1, _2, _3));
+        query_selector_.emplace(SINGLE_O, std::bind(&SparqlQuery::Impl::single_query_, this, _1, _2, _3));
+        query_selector_.emplace(SINGLE_SO, std::bind(&SparqlQuery::Impl::single_query_, this, _1, _2, _3));
     }
 
     ~Impl() = default;
@@ -49,16 +63,65 @@ public:
         id2var_.clear();
     }
 
-    ResultSet query(SparqlParser &parser) {
+    /* the rows of @parser, without duplicates if it is a DISTINCT query or @distinct is set */
+    QueryResult query(SparqlParser &parser, const bool &distinct = false) {
         initialize();
 
+        // a step keeps the indexes of its predicate while the steps after it read others, which would evict it
+        // from a lazily loaded database, so the whole query reads a snapshot, which pins the predicates it reads
+        struct Restore {
+            std::shared_ptr<DatabaseBuilder::Option> &db;
+            std::shared_ptr<DatabaseBuilder::Option> live;
+            ~Restore() { db = std::move(live); }
+        } restore{db_, db_};
+        if (!db_->isSnapshot()) {
+            db_ = db_->snapshot();
+        }
+
         QueryQueue query_queue = generateQueryPlan(parser);
 
-        TempResult result;
-        std::tie(result, query_time_) =
-                inno::timeit(std::bind(&SparqlQuery::Impl::execute, this, query_queue));
+        QueryResult result;
+        std::tie(result, query_time_) = inno::timeit([&]() {
+            return execute(query_queue, parser.getQueryVariables(), distinct || parser.isDistinctQuery(),
+                           parser.getLimit(), parser.getOffset());
+        });
+        return result;
+    }
+
+    bool remove(SparqlParser &parser) {
+        auto pattern = parser.getDeleteTriplets();
+        if (parser.getQueryVariables().empty()) {
+            // DELETE DATA, or DELETE WHERE with a ground pattern
+            return db_->remove(pattern);
+        }
+
+        QueryResult matches;
+        try {
+            // a triplet is deleted once, however many matches bind it
+            matches = query(parser, true);
+        } catch (const std::out_of_range &) {
+            // a constant of the pattern doesn't exist in the database, so nothing matches
+            return true;
+        }
+
+        const auto &variables = parser.getQueryVariables();
+        auto bind = [&variables](const std::string &term, const QueryResult::Row &row) {
+            if (term[0] != '?') {
+                return term;
+            }
+            return row[std::find(variables.begin(), variables.end(), term) - variables.begin()];
+        };
 
-        return resultMapper(result, parser.getQueryVariables());
+        std::vector<Triplet> triplets;
+        triplets.reserve(matches.size() * pattern.size());
+        for (const auto &row : matches) {
+            for (const auto &triplet : pattern) {
+                triplets.emplace_back(bind(std::get<0>(triplet), row),
+                                      std::get<1>(triplet),
+                                      bind(std::get<2>(triplet), row));
+            }
+        }
+        return triplets.empty() || db_->remove(triplets);
     }
 
     TripletId convert2TripletId(const std::string &s, const std::string &p, const std::string &o) {
@@ -123,51 +186,145 @@ public:
         return { triplet_id, type };
     }
 
-    QueryQueue generateQueryPlan(SparqlParser &parser) {
-        auto triplet_list = parser.getQueryTriplets();
+    QueryItem markAsLeapfrog(const Triplet &triplet, std::unordered_set<std::string> &node_set) {
         std::string s, p, o;
-        uint16_t sid, pid, oid;
-//        if (triplet_list.size() == 1) {
-//            std::tie(s, p, o) = triplet_list.back();
-//
-//            // if predicate is query variables,
-//            if (p[0] == '?') {
-//                spdlog::error("the 1st query triplet without predicate, cannot handle it!");
-//                return  {};
-//            }
-//            bool is_s_var = s[0] == '?';
-//            return { {convert2TripletId(db, s, p, o),
-//                      is_s_var ? QueryType::FILTER_O : QueryType::FILTER_S,
-//                      is_s_var ? sid : oid} };
-//        }
+        std::tie(s, p, o) = triplet;
+
+        query_type type;
+        if (s[0] == '?' && o[0] == '?') {
+            type = query_type::LEAPFROG_SO;
+        } else if (s[0] == '?') {
+            type = query_type::LEAPFROG_S;
+        } else {
+            type = query_type::LEAPFROG_O;
+        }
+        if (s[0] == '?') {
+            node_set.emplace(s);
+        }
+        if (o[0] == '?') {
+            node_set.emplace(o);
+        }
+        spdlog::info("[] LEAPFROG, size: {},  {} {} {}", db_->getPredicateCountBy(p), s, p, o);
+        return { convert2TripletId(s, p, o), type };
+    }
 
-        std::sort(triplet_list.begin(), triplet_list.end(),
-                  [this](const inno::Triplet &a, const inno::Triplet &b) {
-            std::string a_s, a_p, a_o, b_s, b_p, b_o;
-            std::tie(a_s, a_p, a_o) = a;
-            std::tie(b_s, b_p, b_o) = b;
-            uint32_t a_num = db_->getPredicateCountBy(a_p);
-            uint32_t b_num = db_->getPredicateCountBy(b_p);
+    /* the patterns of the cycles of the query graph, whose vertices are the variables and whose edges are
+     * the patterns on two different ones: the edges left after dropping the ones with an end of degree 1
+     * repeatedly, together with the patterns binding one of their variables to a constant.
+     * Empty if the query graph has no cycle */
+    std::vector<size_t> cyclicPatterns(const std::vector<Triplet> &triplet_list) {
+        auto is_edge = [](const Triplet &triplet) {
+            const std::string &s = std::get<0>(triplet);
+            const std::string &o = std::get<2>(triplet);
+            return s[0] == '?' && o[0] == '?' && s != o;
+        };
 
-            if (a_s[0] != '?') a_num = std::min(a_num, db_->getEntityCountBy(a_s));
-            else if (a_o[0] != '?') a_num = std::min(a_num, db_->getEntityCountBy(a_o));
+        std::unordered_map<std::string, size_t> degree;
+        std::vector<bool> dropped(triplet_list.size(), true);
+        for (size_t i = 0; i < triplet_list.size(); ++i) {
+            if (is_edge(triplet_list[i])) {
+                ++degree[std::get<0>(triplet_list[i])];
+                ++degree[std::get<2>(triplet_list[i])];
+                dropped[i] = false;
+            }
+        }
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t i = 0; i < triplet_list.size(); ++i) {
+                if (dropped[i]) {
+                    continue;
+                }
+                size_t &s_degree = degree[std::get<0>(triplet_list[i])];
+                size_t &o_degree = degree[std::get<2>(triplet_list[i])];
+                if (s_degree == 1 || o_degree == 1) {
+                    --s_degree;
+                    --o_degree;
+                    dropped[i] = true;
+                    changed = true;
+                }
+            }
+        }
 
-            if (b_s[0] != '?') b_num = std::min(b_num, db_->getEntityCountBy(b_s));
-            else if (b_o[0] != '?') b_num = std::min(b_num, db_->getEntityCountBy(b_o));
+        std::vector<size_t> cyclic;
+        if (std::all_of(dropped.begin(), dropped.end(), [](const bool &d) { return d; })) {
+            return cyclic;
+        }
+        // the variables of the cycles have degree 2 at least, the other ones have none left
+        auto in_cycle = [&degree](const std::string &term) {
+            auto iter = degree.find(term);
+            return iter != degree.end() && iter->second > 0;
+        };
+        for (size_t i = 0; i < triplet_list.size(); ++i) {
+            const std::string &s = std::get<0>(triplet_list[i]);
+            const std::string &o = std::get<2>(triplet_list[i]);
+            if (!dropped[i] || (in_cycle(s) && o[0] != '?') || (s[0] != '?' && in_cycle(o))) {
+                cyclic.emplace_back(i);
+            }
+        }
+        return cyclic;
+    }
 
-            return  a_num < b_num;
-        });
+    /* order the patterns by the cost-based `JoinOptimizer`, then every pattern is filtered or joined
+     * by the variables bound by the patterns before it. The cycles of the query are joined first and at once
+     * by `LeapfrogJoin`, since the pairwise joins of a cycle grow large before its last pattern closes it */
+    QueryQueue generateQueryPlan(SparqlParser &parser) {
+        auto triplet_list = parser.getQueryTriplets();
+        std::string s, p, o;
+
+        std::vector<JoinOptimizer::Pattern> patterns;
+        patterns.reserve(triplet_list.size());
+        for (const auto &triplet : triplet_list) {
+            std::tie(s, p, o) = triplet;
+            if (p[0] == '?') {
+                spdlog::error("the query triplet({} {} {}) without predicate, cannot handle it!", s, p, o);
+                return {};
+            }
+            patterns.emplace_back(JoinOptimizer::Estimate(*db_, triplet));
+        }
+        JoinOptimizer optimizer(std::move(patterns), db_->getCharacteristicSets());
+        std::vector<size_t> order = optimizer.order();
+        if (order.empty()) {
+            return {};
+        }
 
         // node set contains all query variables
         std::unordered_set<std::string> node_set;
 
         QueryQueue query_queue;
+        std::vector<size_t> cyclic = cyclicPatterns(triplet_list);
+        if (cyclic.empty()) {
+            query_queue.emplace_back(markAsSingle(triplet_list[order.front()], node_set));
+            order.erase(order.begin());
+        } else {
+            for (const auto &i : cyclic) {
+                query_queue.emplace_back(markAsLeapfrog(triplet_list[i], node_set));
+            }
 
-        // if there is only one query triplet, use the above join_or_filter_var_id by default.
-        // But if there are more than one query triplets, when query queue have been chosen the second
-        // query triplet, the value of join_or_filter_var_id of the first query triplet should be updated.
-        query_queue.emplace_back(markAsSingle(triplet_list.front(), node_set));
-        triplet_list.erase(triplet_list.begin());
+            // the other patterns keep their order, except that each one waits for a pattern it is connected to
+            std::vector<size_t> rest;
+            for (const auto &i : order) {
+                if (std::find(cyclic.begin(), cyclic.end(), i) == cyclic.end()) {
+                    rest.emplace_back(i);
+                }
+            }
+            std::unordered_set<std::string> bound = node_set;
+            order.clear();
+            while (!rest.empty()) {
+                auto next = std::find_if(rest.begin(), rest.end(), [&](const size_t &i) {
+                    return bound.count(std::get<0>(triplet_list[i])) || bound.count(std::get<2>(triplet_list[i]));
+                });
+                if (next == rest.end()) {
+                    next = rest.begin();
+                }
+                for (const auto &term : {std::get<0>(triplet_list[*next]), std::get<2>(triplet_list[*next])}) {
+                    if (term[0] == '?') {
+                        bound.emplace(term);
+                    }
+                }
+                order.emplace_back(*next);
+                rest.erase(next);
+            }
+        }
 
         query_type type;
         std::vector<std::string> type_str {
@@ -178,203 +335,268 @@ public:
             "JOIN_O",
         };
 
-        int idx = 1;
-        while (!triplet_list.empty()) {
-            auto curr = triplet_list.begin();
-            size_t old_size = triplet_list.size();
-            while (curr != triplet_list.end()) {
-                bool match = true;
-
-                std::tie(s, p, o) = *curr;
-                std::tie(sid, pid, oid) = convert2TripletId(s, p, o);
-
-                if (p[0] == '?') {
-                    spdlog::error("the query triplet({} {} {}) without predicate, cannot handle it!", s, p, o);
-                    return {};
-                }
-
-                bool is_s_var = s[0] == '?';
-                bool is_o_var = o[0] == '?';
-                bool is_s_in_node_set = is_s_var && node_set.count(s);
-                bool is_o_in_node_set = is_o_var && node_set.count(o);
-
-                if (is_s_var && is_o_var) {
-                    if (is_s_in_node_set && is_o_in_node_set) {
-                        // special case, which have two var to filter.
-                        type = query_type::FILTER_SO;
-                    } else if (is_s_in_node_set) {
-                        type = query_type::JOIN_S;
-                        node_set.emplace(o);
-                    } else if (is_o_in_node_set) {
-                        type = query_type::JOIN_O;
-                        node_set.emplace(s);
-                    } else {
-                        match = false;
-                    }
-                } else if (is_s_var && is_s_in_node_set) {
-                    type = query_type::FILTER_S;
-                } else if (is_o_var && is_o_in_node_set) {
-                    type = query_type::FILTER_O;
+        for (size_t idx = 0; idx < order.size(); ++idx) {
+            const auto &triplet = triplet_list[order[idx]];
+            std::tie(s, p, o) = triplet;
+            bool match = true;
+
+            bool is_s_var = s[0] == '?';
+            bool is_o_var = o[0] == '?';
+            bool is_s_in_node_set = is_s_var && node_set.count(s);
+            bool is_o_in_node_set = is_o_var && node_set.count(o);
+
+            if (is_s_var && is_o_var) {
+                if (is_s_in_node_set && is_o_in_node_set) {
+                    // special case, which have two var to filter.
+                    type = query_type::FILTER_SO;
+                } else if (is_s_in_node_set) {
+                    type = query_type::JOIN_S;
+                    node_set.emplace(o);
+                } else if (is_o_in_node_set) {
+                    type = query_type::JOIN_O;
+                    node_set.emplace(s);
                 } else {
                     match = false;
                 }
-
-                if (match) {
-                    spdlog::info("[{}] {}, size: {},  {} {} {}", idx++, type_str[type], db_->getPredicateCountBy(p), s, p, o);
-                    query_queue.emplace_back(convert2TripletId(s, p, o), type);
-                    triplet_list.erase(curr);
-                    break;
-                } else {
-                    ++curr;
-                }
+            } else if (is_s_var && is_s_in_node_set) {
+                type = query_type::FILTER_S;
+            } else if (is_o_var && is_o_in_node_set) {
+                type = query_type::FILTER_O;
+            } else {
+                match = false;
             }
-            // for the situation of matching nothing for the previous triplets
-//            if (curr == triplet_list.end() && !triplet_list.empty()) {
-            // if the new_size is equal with the old_size, that's mean matches nothing in this turn.
-            size_t new_size = triplet_list.size();
-            if (old_size == new_size) {
-                curr = triplet_list.begin();
-                query_queue.emplace_back(markAsSingle(*curr, node_set));
-                triplet_list.erase(curr);
+
+            if (match) {
+                spdlog::info("[{}] {}, size: {},  {} {} {}", idx, type_str[type], db_->getPredicateCountBy(p), s, p, o);
+                query_queue.emplace_back(convert2TripletId(s, p, o), type);
+            } else {
+                // shares no variable with the patterns before it, so it is a cross product
+                query_queue.emplace_back(markAsSingle(triplet, node_set));
             }
         }
 
         return query_queue;
     }
 
-    TempResult execute(QueryQueue &query_queue) {
-        TempResult result;
-        if (query_queue.empty()) {
-            return result;
+    /* run the steps of @query_queue as a pipeline: every morsel a step outputs is pushed through the steps
+     * after it before the step goes on, so only a morsel per step is alive at a time, and the execution stops
+     * as soon as there are @limit rows after the first @offset ones. The rows are a bag, unless @distinct
+     * drops the duplicated ones by hashing their ids. The rows keep the ids of the query variables,
+     * the terms are decoded by the returned `QueryResult` once they are read */
+    QueryResult execute(QueryQueue &query_queue, const std::vector<std::string> &query_variables,
+                        const bool &distinct = false,
+                        const size_t &limit = SparqlParser::NO_LIMIT, const size_t &offset = 0) {
+        TempResult result(query_variables.size());
+        if (query_queue.empty() || limit == 0) {
+            return {db_, query_variables, std::move(result)};
         }
 
-//        auto query_item = query_queue.front(); query_queue.pop_front();
-//        result = first_query_(query_item);
-
-//        double time = 0;
-//        std::tie( result, time ) = inno::timeit(std::bind(&SparqlQuery::Impl::first_query_, this, query_item));
-//        int idx = 0;
-//        spdlog::info("[{}] result size: {}, used {} ms.", idx++, result.size(), time);
-
+        std::vector<Step> steps;
         while (!query_queue.empty()) {
             auto query_item = query_queue.front(); query_queue.pop_front();
-            result = query_selector_.at(std::get<1>(query_item))(result, query_item);
-            if (result.empty()) {
-                break;
+            if (std::get<1>(query_item) == query_type::FILTER_S) {
+                uint32_t sid = std::get<0>(std::get<0>(query_item));
+                auto po_list = take_filter_s_(query_item, query_queue);
+                steps.emplace_back([this, sid, po_list](const TempResult &temp_result, const Emit &emit) {
+                    return filter_s_group_(temp_result, sid, po_list, emit);
+                });
+            } else if (isLeapfrog(std::get<1>(query_item))) {
+                std::vector<QueryItem> query_items {query_item};
+                while (!query_queue.empty() && isLeapfrog(std::get<1>(query_queue.front()))) {
+                    query_items.emplace_back(query_queue.front());
+                    query_queue.pop_front();
+                }
+                steps.emplace_back([this, query_items](const TempResult &temp_result, const Emit &emit) {
+                    return leapfrog_(temp_result, query_items, emit);
+                });
+            } else {
+                const auto &selected = query_selector_.at(std::get<1>(query_item));
+                steps.emplace_back([&selected, query_item](const TempResult &temp_result, const Emit &emit) {
+                    return selected(temp_result, query_item, emit);
+                });
             }
-
-//           std::tie( result, time ) = inno::timeit( query_selector_.at(std::get<1>(query_item)), result, query_item);
-//            spdlog::info("[{}] result size: {}, used {} ms.", idx++, result.size(), time);
         }
-        return result;
-    }
 
-    ResultSet resultMapper(const TempResult &temp_result, const std::vector<std::string> &query_variables) {
         std::vector<uint16_t> query_ids;
         query_ids.reserve(query_variables.size());
         for (const auto &var : query_variables) {
-            query_ids.emplace_back(var2id_[var]);
-        }
-
-        ResultSet result;
-        for (auto &item : temp_result) {
-//            std::unordered_map<std::string, std::string> result_item;
-            std::vector<std::string> result_item;
-            result_item.reserve(query_ids.size());
-            for (auto &var_id : query_ids) {
-                uint32_t entity_id = item.at(var_id);
-                result_item.emplace_back(db_->getEntityById(entity_id));
-//                result_item.emplace(id2var_[var_id], db_->getEntityById(entity_id));
+            query_ids.emplace_back(var2id_.count(var) ? var2id_[var] : var_idx_);
+        }
+
+        // the ids identify the terms, so DISTINCT tells the rows apart by their ids. The rows skipped by OFFSET
+        // are inserted as well, so that their duplicates are skipped too
+        HashDistinct seen(query_ids.size());
+        size_t skipped = 0;
+        auto accept = [&](const uint32_t *item) {
+            if (skipped < offset) {
+                ++skipped;
+                return true;
             }
-            result.insert(std::move(result_item));
+            std::copy(item, item + query_ids.size(), result.appendRow());
+            return result.size() < limit;
+        };
+        Emit sink = [&](const TempResult &temp_result) {
+            std::vector<uint32_t> item(query_ids.size());
+            for (size_t i = 0; i < temp_result.size(); ++i) {
+                const uint32_t *row = temp_result.row(i);
+                for (size_t column = 0; column < query_ids.size(); ++column) {
+                    item[column] = query_ids[column] < temp_result.width() ? row[query_ids[column]]
+                                                                           : TempResult::UNBOUND;
+                }
+                if (distinct && seen.insert(item.data()) != HashDistinct::NEW) {
+                    continue;
+                }
+                if (!accept(item.data())) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        // start from a single row with all variables unbound,
+        // so that the first query triplet is joined with it as a cartesian product
+        TempResult start(var_idx_);
+        start.appendRow();
+        if (push_(steps, 0, start, sink) && distinct) {
+            // the rows of the partitions spilled by DISTINCT come last
+            seen.finish(accept, pool_.get(), parallelism_);
         }
-        return result;
+        return {db_, query_variables, std::move(result)};
     }
 
-private:
-    using ResultItemType = std::unordered_map<uint32_t, uint32_t>;
+    /* run step @index of @steps on @temp_result, and push its outputs further, false once @sink stopped */
+    bool push_(const std::vector<Step> &steps, const size_t &index, const TempResult &temp_result, const Emit &sink) {
+        if (index == steps.size()) {
+            return sink(temp_result);
+        }
+        return steps[index](temp_result, [&](const TempResult &output) {
+            return push_(steps, index + 1, output, sink);
+        });
+    }
 
 private:
 
-    TempResult
-    single_query_(const TempResult &temp_result, const QueryItem &query_item) {
-        TripletId tripletId;
-        query_type type;
-        std::tie(tripletId, type) = query_item;
+    static bool isLeapfrog(const query_type &type) {
+        return type == query_type::LEAPFROG_S || type == query_type::LEAPFROG_O || type == query_type::LEAPFROG_SO;
+    }
 
+    /* join the patterns of @query_items at once by `LeapfrogJoin`. The variables are bound from the one with the
+     * fewest candidates, then always the one sharing the most patterns with the bound ones */
+    bool
+    leapfrog_(const TempResult &temp_result, const std::vector<QueryItem> &query_items, const Emit &emit) {
         uint32_t sid, pid, oid;
-        std::tie(sid, pid, oid) = tripletId;
-
-//        auto data = db_->getSOByP(pid);
-        auto data = db_->getS2OByP(pid);
-
-        TempResult result;
-        result.reserve(data.size());
-
-        if (type == query_type::SINGLE_S) {
-            for (const auto &item : data) {
-                if (oid == item.second) {
-                    ResultItemType result_item;
-                    result_item.emplace(sid, item.first);
-
-                    if (!temp_result.empty()) {
-                        for (const auto &temp : temp_result) {
-                            result_item.insert(temp.begin(), temp.end());
-                        }
-                    }
-
-                    result.push_back(std::move(result_item));
-                }
+        std::map<uint32_t, size_t> candidates;
+        auto shrink = [&candidates](const uint32_t &slot, const size_t &size) {
+            auto iter = candidates.emplace(slot, size).first;
+            iter->second = std::min(iter->second, size);
+        };
+        for (const auto &query_item : query_items) {
+            std::tie(sid, pid, oid) = std::get<0>(query_item);
+            if (std::get<1>(query_item) == query_type::LEAPFROG_SO) {
+                shrink(sid, db_->getS2OByP(pid).keySize());
+                shrink(oid, db_->getO2SByP(pid).keySize());
+            } else if (std::get<1>(query_item) == query_type::LEAPFROG_S) {
+                shrink(sid, db_->getSByPO(pid, oid).size());
+            } else {
+                shrink(oid, db_->getOBySP(sid, pid).size());
             }
-        } else if (type == query_type::SINGLE_O) {
-            for (const auto &item : data) {
-                if (sid == item.first) {
-                    ResultItemType result_item;
-                    result_item.emplace(oid, item.second);
-
-                    if (!temp_result.empty()) {
-                        for (const auto &temp : temp_result) {
-                            result_item.insert(temp.begin(), temp.end());
-                        }
-                    }
+        }
 
-                    result.push_back(std::move(result_item));
+        std::vector<uint32_t> order;
+        while (order.size() < candidates.size()) {
+            auto is_bound = [&order](const uint32_t &slot) {
+                return std::find(order.begin(), order.end(), slot) != order.end();
+            };
+            uint32_t best = 0;
+            size_t best_links = 0, best_size = 0;
+            bool found = false;
+            for (const auto &item : candidates) {
+                if (is_bound(item.first)) {
+                    continue;
                 }
-            }
-        } else {
-            for (const auto &item : data) {
-                ResultItemType result_item;
-                result_item.emplace(sid, item.first);
-                result_item.emplace(oid, item.second);
-
-                if (!temp_result.empty()) {
-                    for (const auto &temp : temp_result) {
-                        result_item.insert(temp.begin(), temp.end());
+                size_t links = 0;
+                for (const auto &query_item : query_items) {
+                    std::tie(sid, pid, oid) = std::get<0>(query_item);
+                    if (std::get<1>(query_item) == query_type::LEAPFROG_SO &&
+                        ((sid == item.first && is_bound(oid)) || (oid == item.first && is_bound(sid)))) {
+                        ++links;
                     }
                 }
+                if (!found || links > best_links || (links == best_links && item.second < best_size)) {
+                    best = item.first;
+                    best_links = links;
+                    best_size = item.second;
+                    found = true;
+                }
+            }
+            order.emplace_back(best);
+        }
 
-                result.push_back(std::move(result_item));
+        std::vector<LeapfrogJoin::Atom> atoms(query_items.size());
+        for (size_t i = 0; i < query_items.size(); ++i) {
+            std::tie(sid, pid, oid) = std::get<0>(query_items[i]);
+            LeapfrogJoin::Atom &atom = atoms[i];
+            if (std::get<1>(query_items[i]) == query_type::LEAPFROG_S) {
+                atom.values = db_->getSByPO(pid, oid);
+                atom.value_slot = sid;
+            } else if (std::get<1>(query_items[i]) == query_type::LEAPFROG_O) {
+                atom.values = db_->getOBySP(sid, pid);
+                atom.value_slot = oid;
+            } else if (std::find(order.begin(), order.end(), sid) < std::find(order.begin(), order.end(), oid)) {
+                atom.index = &db_->getS2OByP(pid);
+                atom.key_slot = sid;
+                atom.value_slot = oid;
+            } else {
+                atom.index = &db_->getO2SByP(pid);
+                atom.key_slot = oid;
+                atom.value_slot = sid;
             }
         }
+        return LeapfrogJoin(std::move(atoms), std::move(order)).join(temp_result, MORSEL_SIZE, emit);
+    }
 
-//        for (const auto &item : data) {
-//            ResultItemType result_item;
-//            if (type == QueryType::SINGLE_S && oid == item.second) {
-//                result_item.emplace(sid, item.first);
-//            } else if (type == QueryType::SINGLE_O && sid == item.first) {
-//                result_item.emplace(oid, item.second);
-//            } else {
-//                result_item.emplace(sid, item.first);
-//                result_item.emplace(oid, item.second);
-//            }
-//            result.push_back(std::move(result_item));
-//        }
+    bool
+    single_query_(const TempResult &temp_result, const QueryItem &query_item, const Emit &emit) {
+        TripletId tripletId;
+        query_type type;
+        std::tie(tripletId, type) = query_item;
 
-        return result;
+        uint32_t sid, pid, oid;
+        std::tie(sid, pid, oid) = tripletId;
+
+        // the matches of this query triplet are combined with every previous row,
+        // the scan is split over the pairs of <previous row, id> so that a single row is split as well
+        if (type == query_type::SINGLE_S || type == query_type::SINGLE_O) {
+            IdSpan span = type == query_type::SINGLE_S ? db_->getSByPO(pid, oid) : db_->getOBySP(sid, pid);
+            std::vector<uint32_t> ids(span.begin(), span.end());
+            uint32_t slot = type == query_type::SINGLE_S ? sid : oid;
+            return morsels_(temp_result.width(), temp_result.size() * ids.size(),
+                            [&](const size_t &begin, const size_t &end, TempResult &result) {
+                result.reserve(end - begin);
+                for (size_t k = begin; k < end; ++k) {
+                    result.appendRow(temp_result.row(k / ids.size()))[slot] = ids[k % ids.size()];
+                }
+            }, emit);
+        }
+
+        const auto &data = db_->getS2OByP(pid);
+        IdSpan key_span = data.keys();
+        std::vector<uint32_t> keys(key_span.begin(), key_span.end());
+        return morsels_(temp_result.width(), temp_result.size() * keys.size(),
+                        [&](const size_t &begin, const size_t &end, TempResult &result) {
+            for (size_t k = begin; k < end; ++k) {
+                uint32_t subject = keys[k % keys.size()];
+                for (const auto &object : data.get(subject)) {
+                    uint32_t *row = result.appendRow(temp_result.row(k / keys.size()));
+                    row[sid] = subject;
+                    row[oid] = object;
+                }
+            }
+        }, emit);
     }
 
-    TempResult
-    join_s_(const TempResult &temp_result, const QueryItem &query_item) {
+    bool
+    join_s_(const TempResult &temp_result, const QueryItem &query_item, const Emit &emit) {
         TripletId tripletId;
         query_type type;
         std::tie(tripletId, type) = query_item;
@@ -382,68 +604,122 @@ private:
         uint32_t sid, pid, oid;
         std::tie(sid, pid, oid) = tripletId;
 
-        auto data = db_->getS2OByP(pid);
+        const auto &data = db_->getS2OByP(pid);
 
-
-        TempResult result;
-        result.reserve(temp_result.size());
-        for (const auto &item : temp_result) {
-            auto range = data.equal_range(item.at(sid));
-            for (auto it = range.first; it != range.second; ++it) {
-                ResultItemType result_item = item;
-                result_item.emplace(oid, it->second);
-                result.emplace_back(std::move(result_item));
+        return morsels_(temp_result.width(), temp_result.size(),
+                        [&](const size_t &begin, const size_t &end, TempResult &result) {
+            result.reserve(end - begin);
+            for (size_t i = begin; i < end; ++i) {
+                const uint32_t *item = temp_result.row(i);
+                for (const auto &object : data.get(item[sid])) {
+                    result.appendRow(item)[oid] = object;
+                }
             }
-        }
-
-        return result;
+        }, emit);
     }
 
-    TempResult
-    join_o_(const TempResult &temp_result, const QueryItem &query_item) {
+    bool
+    join_o_(const TempResult &temp_result, const QueryItem &query_item, const Emit &emit) {
         TripletId tripletId;
         query_type type;
         std::tie(tripletId, type) = query_item;
 
         uint32_t sid, pid, oid;
         std::tie(sid, pid, oid) = tripletId;
-        auto data = db_->getO2SByP(pid);
-
-        TempResult result;
-        result.reserve(temp_result.size());
-        for (const auto &item : temp_result) {
-            auto range = data.equal_range(item.at(oid));
-            for (auto it = range.first; it != range.second; ++it) {
-                ResultItemType result_item = item;
-                result_item.emplace(sid, it->second);
-                result.emplace_back(result_item);
+        const auto &data = db_->getO2SByP(pid);
+
+        return morsels_(temp_result.width(), temp_result.size(),
+                        [&](const size_t &begin, const size_t &end, TempResult &result) {
+            result.reserve(end - begin);
+            for (size_t i = begin; i < end; ++i) {
+                const uint32_t *item = temp_result.row(i);
+                for (const auto &subject : data.get(item[oid])) {
+                    result.appendRow(item)[sid] = subject;
+                }
             }
-        }
-        return result;
+        }, emit);
     }
 
-    TempResult
-    filter_s_(const TempResult &temp_result, const QueryItem &query_item) {
+    bool
+    filter_s_(const TempResult &temp_result, const QueryItem &query_item, const Emit &emit) {
         TripletId tripletId;
         query_type type;
         std::tie(tripletId, type) = query_item;
 
         uint32_t sid, pid, oid;
         std::tie(sid, pid, oid) = tripletId;
-        auto data = db_->getSByPO(pid, oid);
+        return filter_s_group_(temp_result, sid, {{pid, oid}}, emit);
+    }
 
-        TempResult result;
-        result.reserve(temp_result.size());
-        for (const auto &item : temp_result) {
-            if (data.count(item.at(sid))) {
-               result.emplace_back(item);
+    /* take @query_item and the later FILTER_S items on the same subject variable out of @query_queue,
+     * the variable is bound already, so these filters can run before the query items between them */
+    std::vector<std::pair<uint32_t, uint32_t>>
+    take_filter_s_(const QueryItem &query_item, QueryQueue &query_queue) {
+        uint32_t sid = std::get<0>(std::get<0>(query_item));
+        std::vector<std::pair<uint32_t, uint32_t>> po_list {
+            {std::get<1>(std::get<0>(query_item)), std::get<2>(std::get<0>(query_item))}
+        };
+        for (auto iter = query_queue.begin(); iter != query_queue.end();) {
+            const TripletId &triplet_id = std::get<0>(*iter);
+            if (std::get<1>(*iter) == query_type::FILTER_S && std::get<0>(triplet_id) == sid) {
+                po_list.emplace_back(std::get<1>(triplet_id), std::get<2>(triplet_id));
+                iter = query_queue.erase(iter);
+            } else {
+                ++iter;
             }
         }
-        return result;
+        return po_list;
+    }
+
+    /* keep the rows whose @sid has every <predicate, object> of @po_list,
+     * the subject lists are intersected as bitmaps first when there are several of them */
+    bool
+    filter_s_group_(const TempResult &temp_result, const uint32_t &sid,
+                    const std::vector<std::pair<uint32_t, uint32_t>> &po_list, const Emit &emit) {
+        const RoaringBitmap *bitmap = db_->getSBitmapByPO(po_list[0].first, po_list[0].second);
+        if (po_list.size() == 1 && !bitmap) {
+            IdSpan subjects = db_->getSByPO(po_list[0].first, po_list[0].second);
+            return filter_(temp_result, [&](const uint32_t *item) {
+                return static_cast<size_t>(subjects.contains(item[sid]));
+            }, emit);
+        }
+
+        // low degree objects have no stored bitmap, build one from their subject list
+        std::vector<RoaringBitmap> built;
+        built.reserve(po_list.size());
+        std::vector<const RoaringBitmap *> bitmaps;
+        for (const auto &po : po_list) {
+            bitmap = db_->getSBitmapByPO(po.first, po.second);
+            if (!bitmap) {
+                IdSpan subjects = db_->getSByPO(po.first, po.second);
+                built.emplace_back(RoaringBitmap::FromSorted(subjects.begin(), subjects.end()));
+                bitmap = &built.back();
+            }
+            bitmaps.emplace_back(bitmap);
+        }
+
+        // intersect from the smallest bitmap, so that the intermediate bitmaps stay small
+        std::sort(bitmaps.begin(), bitmaps.end(), [](const RoaringBitmap *a, const RoaringBitmap *b) {
+            return a->cardinality() < b->cardinality();
+        });
+        RoaringBitmap intersection;
+        if (bitmaps.size() > 1) {
+            intersection = *bitmaps[0] & *bitmaps[1];
+            for (size_t i = 2; i < bitmaps.size() && !intersection.empty(); ++i) {
+                intersection &= *bitmaps[i];
+            }
+            bitmap = &intersection;
+        } else {
+            bitmap = bitmaps[0];
+        }
+
+        return filter_(temp_result, [&](const uint32_t *item) {
+            return static_cast<size_t>(bitmap->contains(item[sid]));
+        }, emit);
     }
 
-    TempResult
-    filter_o_(const TempResult &temp_result, const QueryItem &query_item) {
+    bool
+    filter_o_(const TempResult &temp_result, const QueryItem &query_item, const Emit &emit) {
         TripletId tripletId;
         query_type type;
         std::tie(tripletId, type) = query_item;
@@ -452,81 +728,135 @@ private:
         std::tie(sid, pid, oid) = tripletId;
         auto data = db_->getOBySP(sid, pid);
 
-        TempResult result;
-        result.reserve(temp_result.size());
-        for (const auto &item : temp_result) {
-            if (data.count(item.at(oid))) {
-                result.emplace_back(item);
-            }
-        }
-        return result;
+        return filter_(temp_result, [&](const uint32_t *item) {
+            return static_cast<size_t>(data.contains(item[oid]));
+        }, emit);
     }
 
-    TempResult
-    filter_so_(const TempResult &temp_result, const QueryItem &query_item) {
+    bool
+    filter_so_(const TempResult &temp_result, const QueryItem &query_item, const Emit &emit) {
         TripletId tripletId;
         query_type type;
         std::tie(tripletId, type) = query_item;
 
         uint32_t sid, pid, oid;
         std::tie(sid, pid, oid) = tripletId;
-//        auto data = db_->getSOByP(pid);
 
-        ///////////
+        const auto &data = db_->getS2OByP(pid);
 
+        // the objects of a subject are sorted, so the duplicated pairs are found by one seek
+        return filter_(temp_result, [&](const uint32_t *item) {
+            return data.get(item[sid]).count(item[oid]);
+        }, emit);
+    }
 
-        auto data = db_->getS2OByP(pid);
+    /* keep every row of @temp_result as many times as @times(row) says */
+    bool
+    filter_(const TempResult &temp_result, const std::function<size_t(const uint32_t *)> &times, const Emit &emit) {
+        return morsels_(temp_result.width(), temp_result.size(),
+                        [&](const size_t &begin, const size_t &end, TempResult &result) {
+            result.reserve(end - begin);
+            for (size_t i = begin; i < end; ++i) {
+                const uint32_t *item = temp_result.row(i);
+                for (size_t n = times(item); n > 0; --n) {
+                    result.appendRow(item);
+                }
+            }
+        }, emit);
+    }
 
-        TempResult result;
-        result.reserve(temp_result.size());
-        for (const auto &item : temp_result) {
-            auto range = data.equal_range(item.at(sid));
-            for (auto it = range.first; it != range.second; ++it) {
-                if (it->second == item.at(oid)) {
-                    result.emplace_back(item);
+    /* run @step(begin, end, output), which appends the rows made from the inputs [begin, end) of a step to
+     * output, over the @size inputs a morsel of `MORSEL_SIZE` inputs at a time, and hand every output to @emit
+     * in the order of the morsels until it returns false. With a parallelism above 1 the workers of the pool
+     * take the morsels of a wave one at a time, each morsel into its own buffer, so the rows come out in the
+     * same order as on one thread. The indexes are resolved before, @step only reads them */
+    bool
+    morsels_(const size_t &width, const size_t &size, const MorselStep &step, const Emit &emit) {
+        const size_t morsel_num = (size + MORSEL_SIZE - 1) / MORSEL_SIZE;
+        if (parallelism_ <= 1 || morsel_num <= 1) {
+            for (size_t begin = 0; begin < size; begin += MORSEL_SIZE) {
+                TempResult output(width);
+                step(begin, std::min(size, begin + MORSEL_SIZE), output);
+                if (!output.empty() && !emit(output)) {
+                    return false;
                 }
-//                ResultItemType result_item(item.begin(), item.end());
-//                result_item.emplace(std::get<2>(tripletId), it->second);
-//                result.push_back(std::move(result_item));
             }
+            return true;
         }
-        return result;
-        //////////
-
-//        TempResult result;
-//        result.reserve(temp_result.size());
-//        for (const auto &item : temp_result) {
-//            if (data.count({item.at(sid), item.at(oid)})) {
-//                result.emplace_back(item);
-//            }
-//        }
-//        return result;
+
+        // the outputs of a wave are pushed on before the next wave starts, so that a LIMIT stops the scan early
+        const size_t wave = parallelism_ * WAVE_MORSELS;
+        for (size_t first = 0; first < morsel_num; first += wave) {
+            const size_t last = std::min(morsel_num, first + wave);
+            std::vector<TempResult> outputs(last - first, TempResult(width));
+            std::atomic<size_t> next(first);
+            auto work = [&]() {
+                for (size_t morsel = next++; morsel < last; morsel = next++) {
+                    step(morsel * MORSEL_SIZE, std::min(size, (morsel + 1) * MORSEL_SIZE), outputs[morsel - first]);
+                }
+            };
+            std::vector<std::future<void>> tasks;
+            for (size_t i = 1; i < std::min(parallelism_, last - first); ++i) {
+                tasks.emplace_back(pool_->submit(work));
+            }
+            work();
+            for (auto &task : tasks) {
+                pool_->wait(task);
+            }
+
+            for (const auto &output : outputs) {
+                if (!output.empty() && !emit(output)) {
+                    return false;
+                }
+            }
+        }
+        return true;
     }
 
 public:
+    static const size_t MORSEL_SIZE = 4096;
+    static const size_t WAVE_MORSELS = 4;     // morsels of a wave per thread
+
     double query_time_;
+    size_t parallelism_;
 
 private:
+    std::shared_ptr<ThreadPool> pool_;
     uint8_t var_idx_;
     std::unordered_map<uint16_t, std::string> id2var_;
     std::unordered_map<std::string, uint16_t> var2id_;
-    std::unordered_map<query_type, std::function<TempResult(TempResult const&, QueryItem const&)>> query_selector_;
+    std::unordered_map<query_type, std::function<bool(TempResult const&, QueryItem const&, Emit const&)>> query_selector_;
     std::shared_ptr<DatabaseBuilder::Option> db_;
 };
 
+const size_t SparqlQuery::Impl::MORSEL_SIZE;
+const size_t SparqlQuery::Impl::WAVE_MORSELS;
+
 SparqlQuery::SparqlQuery(const std::shared_ptr<DatabaseBuilder::Option> &db) : impl_(new Impl(db)) { }
 
 SparqlQuery::~SparqlQuery() { }
 
 //ResultSet<std::string, std::string>
 //std::vector<std::unordered_map<std::string, std::string>>
-inno::ResultSet
+inno::QueryResult
 SparqlQuery::query(SparqlParser &parser) {
     return impl_->query(parser);
 }
 
+bool SparqlQuery::remove(SparqlParser &parser) {
+    return impl_->remove(parser);
+}
+
 double SparqlQuery::getQueryTime() const {
     return impl_->query_time_;
 }
 
+void SparqlQuery::setParallelism(std::size_t parallelism) {
+    impl_->parallelism_ = parallelism == 0 ? std::max(1u, std::thread::hardware_concurrency()) : parallelism;
+}
+
+std::size_t SparqlQuery::getParallelism() const {
+    return impl_->parallelism_;
+}
+
 }
\ No newline at end of file
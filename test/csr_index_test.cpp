@@ -0,0 +1,250 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include "database/csr_index.hpp"
+
+namespace test {
+
+namespace fs = boost::filesystem;
+
+class CsrIndexTest : public testing::Test {
+protected:
+    std::vector<std::pair<uint32_t, uint32_t>> pairs_ {
+            {3, 7}, {1, 2}, {3, 5}, {1, 4}, {9, 1},
+    };
+};
+
+TEST_F(CsrIndexTest, RangeLookup) {
+    auto index = inno::CsrIndex::Build(pairs_);
+    EXPECT_EQ(5, index.size());
+    EXPECT_EQ(3, index.keySize());
+
+    auto objects = index.get(3);
+    EXPECT_EQ((std::vector<uint32_t>{5, 7}), std::vector<uint32_t>(objects.begin(), objects.end()));
+    EXPECT_TRUE(index.get(2).empty());
+    EXPECT_TRUE(index.contains(9, 1));
+    EXPECT_FALSE(index.contains(9, 2));
+
+    std::vector<std::pair<uint32_t, uint32_t>> expect {
+            {1, 2}, {1, 4}, {3, 5}, {3, 7}, {9, 1},
+    };
+    EXPECT_EQ(expect, index.pairs());
+}
+
+TEST_F(CsrIndexTest, SaveAndLoad) {
+    fs::path path = fs::temp_directory_path() / fs::unique_path();
+    auto index = inno::CsrIndex::Build(pairs_);
+    ASSERT_TRUE(index.save(path.string()));
+    EXPECT_EQ(inno::CsrIndex::CurrentFileVersion(), inno::CsrIndex::FileVersion(path.string()));
+
+    {
+        inno::CsrIndex loaded;
+        ASSERT_TRUE(inno::CsrIndex::Load(path.string(), loaded));
+        EXPECT_EQ(index.pairs(), loaded.pairs());
+        EXPECT_EQ(2, loaded.get(1).size());
+    }
+    fs::remove(path);
+}
+
+TEST_F(CsrIndexTest, StreamingWriter) {
+    fs::path path = fs::temp_directory_path() / fs::unique_path();
+    auto index = inno::CsrIndex::Build(pairs_);
+    {
+        inno::CsrIndex::Writer writer(path.string());
+        for (const auto &kv : index) {
+            writer.append(kv.first, kv.second);
+        }
+        ASSERT_TRUE(writer.close());
+    }
+
+    {
+        inno::CsrIndex loaded;
+        ASSERT_TRUE(inno::CsrIndex::Load(path.string(), loaded));
+        EXPECT_EQ(index.pairs(), loaded.pairs());
+        EXPECT_EQ(3, loaded.keySize());
+    }
+    fs::remove(path);
+}
+
+TEST_F(CsrIndexTest, SeekInLongList) {
+    // a list spanning several blocks, every even value appears twice
+    std::vector<std::pair<uint32_t, uint32_t>> pairs {{1, 3}, {5, 1}};
+    for (uint32_t value = 0; value < 1000; value += 2) {
+        pairs.emplace_back(2, value * 300);
+        pairs.emplace_back(2, value * 300);
+        pairs.emplace_back(2, (value + 1) * 300);
+    }
+    auto index = inno::CsrIndex::Build(pairs);
+    EXPECT_EQ(pairs.size(), index.size());
+    EXPECT_EQ(pairs, index.pairs());
+
+    auto values = index.get(2);
+    EXPECT_EQ(1500, values.size());
+    EXPECT_EQ(2, values.count(0));
+    EXPECT_EQ(2, values.count(998 * 300));
+    EXPECT_EQ(1, values.count(999 * 300));
+    EXPECT_EQ(0, values.count(999 * 300 + 1));
+    EXPECT_EQ(600, *values.seek(599));
+    EXPECT_EQ(values.end(), values.seek(999 * 300 + 1));
+    EXPECT_TRUE(index.contains(5, 1));
+}
+
+TEST_F(CsrIndexTest, HighDegreeBitmap) {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs {{1, 3}};
+    for (uint32_t value = 0; value < inno::CsrIndex::BITMAP_MIN_SIZE; ++value) {
+        pairs.emplace_back(2, value * 5);
+    }
+    auto index = inno::CsrIndex::Build(pairs);
+    EXPECT_EQ(nullptr, index.bitmap(1));
+    ASSERT_NE(nullptr, index.bitmap(2));
+    EXPECT_EQ(inno::CsrIndex::BITMAP_MIN_SIZE, index.bitmap(2)->cardinality());
+    EXPECT_TRUE(index.contains(2, 10));
+    EXPECT_FALSE(index.contains(2, 11));
+}
+
+TEST_F(CsrIndexTest, BitmapsAreBuiltOnDemand) {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    for (uint32_t value = 0; value < inno::CsrIndex::BITMAP_MIN_SIZE; ++value) {
+        pairs.emplace_back(2, value);
+    }
+    auto index = inno::CsrIndex::Build(pairs);
+    std::size_t usage = index.memoryUsage();
+
+    // the copies share the bitmaps, which are built once by whichever copy asks first
+    auto copy = index;
+    const inno::RoaringBitmap *bitmaps[2] = {nullptr, nullptr};
+    std::thread first([&]() { bitmaps[0] = index.bitmap(2); });
+    std::thread second([&]() { bitmaps[1] = copy.bitmap(2); });
+    first.join();
+    second.join();
+    ASSERT_NE(nullptr, bitmaps[0]);
+    EXPECT_EQ(bitmaps[0], bitmaps[1]);
+    EXPECT_GT(index.memoryUsage(), usage);
+    EXPECT_EQ(index.memoryUsage(), copy.memoryUsage());
+}
+
+TEST_F(CsrIndexTest, LoadVersion2) {
+    // version 2 stores plain values, which are used as they are and compressed when saved again
+    fs::path path = fs::temp_directory_path() / fs::unique_path();
+    {
+        fs::ofstream out(path, fs::ofstream::out | fs::ofstream::binary);
+        uint32_t header[4] = {0, 2, 5, 0};
+        std::memcpy(header, "PSOT", 4);
+        uint64_t key_count = 3;
+        uint32_t arrays[] = {1, 3, 9, 0, 2, 4, 5, 2, 4, 5, 7, 1};
+        out.write(reinterpret_cast<const char *>(header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(&key_count), sizeof(key_count));
+        out.write(reinterpret_cast<const char *>(arrays), sizeof(arrays));
+    }
+    EXPECT_EQ(2, inno::CsrIndex::FileVersion(path.string()));
+
+    auto index = inno::CsrIndex::Build(pairs_);
+    {
+        inno::CsrIndex loaded;
+        ASSERT_TRUE(inno::CsrIndex::Load(path.string(), loaded));
+        EXPECT_EQ(index.pairs(), loaded.pairs());
+        EXPECT_TRUE(loaded.contains(3, 7));
+        ASSERT_TRUE(loaded.save(path.string()));
+    }
+    EXPECT_EQ(inno::CsrIndex::CurrentFileVersion(), inno::CsrIndex::FileVersion(path.string()));
+    {
+        inno::CsrIndex loaded;
+        ASSERT_TRUE(inno::CsrIndex::Load(path.string(), loaded));
+        EXPECT_EQ(index.pairs(), loaded.pairs());
+    }
+    fs::remove(path);
+}
+
+TEST_F(CsrIndexTest, RemoveHidesPairs) {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs {{1, 2}, {1, 2}, {1, 4}, {9, 1}};
+    for (uint32_t value = 0; value < 200; ++value) {
+        pairs.emplace_back(3, value);
+    }
+    auto index = inno::CsrIndex::Build(pairs);
+    auto copy = index;
+    EXPECT_TRUE(index.sharesState(copy));
+
+    EXPECT_EQ(4, index.remove({{1, 2}, {9, 1}, {3, 70}, {3, 999}}));
+    EXPECT_FALSE(index.sharesState(copy));
+    EXPECT_EQ(200, index.size());
+    EXPECT_EQ(4, index.tombstoneSize());
+    EXPECT_EQ(204, copy.size());
+
+    EXPECT_EQ(0, index.get(1).count(2));
+    EXPECT_EQ(1, index.get(1).size());
+    EXPECT_TRUE(index.get(9).empty());
+    EXPECT_FALSE(index.contains(3, 70));
+    EXPECT_EQ(71, *index.get(3).seek(70));
+    EXPECT_EQ(nullptr, index.bitmap(3));
+
+    // the keys left without values are skipped by the iteration
+    auto remained = index.pairs();
+    EXPECT_EQ(200, remained.size());
+    EXPECT_EQ(std::make_pair(1u, 4u), remained.front());
+    EXPECT_EQ(std::make_pair(3u, 199u), remained.back());
+
+    fs::path path = fs::temp_directory_path() / fs::unique_path();
+    ASSERT_TRUE(index.save(path.string()));
+    inno::CsrIndex loaded;
+    ASSERT_TRUE(inno::CsrIndex::Load(path.string(), loaded));
+    EXPECT_EQ(remained, loaded.pairs());
+    EXPECT_EQ(0, loaded.tombstoneSize());
+    fs::remove(path);
+}
+
+TEST_F(CsrIndexTest, InsertOverlaysPairs) {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs {{1, 2}, {1, 4}, {9, 1}};
+    for (uint32_t value = 0; value < 200; value += 2) {
+        pairs.emplace_back(3, value);
+    }
+    auto index = inno::CsrIndex::Build(pairs);
+    auto copy = index;
+
+    EXPECT_EQ(4, index.insert({{3, 71}, {5, 8}, {1, 3}, {5, 6}}));
+    EXPECT_FALSE(index.sharesState(copy));
+    EXPECT_EQ(4, index.deltaSize());
+    EXPECT_EQ(107, index.size());
+    EXPECT_EQ(4, index.keySize());
+    EXPECT_EQ(103, copy.size());
+
+    auto keys = index.keys();
+    EXPECT_EQ((std::vector<uint32_t>{1, 3, 5, 9}), std::vector<uint32_t>(keys.begin(), keys.end()));
+    auto objects = index.get(1);
+    EXPECT_EQ((std::vector<uint32_t>{2, 3, 4}), std::vector<uint32_t>(objects.begin(), objects.end()));
+    EXPECT_EQ(2, index.get(5).size());
+    EXPECT_TRUE(index.contains(5, 6));
+    EXPECT_EQ(71, *index.get(3).seek(71));
+    EXPECT_EQ(72, *index.get(3).seek(72));
+    EXPECT_EQ(3, index.get(3).count(70) + index.get(3).count(71) + index.get(3).count(72));
+    EXPECT_FALSE(copy.contains(3, 71));
+
+    // a tombstone hides the inserted values too, inserting a tombstoned pair again rebuilds the index
+    EXPECT_EQ(1, index.remove({{5, 8}}));
+    EXPECT_EQ(1, index.get(5).size());
+    EXPECT_EQ(1, index.insert({{5, 8}}));
+    EXPECT_EQ(0, index.deltaSize());
+    EXPECT_EQ(0, index.tombstoneSize());
+    EXPECT_EQ(2, index.get(5).size());
+
+    EXPECT_EQ(1, index.insert({{0, 1}}));
+    auto inserted = index.pairs();
+    EXPECT_EQ(108, inserted.size());
+    EXPECT_EQ(std::make_pair(0u, 1u), inserted.front());
+    EXPECT_TRUE(std::is_sorted(inserted.begin(), inserted.end()));
+
+    fs::path path = fs::temp_directory_path() / fs::unique_path();
+    ASSERT_TRUE(index.save(path.string()));
+    inno::CsrIndex loaded;
+    ASSERT_TRUE(inno::CsrIndex::Load(path.string(), loaded));
+    EXPECT_EQ(inserted, loaded.pairs());
+    EXPECT_EQ(0, loaded.deltaSize());
+    fs::remove(path);
+}
+
+} // namespace test
@@ -0,0 +1,705 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include "database/database.hpp"
+#include "parser/sparql_parser.hpp"
+#include "query/sparql_query.hpp"
+
+namespace test {
+
+namespace fs = boost::filesystem;
+
+class DatabaseTest : public testing::Test {
+protected:
+    void SetUp() override {
+        old_path_ = fs::current_path();
+        work_path_ = fs::temp_directory_path() / fs::unique_path();
+        fs::create_directories(work_path_);
+        fs::current_path(work_path_);
+
+        fs::ofstream out(work_path_ / "data.nt");
+        for (int s = 0; s < 20; ++s) {
+            for (int p = 0; p < 4; ++p) {
+                out << "<s" << s << "> <p" << p << "> <o" << (s * 3 + p) % 7 << "> .\n";
+            }
+        }
+        out.close();
+        inno::DatabaseBuilder::Create("test", (work_path_ / "data.nt").string());
+    }
+
+    void TearDown() override {
+        fs::current_path(old_path_);
+        fs::remove_all(work_path_);
+    }
+
+    static std::vector<uint32_t> objects(const std::shared_ptr<inno::DatabaseBuilder::Option> &db,
+                                         const std::string &s, const std::string &p) {
+        auto span = db->getOBySP(db->getEntityId(s), db->getPredicateId(p));
+        return {span.begin(), span.end()};
+    }
+
+    fs::path old_path_;
+    fs::path work_path_;
+};
+
+TEST_F(DatabaseTest, ParallelLoadMatchesSequential) {
+    // several 64 KiB chunks, whose bounds fall on comments and CRLF lines, and no newline at the end
+    fs::path data_path = work_path_ / "chunked.nt";
+    {
+        fs::ofstream out(data_path, fs::ofstream::out | fs::ofstream::binary);
+        for (int line = 0; line < 12000; ++line) {
+            if (line % 97 == 0) {
+                out << "# comment " << line << "\n";
+            }
+            out << "<subject" << line % 1500 << "> <predicate" << line % 5 << "> <object" << line % 701 << "> ."
+                << (line % 3 == 0 ? "\r\n" : "\n");
+        }
+        out << "<last> <predicate0> \"last object\" .";
+    }
+    ASSERT_LT(4 << 16, fs::file_size(data_path));
+
+    auto sequential = inno::DatabaseBuilder::Create("sequential", data_path.string(), 1);
+    auto parallel = inno::DatabaseBuilder::Create("parallel", data_path.string(), 4);
+    ASSERT_EQ(12001, sequential->getTripletSize());
+    ASSERT_EQ(sequential->getTripletSize(), parallel->getTripletSize());
+    ASSERT_EQ(sequential->getPredicateSize(), parallel->getPredicateSize());
+    ASSERT_EQ(sequential->getEntitySize(), parallel->getEntitySize());
+    // 1500 subjects, 701 objects, <last> and "last object", none of them keeps a '\r'
+    EXPECT_EQ(2203, sequential->getEntitySize());
+    EXPECT_EQ(1, sequential->getEntityCountBy("\"last object\""));
+    EXPECT_EQ(18, sequential->getEntityCountBy("<object0>"));
+
+    for (uint32_t id = 1; id <= sequential->getEntitySize(); ++id) {
+        EXPECT_EQ(sequential->getEntityById(id), parallel->getEntityById(id));
+    }
+    for (uint32_t pid = 1; pid <= sequential->getPredicateSize(); ++pid) {
+        EXPECT_EQ(sequential->getPredicateById(pid), parallel->getPredicateById(pid));
+        EXPECT_EQ(sequential->getS2OByP(pid).pairs(), parallel->getS2OByP(pid).pairs());
+        EXPECT_EQ(sequential->getO2SByP(pid).pairs(), parallel->getO2SByP(pid).pairs());
+    }
+
+    // the stored files are identical as well
+    for (fs::recursive_directory_iterator iter(work_path_ / "sequential.db"), end; iter != end; ++iter) {
+        if (!fs::is_regular_file(iter->path())) {
+            continue;
+        }
+        fs::path other = work_path_ / "parallel.db" / fs::relative(iter->path(), work_path_ / "sequential.db");
+        ASSERT_TRUE(fs::exists(other)) << other;
+        ASSERT_EQ(fs::file_size(iter->path()), fs::file_size(other)) << other;
+        fs::ifstream lhs(iter->path(), fs::ifstream::binary), rhs(other, fs::ifstream::binary);
+        EXPECT_TRUE(std::equal(std::istreambuf_iterator<char>(lhs), std::istreambuf_iterator<char>(),
+                               std::istreambuf_iterator<char>(rhs))) << iter->path();
+    }
+}
+
+TEST_F(DatabaseTest, FailedExternalInsertionRemovesItsRuns) {
+    // the first run cannot be written where a directory takes its name
+    fs::path run_dir = work_path_ / "external.db" / "tmp_runs";
+    fs::create_directories(run_dir / "0.spo");
+    inno::DatabaseBuilder::Create("external", (work_path_ / "data.nt").string(), 1, 1 << 20);
+    EXPECT_FALSE(fs::exists(run_dir));
+}
+
+TEST_F(DatabaseTest, LazyLoadMatchesLoadAll) {
+    auto all = inno::DatabaseBuilder::LoadAll("test");
+    // a budget of 0 byte keeps only the predicate being accessed
+    auto lazy = inno::DatabaseBuilder::LoadLazy("test", 0);
+    for (int round = 0; round < 2; ++round) {
+        for (int s = 0; s < 20; ++s) {
+            for (int p = 0; p < 4; ++p) {
+                std::string subject = "<s" + std::to_string(s) + ">";
+                std::string predicate = "<p" + std::to_string(p) + ">";
+                EXPECT_EQ(objects(all, subject, predicate), objects(lazy, subject, predicate));
+            }
+        }
+    }
+}
+
+TEST_F(DatabaseTest, LazyLoadKeepsUnsavedInsertion) {
+    auto lazy = inno::DatabaseBuilder::LoadLazy("test", 0);
+    lazy->insert("<s0>", "<p0>", "<new>");
+    EXPECT_EQ(2, objects(lazy, "<s0>", "<p0>").size());
+    // accessing other predicates mustn't evict the unsaved one
+    objects(lazy, "<s0>", "<p1>");
+    EXPECT_EQ(2, objects(lazy, "<s0>", "<p0>").size());
+
+    ASSERT_TRUE(lazy->save());
+    auto all = inno::DatabaseBuilder::LoadAll("test");
+    EXPECT_EQ(2, objects(all, "<s0>", "<p0>").size());
+}
+
+TEST_F(DatabaseTest, CorruptTripletFileFailsTheLoad) {
+    fs::path triplet_path = work_path_ / "test.db" / "triplet" / "1";
+    fs::path saved_path = work_path_ / "1.saved";
+    fs::copy_file(triplet_path, saved_path);
+    fs::resize_file(triplet_path, fs::file_size(triplet_path) / 2);
+
+    // the database isn't loaded rather than loaded with an empty predicate
+    EXPECT_EQ(0, inno::DatabaseBuilder::LoadAll("test")->getTripletSize());
+    EXPECT_EQ(0, inno::DatabaseBuilder::LoadPartial("test", {"<p0>", "<p1>"})->getTripletSize());
+
+    // the lazily loaded predicate is read again once it is accessed, the checkpoint keeps the stored pairs
+    auto lazy = inno::DatabaseBuilder::LoadLazy("test", 0);
+    EXPECT_TRUE(objects(lazy, "<s0>", "<p0>").empty());
+    ASSERT_TRUE(lazy->insert("<s0>", "<p0>", "<new>"));
+    EXPECT_FALSE(lazy->save());
+    fs::copy_file(saved_path, triplet_path, fs::copy_option::overwrite_if_exists);
+    EXPECT_EQ(2, objects(lazy, "<s0>", "<p0>").size());
+    ASSERT_TRUE(lazy->save());
+    EXPECT_EQ(2, objects(inno::DatabaseBuilder::LoadAll("test"), "<s0>", "<p0>").size());
+}
+
+TEST_F(DatabaseTest, LoggedInsertionIsReplayed) {
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        ASSERT_TRUE(db->insert({{"<s0>", "<p0>", "<new>"}, {"<new>", "<p9>", "<o1>"}}));
+        EXPECT_EQ(2, objects(db, "<s0>", "<p0>").size());
+        // dropped without `save`
+    }
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        EXPECT_EQ(2, objects(db, "<s0>", "<p0>").size());
+        EXPECT_EQ(1, objects(db, "<new>", "<p9>").size());
+        EXPECT_EQ(82, db->getTripletSize());
+        ASSERT_TRUE(db->save());
+        EXPECT_EQ(0, fs::file_size(work_path_ / "test.db" / "wal"));
+    }
+    // the checkpoint covers the batch, so it isn't replayed again
+    auto db = inno::DatabaseBuilder::LoadAll("test");
+    EXPECT_EQ(2, objects(db, "<s0>", "<p0>").size());
+    EXPECT_EQ(82, db->getTripletSize());
+}
+
+TEST_F(DatabaseTest, LoggedInsertionIsOverlaidUntilCheckpoint) {
+    auto db = inno::DatabaseBuilder::LoadAll("test");
+    uint32_t p0 = db->getPredicateId("<p0>");
+    uint64_t subjects = db->getStatisticsByP(p0).subjects.distinct;
+    ASSERT_TRUE(db->insert({{"<s0>", "<p0>", "<new>"}, {"<new>", "<p0>", "<o1>"}}));
+    EXPECT_EQ(2, db->getS2OByP(p0).deltaSize());
+    EXPECT_EQ(2, objects(db, "<s0>", "<p0>").size());
+    EXPECT_EQ(1, objects(db, "<new>", "<p0>").size());
+    EXPECT_EQ(22, db->getStatisticsByP(p0).size);
+    EXPECT_EQ(subjects + 1, db->getStatisticsByP(p0).subjects.distinct);
+
+    // the checkpoint merges the overlay into the stored arrays
+    ASSERT_TRUE(db->save());
+    auto snapshot = db->snapshot();
+    EXPECT_EQ(0, snapshot->getS2OByP(p0).deltaSize());
+    EXPECT_EQ(0, snapshot->getO2SByP(p0).deltaSize());
+    EXPECT_EQ(2, objects(snapshot, "<s0>", "<p0>").size());
+    EXPECT_EQ(22, snapshot->getS2OByP(p0).size());
+}
+
+TEST_F(DatabaseTest, TornLogRecordIsDropped) {
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        ASSERT_TRUE(db->insert({{"<s0>", "<p0>", "<new>"}}));
+    }
+    {
+        // an append interrupted by a crash
+        fs::ofstream out(work_path_ / "test.db" / "wal", fs::ofstream::out | fs::ofstream::app);
+        out << "PSOW torn";
+    }
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        EXPECT_EQ(2, objects(db, "<s0>", "<p0>").size());
+        ASSERT_TRUE(db->insert({{"<s0>", "<p0>", "<newer>"}}));
+    }
+    auto db = inno::DatabaseBuilder::LoadLazy("test", 0);
+    EXPECT_EQ(3, objects(db, "<s0>", "<p0>").size());
+}
+
+TEST_F(DatabaseTest, InterruptedCheckpointIsRecovered) {
+    fs::path db_path = work_path_ / "test.db";
+    fs::path before = work_path_ / "before", after = work_path_ / "after";
+    auto copy_dir = [](const fs::path &from, const fs::path &to) {
+        fs::create_directories(to);
+        for (fs::recursive_directory_iterator iter(from), end; iter != end; ++iter) {
+            fs::path target = to / fs::relative(iter->path(), from);
+            if (fs::is_directory(iter->path())) {
+                fs::create_directories(target);
+            } else {
+                fs::copy_file(iter->path(), target, fs::copy_option::overwrite_if_exists);
+            }
+        }
+    };
+    auto read = [](const fs::path &path) {
+        fs::ifstream in(path, fs::ifstream::in | fs::ifstream::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        ASSERT_TRUE(db->insert({{"<s0>", "<p0>", "<new>"}, {"<new>", "<p9>", "<o1>"}}));
+    }
+    copy_dir(db_path, before);
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        ASSERT_TRUE(db->save());
+    }
+    copy_dir(db_path, after);
+
+    for (bool committed : {false, true}) {
+        // a crash after the checkpoint staged its files, or in the middle of installing them,
+        // the log still holds the batch
+        fs::remove_all(db_path);
+        copy_dir(before, db_path);
+        for (fs::recursive_directory_iterator iter(after), end; iter != end; ++iter) {
+            fs::path relative = fs::relative(iter->path(), after);
+            if (fs::is_directory(iter->path()) || relative == "wal" ||
+                (fs::exists(before / relative) && read(before / relative) == read(iter->path()))) {
+                continue;
+            }
+            // the dictionary tail is appended in place, and a committed checkpoint has installed the triplet files
+            // before the crash
+            fs::path target = db_path / relative;
+            if (target.extension() != ".tail" && !(committed && relative.has_parent_path())) {
+                target += ".ckpt";
+            }
+            fs::copy_file(iter->path(), target, fs::copy_option::overwrite_if_exists);
+        }
+        if (committed) {
+            fs::ofstream(db_path / "checkpoint") << "0\n";
+        }
+
+        // either the stored files and the log, or the checkpointed files are used, never both
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        EXPECT_EQ(82, db->getTripletSize());
+        EXPECT_EQ(2, objects(db, "<s0>", "<p0>").size());
+        EXPECT_EQ(1, objects(db, "<new>", "<p9>").size());
+        EXPECT_EQ(2, db->getEntityCountBy("<new>"));
+        EXPECT_EQ(21, db->getStatisticsByP(db->getPredicateId("<p0>")).size);
+        EXPECT_FALSE(fs::exists(db_path / "checkpoint"));
+        EXPECT_FALSE(fs::exists(db_path / "triplet" / "1.ckpt"));
+        EXPECT_FALSE(fs::exists(db_path / "info.ckpt"));
+        db->unload();
+    }
+}
+
+TEST_F(DatabaseTest, BackgroundCheckpoint) {
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        db->setCheckpointSize(1);
+        ASSERT_TRUE(db->insert({{"<s0>", "<p0>", "<new>"}}));
+        // unloading waits for the running checkpoint
+        db->unload();
+    }
+    EXPECT_EQ(0, fs::file_size(work_path_ / "test.db" / "wal"));
+    auto db = inno::DatabaseBuilder::LoadAll("test");
+    EXPECT_EQ(2, objects(db, "<s0>", "<p0>").size());
+    EXPECT_EQ(81, db->getTripletSize());
+}
+
+TEST_F(DatabaseTest, IncrementalSaveRewritesChangedFilesOnly) {
+    fs::path db_path = work_path_ / "test.db";
+    auto inode = [](const fs::path &path) {
+        struct stat st{};
+        ::stat(path.c_str(), &st);
+        return st.st_ino;
+    };
+    uint32_t p0, p1;
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        p0 = db->getPredicateId("<p0>");
+        p1 = db->getPredicateId("<p1>");
+    }
+    // the files are replaced by new ones when they are rewritten
+    auto changed = inode(db_path / "triplet" / std::to_string(p0));
+    auto unchanged = inode(db_path / "triplet" / std::to_string(p1));
+    auto dictionary = inode(db_path / "id_entities");
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        db->insert("<s0>", "<p0>", "<new>");
+        ASSERT_TRUE(db->save());
+    }
+    EXPECT_NE(changed, inode(db_path / "triplet" / std::to_string(p0)));
+    EXPECT_EQ(unchanged, inode(db_path / "triplet" / std::to_string(p1)));
+    EXPECT_EQ(dictionary, inode(db_path / "id_entities"));
+    EXPECT_TRUE(fs::exists(db_path / "id_entities.tail"));
+
+    auto db = inno::DatabaseBuilder::LoadAll("test");
+    EXPECT_EQ(2, objects(db, "<s0>", "<p0>").size());
+    EXPECT_EQ(81, db->getTripletSize());
+    EXPECT_EQ(1, db->getEntityCountBy("<new>"));
+    EXPECT_EQ(5, db->getEntityCountBy("<s0>"));
+}
+
+TEST_F(DatabaseTest, InsertionIntoUnloadedPredicateKeepsStoredPairs) {
+    {
+        auto db = inno::DatabaseBuilder::LoadBasic("test");
+        db->insert("<s0>", "<p0>", "<new>");
+        ASSERT_TRUE(db->save());
+    }
+    auto db = inno::DatabaseBuilder::LoadAll("test");
+    EXPECT_EQ(2, objects(db, "<s0>", "<p0>").size());
+    EXPECT_EQ(2, objects(db, "<s1>", "<p0>").size() + objects(db, "<s2>", "<p0>").size());
+}
+
+TEST_F(DatabaseTest, PredicateStatistics) {
+    auto check = [](const std::shared_ptr<inno::DatabaseBuilder::Option> &db) {
+        // <p0> maps every subject to <o(3s % 7)>, <o4> has 2 subjects and the other objects have 3
+        const auto &statistics = db->getStatisticsByP(db->getPredicateId("<p0>"));
+        EXPECT_EQ(20, statistics.size);
+        EXPECT_EQ(20, statistics.subjects.distinct);
+        EXPECT_EQ(7, statistics.objects.distinct);
+        EXPECT_EQ(std::vector<uint32_t>({20}), statistics.subjects.histogram);
+        EXPECT_EQ(std::vector<uint32_t>({0, 7}), statistics.objects.histogram);
+        ASSERT_EQ(7, statistics.objects.heavy_hitters.size());
+        EXPECT_EQ(3, statistics.objects.heavy_hitters.front().second);
+        EXPECT_EQ(db->getEntityId("<o4>"), statistics.objects.heavy_hitters.back().first);
+        EXPECT_DOUBLE_EQ(1, statistics.objectsOf(db->getEntityId("<s0>")));
+        EXPECT_DOUBLE_EQ(2, statistics.subjectsOf(db->getEntityId("<o4>")));
+
+        EXPECT_EQ(4, db->getSubjectCountBy("<s0>"));
+        EXPECT_EQ(0, db->getObjectCountBy("<s0>"));
+        EXPECT_EQ(0, db->getSubjectCountBy("<o4>"));
+        EXPECT_EQ(db->getEntityCountBy("<o4>"), db->getObjectCountBy("<o4>"));
+    };
+    check(inno::DatabaseBuilder::LoadAll("test"));
+    check(inno::DatabaseBuilder::LoadLazy("test", 0));
+
+    // the statistics of a database built by older versions are computed on load
+    fs::remove(work_path_ / "test.db" / "predicate_statistics");
+    fs::remove(work_path_ / "test.db" / "id_entities_subject_count");
+    check(inno::DatabaseBuilder::LoadBasic("test"));
+
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        ASSERT_TRUE(db->remove({{"<s0>", "<p0>", "<o0>"}}));
+        // a deletion adjusts the statistics by the removed pairs
+        const auto &removed = db->getStatisticsByP(db->getPredicateId("<p0>"));
+        EXPECT_EQ(19, removed.size);
+        EXPECT_EQ(19, removed.subjects.distinct);
+        EXPECT_EQ(7, removed.objects.distinct);
+        EXPECT_DOUBLE_EQ(2, removed.subjectsOf(db->getEntityId("<o0>")));
+        db->insert("<o0>", "<p0>", "<s0>");
+        const auto &statistics = db->getStatisticsByP(db->getPredicateId("<p0>"));
+        EXPECT_EQ(20, statistics.size);
+        EXPECT_EQ(8, statistics.objects.distinct);
+        EXPECT_DOUBLE_EQ(2, statistics.subjectsOf(db->getEntityId("<o0>")));
+        EXPECT_EQ(1, db->getSubjectCountBy("<o0>"));
+        EXPECT_EQ(1, db->getObjectCountBy("<s0>"));
+        ASSERT_TRUE(db->save());
+    }
+    auto db = inno::DatabaseBuilder::LoadLazy("test", 0);
+    EXPECT_EQ(8, db->getStatisticsByP(db->getPredicateId("<p0>")).objects.distinct);
+    EXPECT_EQ(3, db->getSubjectCountBy("<s0>"));
+    EXPECT_EQ(1, db->getObjectCountBy("<s0>"));
+}
+
+TEST_F(DatabaseTest, CharacteristicSets) {
+    {
+        // every subject has <p0> .. <p3> once
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        const auto &sets = db->getCharacteristicSets();
+        ASSERT_EQ(1, sets.sets().size());
+        EXPECT_EQ(20, sets.sets().front().count);
+        EXPECT_EQ(std::vector<uint64_t>({20, 20, 20, 20}), sets.sets().front().occurrences);
+
+        uint32_t p0 = db->getPredicateId("<p0>");
+        uint32_t p1 = db->getPredicateId("<p1>");
+        EXPECT_DOUBLE_EQ(20, sets.estimate({{p0, 1}, {p1, 1}}));
+        // 2 of the 20 pairs of <p0> have <o4>
+        EXPECT_DOUBLE_EQ(2, sets.estimate({{p0, 0.1}, {p1, 1}}));
+        // no subject has a predicate of pid 99
+        EXPECT_DOUBLE_EQ(0, sets.estimate({{p0, 1}, {p1, 1}, {99, 1}}));
+
+        // too few changes to rebuild the sets
+        db->insert("<o0>", "<p0>", "<x>");
+        ASSERT_TRUE(db->save());
+        EXPECT_EQ(1, db->getCharacteristicSets().sets().size());
+    }
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        std::vector<std::tuple<std::string, std::string, std::string>> triplets;
+        for (int i = 0; i < 12; ++i) {
+            triplets.emplace_back("<o0>", "<p0>", "<x" + std::to_string(i) + ">");
+        }
+        ASSERT_TRUE(db->insert(triplets));
+        ASSERT_TRUE(db->save());
+    }
+    auto db = inno::DatabaseBuilder::LoadLazy("test", 0);
+    const auto &sets = db->getCharacteristicSets();
+    ASSERT_EQ(2, sets.sets().size());
+    EXPECT_EQ(std::vector<uint32_t>({db->getPredicateId("<p0>")}), sets.sets().back().predicates);
+    EXPECT_EQ(std::vector<uint64_t>({13}), sets.sets().back().occurrences);
+    EXPECT_DOUBLE_EQ(20 + 13, sets.estimate({{db->getPredicateId("<p0>"), 1}}));
+}
+
+TEST_F(DatabaseTest, DeletedTripletIsHidden) {
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        ASSERT_TRUE(db->remove({{"<s0>", "<p0>", "<o0>"}, {"<s0>", "<p0>", "<missing>"}}));
+        EXPECT_TRUE(objects(db, "<s0>", "<p0>").empty());
+        EXPECT_EQ(79, db->getTripletSize());
+        EXPECT_EQ(19, db->getPredicateCountBy("<p0>"));
+        // dropped without `save`
+    }
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        EXPECT_TRUE(objects(db, "<s0>", "<p0>").empty());
+        EXPECT_EQ(79, db->getTripletSize());
+        ASSERT_TRUE(db->save());
+        EXPECT_EQ(0, fs::file_size(work_path_ / "test.db" / "wal"));
+    }
+    auto db = inno::DatabaseBuilder::LoadLazy("test", 0);
+    EXPECT_TRUE(objects(db, "<s0>", "<p0>").empty());
+    EXPECT_EQ(1, objects(db, "<s1>", "<p0>").size());
+    EXPECT_EQ(19, db->getPredicateCountBy("<p0>"));
+}
+
+TEST_F(DatabaseTest, DeleteWhereRemovesEveryMatch) {
+    {
+        auto db = inno::DatabaseBuilder::LoadAll("test");
+        inno::SparqlParser parser;
+        parser.parse("DELETE WHERE { ?s <p1> <o1> . }");
+        inno::SparqlQuery query(db);
+        // <s0>, <s7> and <s14> match, which tombstones enough pairs of <p1> to start a compaction
+        ASSERT_TRUE(query.remove(parser));
+        EXPECT_EQ(77, db->getTripletSize());
+        EXPECT_EQ(17, db->getPredicateCountBy("<p1>"));
+
+        parser.parse("SELECT ?s WHERE { ?s <p1> <o1> . }");
+        EXPECT_TRUE(query.query(parser).empty());
+        EXPECT_EQ(1, objects(db, "<s1>", "<p1>").size());
+
+        parser.parse("DELETE WHERE { ?s <p1> <unknown> . }");
+        EXPECT_TRUE(query.remove(parser));
+        EXPECT_EQ(77, db->getTripletSize());
+    }
+    auto db = inno::DatabaseBuilder::LoadAll("test");
+    EXPECT_TRUE(objects(db, "<s7>", "<p1>").empty());
+    EXPECT_EQ(77, db->getTripletSize());
+}
+
+TEST_F(DatabaseTest, SnapshotIsIsolatedFromWrites) {
+    auto db = inno::DatabaseBuilder::LoadAll("test");
+    auto snapshot = db->snapshot();
+    ASSERT_TRUE(snapshot->isSnapshot());
+    ASSERT_TRUE(db->insert({{"<s0>", "<p0>", "<new>"}, {"<new>", "<p9>", "<o1>"}}));
+    ASSERT_TRUE(db->remove({{"<s1>", "<p0>", "<o3>"}}));
+
+    EXPECT_EQ(1, objects(snapshot, "<s0>", "<p0>").size());
+    EXPECT_EQ(1, objects(snapshot, "<s1>", "<p0>").size());
+    EXPECT_EQ(80, snapshot->getTripletSize());
+    EXPECT_EQ(20, snapshot->getPredicateCountBy("<p0>"));
+    EXPECT_THROW(snapshot->getEntityId("<new>"), std::out_of_range);
+    EXPECT_THROW(snapshot->getPredicateId("<p9>"), std::out_of_range);
+
+    auto latest = db->snapshot();
+    EXPECT_EQ(2, objects(latest, "<s0>", "<p0>").size());
+    EXPECT_TRUE(objects(latest, "<s1>", "<p0>").empty());
+    EXPECT_EQ(81, latest->getTripletSize());
+    EXPECT_EQ(1, objects(latest, "<new>", "<p9>").size());
+
+    // a single insertion is seen by the snapshots taken after it
+    ASSERT_TRUE(db->insert("<s2>", "<p0>", "<newer>"));
+    EXPECT_EQ(2, objects(db->snapshot(), "<s2>", "<p0>").size());
+    EXPECT_EQ(1, objects(latest, "<s2>", "<p0>").size());
+
+    // saving replaces the files and the dictionary blocks, the snapshots keep reading the old ones
+    ASSERT_TRUE(db->save());
+    EXPECT_EQ("<new>", latest->getEntityById(latest->getEntityId("<new>")));
+    EXPECT_EQ(1, objects(snapshot, "<s1>", "<p0>").size());
+    EXPECT_EQ("<newer>", db->snapshot()->getEntityById(db->getEntityId("<newer>")));
+}
+
+TEST_F(DatabaseTest, LazySnapshotKeepsChangedPredicate) {
+    auto db = inno::DatabaseBuilder::LoadLazy("test", 0);
+    auto snapshot = db->snapshot();
+    ASSERT_TRUE(db->remove({{"<s0>", "<p0>", "<o0>"}}));
+    ASSERT_TRUE(db->save());
+    // <p0> hadn't been read by the snapshot before it was changed and saved
+    EXPECT_EQ(1, objects(snapshot, "<s0>", "<p0>").size());
+    EXPECT_EQ(1, objects(snapshot, "<s0>", "<p1>").size());
+    EXPECT_TRUE(objects(db->snapshot(), "<s0>", "<p0>").empty());
+}
+
+TEST_F(DatabaseTest, ConcurrentSnapshotReads) {
+    auto db = inno::DatabaseBuilder::LoadAll("test");
+    std::atomic<bool> done(false);
+    std::thread writer([&db, &done]() {
+        for (int i = 0; i < 20; ++i) {
+            std::string subject = "<w" + std::to_string(i) + ">";
+            db->insert({{subject, "<p0>", "<o0>"}, {subject, "<p" + std::to_string(i % 6) + ">", subject}});
+            db->remove({{subject, "<p0>", "<o0>"}});
+        }
+        done = true;
+    });
+    do {
+        // every snapshot is consistent, its triplet count matches the pairs of its indexes
+        auto snapshot = db->snapshot();
+        size_t pairs = 0;
+        for (uint32_t pid = 1; pid <= snapshot->getPredicateSize(); ++pid) {
+            pairs += snapshot->getS2OByP(pid).size();
+        }
+        EXPECT_EQ(snapshot->getTripletSize(), pairs);
+    } while (!done);
+    writer.join();
+    EXPECT_EQ(100, db->snapshot()->getTripletSize());
+}
+
+TEST_F(DatabaseTest, ConcurrentGetterReads) {
+    auto db = inno::DatabaseBuilder::LoadAll("test");
+    std::atomic<bool> done(false);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r) {
+        // the getters of the database itself share its cached snapshot
+        readers.emplace_back([&db, &done]() {
+            do {
+                EXPECT_GE(db->getTripletSize(), 80u);
+                EXPECT_EQ(1u, db->getPredicateId("<p0>"));
+            } while (!done);
+        });
+    }
+    for (int i = 0; i < 20; ++i) {
+        std::string subject = "<w" + std::to_string(i) + ">";
+        db->insert({{subject, "<p0>", "<o0>"}});
+        db->remove({{subject, "<p0>", "<o0>"}});
+    }
+    done = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(80, db->getTripletSize());
+}
+
+TEST_F(DatabaseTest, ParallelQueryMatchesSequential) {
+    // large enough for every step to be split into several morsels
+    fs::ofstream out(work_path_ / "large.nt");
+    for (int s = 0; s < 6000; ++s) {
+        out << "<b" << s << "> <q0> <c" << s % 50 << "> .\n";
+        out << "<b" << s << "> <q1> <c" << s * 7 % 50 << "> .\n";
+        out << "<c" << s % 50 << "> <q2> <b" << (s + 50) % 6000 << "> .\n";
+    }
+    out.close();
+    inno::DatabaseBuilder::Create("large", (work_path_ / "large.nt").string());
+    auto db = inno::DatabaseBuilder::LoadAll("large");
+
+    inno::SparqlParser parser;
+    inno::SparqlQuery query(db);
+    for (const auto &sparql : {"SELECT ?s ?x ?y WHERE { ?s <q0> ?x . ?s <q1> ?y . }",
+                               "SELECT ?s ?x WHERE { ?s <q0> ?x . ?x <q2> ?t . ?t <q1> <c7> . }",
+                               "SELECT ?s ?x WHERE { ?s <q0> ?x . ?x <q2> ?s . }"}) {
+        parser.parse(sparql);
+        query.setParallelism(1);
+        auto sequential = query.query(parser).toResultSet();
+        query.setParallelism(4);
+        EXPECT_EQ(sequential, query.query(parser).toResultSet()) << sparql;
+        EXPECT_FALSE(sequential.empty()) << sparql;
+    }
+    // the scan stops in the first wave of morsels, and its rows are the first ones of the sequential run
+    parser.parse("SELECT ?s ?x ?y WHERE { ?s <q0> ?x . ?s <q1> ?y . } LIMIT 10");
+    auto limited = query.query(parser).toResultSet();
+    query.setParallelism(1);
+    EXPECT_EQ(limited, query.query(parser).toResultSet());
+    EXPECT_EQ(10, limited.size());
+
+    query.setParallelism(0);
+    EXPECT_LE(1, query.getParallelism());
+}
+
+TEST_F(DatabaseTest, QueryResultDecodesIds) {
+    auto db = inno::DatabaseBuilder::LoadAll("test");
+    inno::SparqlParser parser;
+    inno::SparqlQuery query(db);
+    parser.parse("SELECT ?o ?s ?unused WHERE { <s1> <p2> ?o . ?s <p0> ?o . }");
+    auto result = query.query(parser);
+    ASSERT_EQ(3, result.size());
+    EXPECT_EQ((std::vector<std::string>{"?o", "?s", "?unused"}), result.variables());
+
+    std::set<std::string> subjects;
+    for (const auto &row : result) {
+        ASSERT_EQ(3, row.size());
+        EXPECT_EQ(db->getEntityId("<o5>"), row.id(0));
+        EXPECT_EQ("<o5>", row[0]);
+        EXPECT_EQ(db->getEntityById(row.id(1)), row[1]);
+        subjects.insert(row[1]);
+        EXPECT_EQ(static_cast<uint32_t>(inno::BindingTable::UNBOUND), row.id(2));
+        EXPECT_EQ("", row[2]);
+    }
+    // (s * 3) % 7 == 5 for <p0>
+    EXPECT_EQ((std::set<std::string>{"<s4>", "<s11>", "<s18>"}), subjects);
+    EXPECT_EQ(result.size(), result.toResultSet().size());
+    EXPECT_EQ(result[0].terms(), *result.toResultSet().find(result[0].terms()));
+}
+
+TEST_F(DatabaseTest, LimitAndOffset) {
+    auto db = inno::DatabaseBuilder::LoadAll("test");
+    inno::SparqlParser parser;
+    inno::SparqlQuery query(db);
+    parser.parse("SELECT DISTINCT ?s ?o WHERE { ?s <p0> ?o . ?s <p1> ?x . }");
+    auto all = query.query(parser).toResultSet();
+    ASSERT_EQ(20, all.size());
+
+    for (size_t parallelism : {1, 4}) {
+        query.setParallelism(parallelism);
+        inno::ResultSet pages;
+        for (size_t offset = 0; offset < 20; offset += 7) {
+            parser.parse("SELECT DISTINCT ?s ?o WHERE { ?s <p0> ?o . ?s <p1> ?x . } LIMIT 7 OFFSET " +
+                         std::to_string(offset));
+            auto page = query.query(parser).toResultSet();
+            EXPECT_EQ(std::min<size_t>(7, 20 - offset), page.size());
+            // the pages are disjoint parts of the whole result
+            for (const auto &row : page) {
+                EXPECT_TRUE(all.count(row));
+                EXPECT_TRUE(pages.insert(row).second);
+            }
+        }
+        EXPECT_EQ(all, pages);
+    }
+
+    // the rows are a bag, the duplicates of a row are counted only without DISTINCT
+    parser.parse("SELECT ?o WHERE { ?s <p0> ?o . } LIMIT 100");
+    EXPECT_EQ(20, query.query(parser).size());
+    parser.parse("SELECT ?o WHERE { ?s <p0> ?o . } OFFSET 5");
+    EXPECT_EQ(15, query.query(parser).size());
+    parser.parse("SELECT DISTINCT ?o WHERE { ?s <p0> ?o . } LIMIT 100");
+    EXPECT_EQ(7, query.query(parser).size());
+    parser.parse("SELECT DISTINCT ?o WHERE { ?s <p0> ?o . } OFFSET 5");
+    EXPECT_EQ(2, query.query(parser).size());
+    parser.parse("SELECT ?o WHERE { ?s <p0> ?o . } LIMIT 0");
+    EXPECT_TRUE(query.query(parser).empty());
+}
+
+TEST_F(DatabaseTest, LazyQueryPinsItsPredicates) {
+    fs::ofstream out(work_path_ / "cycles.nt");
+    for (int n = 0; n < 6000; ++n) {
+        out << "<n" << n << "> <a> <n" << (n + 1) % 6000 << "> .\n";
+        out << "<n" << n << "> <b> <n" << (n + 2) % 6000 << "> .\n";
+        out << "<n" << n << "> <c> <n" << (n + 3) % 6000 << "> .\n";
+    }
+    out.close();
+    inno::DatabaseBuilder::Create("cycles", (work_path_ / "cycles.nt").string());
+    auto all = inno::DatabaseBuilder::LoadAll("cycles");
+    // a budget of 0 byte is less than two predicates, so every access would evict the others
+    auto lazy = inno::DatabaseBuilder::LoadLazy("cycles", 0);
+
+    inno::SparqlParser parser;
+    inno::SparqlQuery expected(all), query(lazy);
+    for (const auto &sparql : {"SELECT ?x ?y ?z WHERE { ?x <a> ?y . ?y <b> ?z . ?x <c> ?z . }",
+                               "SELECT ?x ?w WHERE { ?x <a> ?y . ?y <b> ?z . ?z <c> ?w . }"}) {
+        parser.parse(sparql);
+        auto rows = expected.query(parser).toResultSet();
+        EXPECT_FALSE(rows.empty()) << sparql;
+        for (size_t parallelism : {1, 4}) {
+            query.setParallelism(parallelism);
+            auto result = query.query(parser);
+            for (const auto &row : result) {
+                EXPECT_TRUE(rows.count(row.terms())) << sparql;
+            }
+            EXPECT_EQ(rows.size(), result.size()) << sparql;
+        }
+    }
+}
+
+} // namespace test
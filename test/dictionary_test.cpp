@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+
+#include "database/dictionary.hpp"
+
+namespace test {
+
+namespace fs = boost::filesystem;
+
+class DictionaryTest : public testing::Test {
+protected:
+    void SetUp() override {
+        for (int i = 0; i < 40; ++i) {
+            terms_.emplace_back("<http://example.org/resource/" + std::to_string((i * 7) % 40) + ">");
+        }
+        terms_.emplace_back("\"literal\"");
+        for (const auto &term : terms_) {
+            dictionary_.insert(term);
+        }
+    }
+
+    void expectTerms(const inno::Dictionary &dictionary) {
+        ASSERT_EQ(terms_.size(), dictionary.size());
+        for (uint32_t id = 1; id <= terms_.size(); ++id) {
+            EXPECT_EQ(terms_[id - 1], dictionary.getTerm(id));
+            EXPECT_EQ(id, dictionary.find(terms_[id - 1]));
+        }
+        EXPECT_EQ(0, dictionary.find("<http://example.org/resource/>"));
+        EXPECT_EQ(0, dictionary.find("<http://example.org/resource/400>"));
+        EXPECT_THROW(dictionary.getId("<missing>"), std::out_of_range);
+        EXPECT_THROW(dictionary.getTerm(0), std::out_of_range);
+    }
+
+    std::vector<std::string> terms_;
+    inno::Dictionary dictionary_;
+};
+
+TEST_F(DictionaryTest, InsertAndCompact) {
+    EXPECT_FALSE(dictionary_.insert(terms_[3]).second);
+    expectTerms(dictionary_);
+
+    dictionary_.compact();
+    expectTerms(dictionary_);
+
+    // terms inserted after compaction keep the following ids
+    terms_.emplace_back("<http://example.org/resource/1000>");
+    EXPECT_EQ(terms_.size(), dictionary_.insert(terms_.back()).first);
+    expectTerms(dictionary_);
+    dictionary_.compact();
+    expectTerms(dictionary_);
+}
+
+TEST_F(DictionaryTest, SaveAndLoad) {
+    fs::path path = fs::temp_directory_path() / fs::unique_path();
+    ASSERT_TRUE(dictionary_.save(path.string()));
+    EXPECT_EQ(inno::Dictionary::CurrentFileVersion(), inno::Dictionary::FileVersion(path.string()));
+
+    inno::Dictionary loaded;
+    ASSERT_TRUE(inno::Dictionary::Load(path.string(), loaded));
+    expectTerms(loaded);
+    fs::remove(path);
+}
+
+TEST_F(DictionaryTest, AppendTail) {
+    fs::path path = fs::temp_directory_path() / fs::unique_path();
+    fs::path tail_path = path.string() + ".tail";
+    ASSERT_TRUE(dictionary_.save(path.string()));
+    auto file_size = fs::file_size(path);
+
+    // a few new terms are appended to the tail file, the dictionary file is kept
+    for (int i = 0; i < 3; ++i) {
+        terms_.emplace_back("<http://example.org/tail/" + std::to_string(i) + ">");
+        dictionary_.insert(terms_.back());
+        ASSERT_TRUE(dictionary_.append(path.string()));
+    }
+    EXPECT_EQ(file_size, fs::file_size(path));
+    EXPECT_TRUE(fs::exists(tail_path));
+    EXPECT_EQ(terms_.size(), dictionary_.storedSize());
+
+    inno::Dictionary loaded;
+    ASSERT_TRUE(inno::Dictionary::Load(path.string(), loaded));
+    expectTerms(loaded);
+
+    // the terms over the stored size were appended by an unfinished store
+    ASSERT_TRUE(inno::Dictionary::Load(path.string(), loaded, static_cast<uint32_t>(terms_.size() - 1)));
+    EXPECT_EQ(terms_.size() - 1, loaded.size());
+    EXPECT_EQ(0, loaded.find(terms_.back()));
+    ASSERT_TRUE(loaded.append(path.string()));
+    ASSERT_TRUE(inno::Dictionary::Load(path.string(), loaded));
+    EXPECT_EQ(terms_.size() - 1, loaded.size());
+
+    // a long tail is merged, and the dictionary file is rewritten
+    for (int i = 0; i < 10; ++i) {
+        terms_.emplace_back("<http://example.org/merged/" + std::to_string(i) + ">");
+        dictionary_.insert(terms_.back());
+    }
+    ASSERT_TRUE(dictionary_.append(path.string()));
+    EXPECT_FALSE(fs::exists(tail_path));
+    ASSERT_TRUE(inno::Dictionary::Load(path.string(), loaded));
+    expectTerms(loaded);
+    fs::remove(path);
+}
+
+} // namespace test
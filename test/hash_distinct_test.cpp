@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+#include <csignal>
+#include <sys/resource.h>
+
+#include "query/hash_distinct.hpp"
+
+namespace test {
+
+using Rows = std::set<std::vector<uint32_t>>;
+
+TEST(HashDistinctTest, TellsDuplicatedRows) {
+    inno::HashDistinct distinct(2);
+    std::vector<uint32_t> a{1, 2}, b{2, 1};
+    EXPECT_EQ(inno::HashDistinct::NEW, distinct.insert(a.data()));
+    EXPECT_EQ(inno::HashDistinct::NEW, distinct.insert(b.data()));
+    EXPECT_EQ(inno::HashDistinct::DUPLICATE, distinct.insert(a.data()));
+    EXPECT_EQ(inno::HashDistinct::DUPLICATE, distinct.insert(b.data()));
+    EXPECT_EQ(0, distinct.spilledPartitions());
+    EXPECT_LT(0, distinct.memoryUsage());
+
+    // nothing is deferred
+    EXPECT_TRUE(distinct.finish([](const uint32_t *) {
+        ADD_FAILURE();
+        return true;
+    }));
+}
+
+TEST(HashDistinctTest, SpillsAndDeduplicatesDeferredRows) {
+    inno::ThreadPool pool(4);
+    for (std::size_t parallelism : {1, 4}) {
+        // a limit so small that the partitions are spilled one by one
+        inno::HashDistinct distinct(3, 1024);
+        Rows emitted, expected;
+        for (int round = 0; round < 3; ++round) {
+            for (uint32_t i = 0; i < 2000; ++i) {
+                std::vector<uint32_t> row{i % 500, i % 7, round == 2 ? i : 0};
+                expected.insert(row);
+                auto status = distinct.insert(row.data());
+                if (status == inno::HashDistinct::NEW) {
+                    EXPECT_TRUE(emitted.insert(row).second);
+                }
+            }
+        }
+        EXPECT_LT(0, distinct.spilledPartitions());
+        EXPECT_LT(expected.size(), emitted.size() + 2000 * 3);
+
+        // the deferred rows are new ones only, and none of them was emitted before
+        EXPECT_TRUE(distinct.finish([&emitted](const uint32_t *row) {
+            EXPECT_TRUE(emitted.insert(std::vector<uint32_t>(row, row + 3)).second);
+            return true;
+        }, &pool, parallelism));
+        EXPECT_EQ(expected, emitted);
+    }
+}
+
+TEST(HashDistinctTest, KeepsDeferredRowsInMemoryWhenTheSpillFails) {
+    // the spilled partitions cannot grow over 8 KiB, so the later writes into them fail
+    struct rlimit limit{}, old_limit{};
+    ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &old_limit));
+    limit = old_limit;
+    limit.rlim_cur = 8 << 10;
+    auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+    ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+
+    inno::HashDistinct distinct(3, 1024);
+    Rows emitted, expected;
+    for (uint32_t i = 0; i < 40000; ++i) {
+        std::vector<uint32_t> row{i % 9000, i % 5, 0};
+        expected.insert(row);
+        if (distinct.insert(row.data()) == inno::HashDistinct::NEW) {
+            EXPECT_TRUE(emitted.insert(row).second);
+        }
+    }
+    EXPECT_LT(0, distinct.spilledPartitions());
+    EXPECT_TRUE(distinct.finish([&emitted](const uint32_t *row) {
+        EXPECT_TRUE(emitted.insert(std::vector<uint32_t>(row, row + 3)).second);
+        return true;
+    }));
+
+    setrlimit(RLIMIT_FSIZE, &old_limit);
+    std::signal(SIGXFSZ, old_handler);
+    EXPECT_EQ(expected, emitted);
+}
+
+TEST(HashDistinctTest, SplitsSpilledPartitionsOverTheLimit) {
+    inno::ThreadPool pool(4);
+    for (std::size_t parallelism : {1, 4}) {
+        // a spilled partition holds hundreds of distinct rows, far more than a share of 4 KiB,
+        // and a row repeated over and over, which takes a single slot
+        inno::HashDistinct distinct(2, 4096);
+        Rows emitted, expected;
+        for (uint32_t i = 0; i < 60000; ++i) {
+            std::vector<uint32_t> row = i % 2 ? std::vector<uint32_t>{7, 7} : std::vector<uint32_t>{i % 20000, i % 3};
+            expected.insert(row);
+            if (distinct.insert(row.data()) == inno::HashDistinct::NEW) {
+                EXPECT_TRUE(emitted.insert(row).second);
+            }
+        }
+        EXPECT_EQ(1u << inno::HashDistinct::PARTITION_BITS, distinct.spilledPartitions());
+
+        EXPECT_TRUE(distinct.finish([&emitted](const uint32_t *row) {
+            EXPECT_TRUE(emitted.insert(std::vector<uint32_t>(row, row + 2)).second);
+            return true;
+        }, &pool, parallelism));
+        EXPECT_EQ(expected, emitted);
+        EXPECT_EQ(0, distinct.memoryUsage());
+    }
+}
+
+TEST(HashDistinctTest, FinishStopsWhenEmitReturnsFalse) {
+    inno::HashDistinct distinct(1, 0);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        distinct.insert(&i);
+    }
+    std::size_t count = 0;
+    EXPECT_FALSE(distinct.finish([&count](const uint32_t *) {
+        return ++count < 10;
+    }));
+    EXPECT_EQ(10, count);
+}
+
+} // namespace test
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "query/join_optimizer.hpp"
+
+namespace test {
+
+inno::JoinOptimizer::Pattern pattern(const std::string &s, const double &s_distinct,
+                                     const std::string &o, const double &o_distinct, const double &size) {
+    inno::JoinOptimizer::Pattern pattern;
+    pattern.size = size;
+    pattern.variables = {{s, s_distinct}, {o, o_distinct}};
+    pattern.subject = s;
+    return pattern;
+}
+
+TEST(JoinOptimizerTest, JoinShrinksByTheLargerDistinctSide) {
+    inno::CharacteristicSets sets;
+    inno::JoinOptimizer optimizer({pattern("?x", 100, "?y", 1000, 1000),
+                                   pattern("?y", 10, "?z", 10, 10)}, sets);
+    EXPECT_DOUBLE_EQ(1000, optimizer.estimate({0}));
+    EXPECT_DOUBLE_EQ(10, optimizer.estimate({0, 1}));
+}
+
+TEST(JoinOptimizerTest, StartsFromTheSelectiveEnd) {
+    inno::CharacteristicSets sets;
+    // ?a -> ?b -> ?c -> ?d, where the last pattern is tiny
+    inno::JoinOptimizer optimizer({pattern("?a", 1000, "?b", 1000, 100000),
+                                   pattern("?b", 1000, "?c", 1000, 100000),
+                                   pattern("?c", 5, "?d", 5, 5)}, sets);
+    EXPECT_EQ(std::vector<std::size_t>({2, 1, 0}), optimizer.order());
+}
+
+TEST(JoinOptimizerTest, CrossProductComesLast) {
+    inno::CharacteristicSets sets;
+    inno::JoinOptimizer optimizer({pattern("?a", 10, "?b", 10, 10),
+                                   pattern("?x", 50, "?y", 50, 50),
+                                   pattern("?b", 10, "?c", 100, 100)}, sets);
+    EXPECT_EQ(std::vector<std::size_t>({0, 2, 1}), optimizer.order());
+    EXPECT_DOUBLE_EQ(500, optimizer.estimate({1, 0}));
+}
+
+TEST(JoinOptimizerTest, StarIsEstimatedByCharacteristicSets) {
+    // subjects 1 .. 10 have <1>, 1 and 2 have <2> as well, 11 and 12 have <2> only
+    std::vector<std::pair<uint32_t, uint32_t>> p1, p2;
+    for (uint32_t s = 1; s <= 10; ++s) {
+        p1.emplace_back(s, 100 + s);
+    }
+    for (uint32_t s : {1, 2, 11, 12}) {
+        p2.emplace_back(s, 200 + s);
+    }
+    std::vector<inno::CsrIndex> indexes{inno::CsrIndex(), inno::CsrIndex::Build(p1), inno::CsrIndex::Build(p2)};
+    auto sets = inno::CharacteristicSets::Compute(2, [&indexes](const uint32_t &pid) { return indexes[pid]; });
+    ASSERT_EQ(3, sets.sets().size());
+
+    auto a = pattern("?s", 10, "?o1", 10, 10);
+    a.star = {1, 1};
+    auto b = pattern("?s", 4, "?o2", 4, 4);
+    b.star = {2, 1};
+    inno::JoinOptimizer optimizer({a, b}, sets);
+    // the independence assumption would give 10 * 4 / 10
+    EXPECT_DOUBLE_EQ(2, optimizer.estimate({0, 1}));
+
+    // sharing an object as well isn't a plain star
+    auto c = pattern("?s", 4, "?o1", 4, 4);
+    c.star = {2, 1};
+    inno::JoinOptimizer shared({a, c}, sets);
+    EXPECT_DOUBLE_EQ(0.4, shared.estimate({0, 1}));
+}
+
+TEST(JoinOptimizerTest, LargeQueryIsOrderedGreedily) {
+    inno::CharacteristicSets sets;
+    std::vector<inno::JoinOptimizer::Pattern> patterns;
+    std::size_t n = inno::JoinOptimizer::DP_LIMIT + 4;
+    for (std::size_t i = 0; i < n; ++i) {
+        double size = i == n / 2 ? 1 : 1000;
+        patterns.emplace_back(pattern("?v" + std::to_string(i), size, "?v" + std::to_string(i + 1), size, size));
+    }
+    inno::JoinOptimizer optimizer(patterns, sets);
+    auto order = optimizer.order();
+    ASSERT_EQ(n, order.size());
+    EXPECT_EQ(n / 2, order.front());
+
+    // every pattern is joined with one before it
+    auto sorted = order;
+    std::sort(sorted.begin(), sorted.end());
+    for (std::size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(i, sorted[i]);
+    }
+    for (std::size_t k = 1; k < n; ++k) {
+        EXPECT_TRUE(std::any_of(order.begin(), order.begin() + k, [&](const std::size_t &j) {
+            return j + 1 == order[k] || order[k] + 1 == j;
+        }));
+    }
+}
+
+}
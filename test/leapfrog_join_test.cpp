@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "query/leapfrog_join.hpp"
+
+namespace test {
+
+using Pairs = std::vector<std::pair<uint32_t, uint32_t>>;
+
+inno::CsrIndex index(Pairs pairs, const bool &reversed = false) {
+    if (reversed) {
+        for (auto &pair : pairs) {
+            std::swap(pair.first, pair.second);
+        }
+    }
+    return inno::CsrIndex::Build(pairs);
+}
+
+inno::LeapfrogJoin::Atom atom(const inno::CsrIndex &index, const uint32_t &key_slot, const uint32_t &value_slot) {
+    inno::LeapfrogJoin::Atom atom;
+    atom.index = &index;
+    atom.key_slot = key_slot;
+    atom.value_slot = value_slot;
+    return atom;
+}
+
+inno::BindingTable start(const std::size_t &width) {
+    inno::BindingTable table(width);
+    table.appendRow();
+    return table;
+}
+
+std::multiset<std::tuple<uint32_t, uint32_t, uint32_t>> rows(const inno::BindingTable &table) {
+    std::multiset<std::tuple<uint32_t, uint32_t, uint32_t>> rows;
+    for (std::size_t i = 0; i < table.size(); ++i) {
+        rows.emplace(table.row(i)[0], table.row(i)[1], table.row(i)[2]);
+    }
+    return rows;
+}
+
+// ?x <a> ?y . ?y <b> ?z . ?z <c> ?x
+TEST(LeapfrogJoinTest, Triangle) {
+    Pairs a{{1, 2}, {1, 3}, {2, 3}, {4, 5}};
+    Pairs b{{2, 3}, {3, 1}, {3, 4}, {5, 6}};
+    Pairs c{{3, 1}, {1, 2}, {4, 1}, {6, 9}};
+    auto a_s2o = index(a), b_s2o = index(b), c_o2s = index(c, true);
+    // ?z <c> ?x is read from its objects, since ?x comes first
+    inno::LeapfrogJoin join({atom(a_s2o, 0, 1), atom(b_s2o, 1, 2), atom(c_o2s, 0, 2)}, {0, 1, 2});
+
+    auto result = rows(join.join(start(3)));
+    std::multiset<std::tuple<uint32_t, uint32_t, uint32_t>> expected{{1, 2, 3}, {1, 3, 4}, {2, 3, 1}};
+    EXPECT_EQ(expected, result);
+}
+
+TEST(LeapfrogJoinTest, DuplicatedPairsAndBoundSlots) {
+    Pairs a{{1, 2}, {1, 2}, {2, 1}};
+    Pairs b{{2, 1}, {1, 2}};
+    auto a_s2o = index(a), b_o2s = index(b, true);
+    inno::LeapfrogJoin join({atom(a_s2o, 0, 1), atom(b_o2s, 0, 1)}, {0, 1});
+
+    auto result = rows(join.join(start(3)));
+    std::multiset<std::tuple<uint32_t, uint32_t, uint32_t>> expected{{1, 2, 0}, {1, 2, 0}, {2, 1, 0}};
+    EXPECT_EQ(expected, result);
+
+    // a slot bound by the input rows is checked instead
+    inno::BindingTable input(3);
+    input.appendRow()[0] = 2;
+    input.appendRow()[0] = 3;
+    EXPECT_EQ(1, join.join(input).size());
+}
+
+TEST(LeapfrogJoinTest, BoundSideFilters) {
+    Pairs a{{1, 2}, {2, 3}, {3, 1}};
+    auto a_s2o = index(a), a_o2s = index(a, true);
+    std::vector<uint32_t> typed{2, 3, 7};
+
+    auto filter = atom(a_s2o, 0, 0);
+    filter.index = nullptr;
+    filter.values = inno::IdSpan(typed.data(), typed.data() + typed.size());
+    inno::LeapfrogJoin join({atom(a_s2o, 0, 1), atom(a_o2s, 1, 2), filter}, {0, 1, 2});
+
+    auto result = rows(join.join(start(3)));
+    std::multiset<std::tuple<uint32_t, uint32_t, uint32_t>> expected{{2, 3, 2}, {3, 1, 3}};
+    EXPECT_EQ(expected, result);
+}
+
+}
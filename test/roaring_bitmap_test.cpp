@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+#include <algorithm>
+
+#include "common/roaring_bitmap.hpp"
+
+namespace test {
+
+TEST(RoaringBitmapTest, FromSortedAndContains) {
+    // a sparse container, a dense one and a duplicated id
+    std::vector<uint32_t> ids {1, 1, 70000};
+    for (uint32_t id = 1u << 17; id < (1u << 17) + 10000; ++id) {
+        ids.emplace_back(id);
+    }
+    auto bitmap = inno::RoaringBitmap::FromSorted(ids.begin(), ids.end());
+    EXPECT_EQ(10002, bitmap.cardinality());
+    EXPECT_TRUE(bitmap.contains(1));
+    EXPECT_TRUE(bitmap.contains(70000));
+    EXPECT_TRUE(bitmap.contains((1u << 17) + 9999));
+    EXPECT_FALSE(bitmap.contains(2));
+    EXPECT_FALSE(bitmap.contains((1u << 17) + 10000));
+
+    ids.erase(ids.begin());
+    EXPECT_EQ(ids, bitmap.toVector());
+}
+
+TEST(RoaringBitmapTest, Add) {
+    inno::RoaringBitmap bitmap;
+    std::set<uint32_t> expect;
+    for (uint32_t i = 0; i < 20000; ++i) {
+        uint32_t id = (i * 7919u) % 100000;
+        bitmap.add(id);
+        expect.insert(id);
+    }
+    bitmap.add(42);
+    expect.insert(42);
+    EXPECT_EQ(expect.size(), bitmap.cardinality());
+    EXPECT_EQ(std::vector<uint32_t>(expect.begin(), expect.end()), bitmap.toVector());
+}
+
+TEST(RoaringBitmapTest, Intersect) {
+    std::vector<uint32_t> a, b, expect;
+    for (uint32_t id = 0; id < 200000; id += 2) {
+        a.emplace_back(id);
+    }
+    for (uint32_t id = 0; id < 200000; id += 3) {
+        b.emplace_back(id);
+    }
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expect));
+
+    auto bitmap_a = inno::RoaringBitmap::FromSorted(a.begin(), a.end());
+    auto bitmap_b = inno::RoaringBitmap::FromSorted(b.begin(), b.end());
+    auto result = bitmap_a & bitmap_b;
+    EXPECT_EQ(expect.size(), result.cardinality());
+    EXPECT_EQ(expect, result.toVector());
+
+    // bitmap containers against array containers
+    std::vector<uint32_t> small {3, 6, 7, 65536 * 2 + 4};
+    result &= inno::RoaringBitmap::FromSorted(small.begin(), small.end());
+    EXPECT_EQ((std::vector<uint32_t>{6, 65536 * 2 + 4}), result.toVector());
+}
+
+} // namespace test
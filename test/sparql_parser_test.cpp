@@ -112,4 +112,69 @@ TEST_F(SparqlParserTest, ParseInsertStatement) {
     }
 }
 
+TEST_F(SparqlParserTest, ParseDeleteStatement) {
+    inno::SparqlParser parser;
+    parser.parse("DELETE DATA { A :likes B .\nB :follows D . }");
+    std::vector<inno::Triplet> answer = {
+            {"A", ":likes", "B"},
+            {"B", ":follows", "D"},
+    };
+    EXPECT_EQ(answer, parser.getDeleteTriplets());
+    EXPECT_TRUE(parser.getQueryVariables().empty());
+
+    parser.parse("DELETE WHERE { ?x :likes ?y . ?y :follows D }");
+    answer = {
+            {"?x", ":likes", "?y"},
+            {"?y", ":follows", "D"},
+    };
+    EXPECT_EQ(answer, parser.getDeleteTriplets());
+    EXPECT_EQ(answer, parser.getQueryTriplets());
+    EXPECT_EQ((std::vector<std::string>{"?x", "?y"}), parser.getQueryVariables());
+    EXPECT_TRUE(parser.getInsertTriplets().empty());
+}
+
+TEST_F(SparqlParserTest, ParseDeleteStatementWithDottedIris) {
+    inno::SparqlParser parser;
+    parser.parse("DELETE DATA { <http://ex.org/a> <http://ex.org/p> <http://ex.org/b> . }");
+    std::vector<inno::Triplet> answer = {
+            {"<http://ex.org/a>", "<http://ex.org/p>", "<http://ex.org/b>"},
+    };
+    EXPECT_EQ(answer, parser.getDeleteTriplets());
+
+    parser.parse("DELETE DATA { <http://ex.org/a> <http://ex.org/p> <http://ex.org/b> .\n"
+                 "<http://ex.org/b> <http://ex.org/q> \"v1.2\".}");
+    answer.emplace_back("<http://ex.org/b>", "<http://ex.org/q>", "\"v1.2\"");
+    EXPECT_EQ(answer, parser.getDeleteTriplets());
+    EXPECT_EQ((std::vector<std::string>{"<http://ex.org/p>", "<http://ex.org/q>"}),
+              parser.getPredicateIndexedList());
+
+    parser.parse("DELETE WHERE { ?x <http://ex.org/p> <http://ex.org/b> }");
+    answer = {
+            {"?x", "<http://ex.org/p>", "<http://ex.org/b>"},
+    };
+    EXPECT_EQ(answer, parser.getDeleteTriplets());
+}
+
+TEST_F(SparqlParserTest, ParseLimitAndOffset) {
+    inno::SparqlParser parser;
+    parser.parse("SELECT ?x WHERE { ?x :likes ?y . } LIMIT 10 OFFSET 20");
+    EXPECT_EQ(10, parser.getLimit());
+    EXPECT_EQ(20, parser.getOffset());
+    EXPECT_EQ(1, parser.getQueryTriplets().size());
+
+    parser.parse("select ?x where { ?x :likes ?y . }\noffset 5\nlimit 0");
+    EXPECT_EQ(0, parser.getLimit());
+    EXPECT_EQ(5, parser.getOffset());
+
+    parser.parse("SELECT ?x WHERE { ?x :likes ?y . }");
+    EXPECT_EQ(inno::SparqlParser::NO_LIMIT, parser.getLimit());
+    EXPECT_EQ(0, parser.getOffset());
+
+    // numbers over 2^64 are clamped instead of failing the parse
+    parser.parse("SELECT ?x WHERE { ?x :likes ?y . } LIMIT 99999999999999999999999 OFFSET 184467440737095516160");
+    EXPECT_EQ(inno::SparqlParser::NO_LIMIT, parser.getLimit());
+    EXPECT_EQ(inno::SparqlParser::NO_LIMIT, parser.getOffset());
+    EXPECT_EQ(1, parser.getQueryTriplets().size());
+}
+
 } // namespace test
@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <future>
+#include <numeric>
+
+#include "common/thread_pool.hpp"
+
+namespace test {
+
+TEST(ThreadPoolTest, Submit) {
+    inno::ThreadPool pool(4);
+    std::vector<std::future<int>> task_list;
+    for (int i = 0; i < 100; ++i) {
+        task_list.emplace_back(pool.submit([](int x) { return x * x; }, i));
+    }
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(i * i, pool.wait(task_list[i]));
+    }
+}
+
+TEST(ThreadPoolTest, NestedWaitDoesNotDeadlock) {
+    // a single worker has to run the inner tasks while it waits for them
+    inno::ThreadPool pool(1);
+    auto outer = pool.submit([&pool]() {
+        std::vector<std::future<int>> task_list;
+        for (int i = 1; i <= 10; ++i) {
+            task_list.emplace_back(pool.submit([i]() { return i; }));
+        }
+        int sum = 0;
+        for (auto &task : task_list) {
+            sum += pool.wait(task);
+        }
+        return sum;
+    });
+    EXPECT_EQ(55, pool.wait(outer));
+}
+
+} // namespace test
@@ -0,0 +1,31 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "common/utils.hpp"
+
+namespace test {
+
+TEST(UtilsTest, ParseMemorySize) {
+    size_t bytes = 0;
+    EXPECT_TRUE(inno::parseMemorySize("512", bytes));
+    EXPECT_EQ(512u, bytes);
+    EXPECT_TRUE(inno::parseMemorySize("64KB", bytes));
+    EXPECT_EQ(64u << 10, bytes);
+    EXPECT_TRUE(inno::parseMemorySize("8g", bytes));
+    EXPECT_EQ(size_t(8) << 30, bytes);
+
+    bytes = 7;
+    EXPECT_FALSE(inno::parseMemorySize("", bytes));
+    EXPECT_FALSE(inno::parseMemorySize("M", bytes));
+    EXPECT_FALSE(inno::parseMemorySize("-1", bytes));
+    EXPECT_FALSE(inno::parseMemorySize(" -1G", bytes));
+    EXPECT_FALSE(inno::parseMemorySize("+1G", bytes));
+    EXPECT_FALSE(inno::parseMemorySize("1X", bytes));
+    EXPECT_FALSE(inno::parseMemorySize("1GBs", bytes));
+    // over the range of size_t once shifted
+    EXPECT_FALSE(inno::parseMemorySize(std::to_string(std::numeric_limits<size_t>::max() >> 39) + "T", bytes));
+    EXPECT_FALSE(inno::parseMemorySize("99999999999999999999999", bytes));
+    EXPECT_EQ(7u, bytes);
+}
+
+} // namespace test